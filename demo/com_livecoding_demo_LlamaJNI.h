@@ -12,7 +12,71 @@ extern "C" {
  * Method:    loadModel
  * Signature: (Ljava/lang/String;)J
  */
-JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_loadModel
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_loadModel__Ljava_lang_String_2
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    loadModel
+ * Signature: (Ljava/lang/String;Lcom/livecoding/demo/LoadOptions;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_loadModel__Ljava_lang_String_2Lcom_livecoding_demo_LoadOptions_2
+  (JNIEnv *, jobject, jstring, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    acquireModel
+ * Signature: (Ljava/lang/String;Ljava/lang/String;Lcom/livecoding/demo/LoadOptions;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_acquireModel
+  (JNIEnv *, jobject, jstring, jstring, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    reloadModel
+ * Signature: (Ljava/lang/String;Ljava/lang/String;Lcom/livecoding/demo/LoadOptions;)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_livecoding_demo_LlamaJNI_reloadModel
+  (JNIEnv *, jobject, jstring, jstring, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    releaseModel
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_livecoding_demo_LlamaJNI_releaseModel
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    evictModel
+ * Signature: (Ljava/lang/String;)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_livecoding_demo_LlamaJNI_evictModel
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    setModelMemoryBudget
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_livecoding_demo_LlamaJNI_setModelMemoryBudget
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    residentModels
+ * Signature: ()[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_livecoding_demo_LlamaJNI_residentModels
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    getMetrics
+ * Signature: (Ljava/lang/String;)[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_livecoding_demo_LlamaJNI_getMetrics
   (JNIEnv *, jobject, jstring);
 
 /*
@@ -20,9 +84,113 @@ JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_loadModel
  * Method:    generateText
  * Signature: (JLjava/lang/String;)Ljava/lang/String;
  */
-JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateText
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateText__JLjava_lang_String_2
   (JNIEnv *, jobject, jlong, jstring);
 
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    generateText
+ * Signature: (JLjava/lang/String;Lcom/livecoding/demo/SamplingParams;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateText__JLjava_lang_String_2Lcom_livecoding_demo_SamplingParams_2
+  (JNIEnv *, jobject, jlong, jstring, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    generateText
+ * Signature: (JLjava/nio/ByteBuffer;ILcom/livecoding/demo/SamplingParams;Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_generateText__JLjava_nio_ByteBuffer_2ILcom_livecoding_demo_SamplingParams_2Ljava_nio_ByteBuffer_2
+  (JNIEnv *, jobject, jlong, jobject, jint, jobject, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    generateTextStreaming
+ * Signature: (JLjava/lang/String;Lcom/livecoding/demo/TokenCallback;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateTextStreaming__JLjava_lang_String_2Lcom_livecoding_demo_TokenCallback_2
+  (JNIEnv *, jobject, jlong, jstring, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    generateTextStreaming
+ * Signature: (JLjava/lang/String;Lcom/livecoding/demo/SamplingParams;Lcom/livecoding/demo/TokenCallback;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateTextStreaming__JLjava_lang_String_2Lcom_livecoding_demo_SamplingParams_2Lcom_livecoding_demo_TokenCallback_2
+  (JNIEnv *, jobject, jlong, jstring, jobject, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    generateChat
+ * Signature: (J[Ljava/lang/String;[Ljava/lang/String;Lcom/livecoding/demo/SamplingParams;)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateChat
+  (JNIEnv *, jobject, jlong, jobjectArray, jobjectArray, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    generateBatch
+ * Signature: (J[Ljava/lang/String;Lcom/livecoding/demo/SamplingParams;)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_livecoding_demo_LlamaJNI_generateBatch
+  (JNIEnv *, jobject, jlong, jobjectArray, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    getEmbeddingSize
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_getEmbeddingSize
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    embed
+ * Signature: (J[Ljava/lang/String;Ljava/nio/FloatBuffer;Z)I
+ */
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_embed
+  (JNIEnv *, jobject, jlong, jobjectArray, jobject, jboolean);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    countTokens
+ * Signature: (JLjava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_countTokens
+  (JNIEnv *, jobject, jlong, jstring);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    tokenize
+ * Signature: (JLjava/lang/String;)[I
+ */
+JNIEXPORT jintArray JNICALL Java_com_livecoding_demo_LlamaJNI_tokenize
+  (JNIEnv *, jobject, jlong, jstring);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    getContextSize
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_getContextSize
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    submitText
+ * Signature: (JLjava/lang/String;Lcom/livecoding/demo/SamplingParams;Lcom/livecoding/demo/CompletionListener;)J
+ */
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_submitText
+  (JNIEnv *, jobject, jlong, jstring, jobject, jobject);
+
+/*
+ * Class:     com_livecoding_demo_LlamaJNI
+ * Method:    cancel
+ * Signature: (JJ)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_livecoding_demo_LlamaJNI_cancel
+  (JNIEnv *, jobject, jlong, jlong);
+
 /*
  * Class:     com_livecoding_demo_LlamaJNI
  * Method:    unloadModel
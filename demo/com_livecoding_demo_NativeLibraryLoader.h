@@ -0,0 +1,21 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#include <jni.h>
+/* Header for class com_livecoding_demo_NativeLibraryLoader */
+
+#ifndef _Included_com_livecoding_demo_NativeLibraryLoader
+#define _Included_com_livecoding_demo_NativeLibraryLoader
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     com_livecoding_demo_NativeLibraryLoader
+ * Method:    isaLevel
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_NativeLibraryLoader_isaLevel
+  (JNIEnv *, jclass);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
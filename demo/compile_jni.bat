@@ -1,43 +1,30 @@
 @echo off
 setlocal
 
-echo Compiling LLaMA JNI wrapper...
+echo Building the LLaMA JNI libraries with CMake...
 
-REM Set paths (adjust these to match your system)
+REM Set paths (adjust these to match your system). LLAMA_PATH is a llama.cpp checkout; it is
+REM built once per CPU variant and linked into each llama_jni*.dll.
 set JAVA_HOME=C:\Program Files\Java\jdk-17
 set LLAMA_PATH=C:\Users\Volodymyr_Prudnikov\source\repos\LLAama\llama.cpp
-set MSVC_PATH="C:\Program Files\Microsoft Visual Studio\2022\Professional\VC\Tools\MSVC\14.40.33807\bin\Hostx64\x64"
 
 REM Initialize Visual Studio environment
 call "C:\Program Files\Microsoft Visual Studio\2022\Professional\VC\Auxiliary\Build\vcvars64.bat"
 
-REM Compile the JNI library
-cl.exe /LD ^
-    /I"%JAVA_HOME%\include" ^
-    /I"%JAVA_HOME%\include\win32" ^
-    /I"%LLAMA_PATH%\include" ^
-    /I"%LLAMA_PATH%" ^
-    /I"%LLAMA_PATH%\ggml\include" ^
-    llama_jni.c ^
-    /link ^
-    "%LLAMA_PATH%\build\src\Release\llama.lib" ^
-    "%LLAMA_PATH%\build\ggml\src\Release\ggml.lib" ^
-    /OUT:llama_jni.dll
+cmake -S . -B build -A x64 -DLLAMA_CPP_SOURCE_DIR="%LLAMA_PATH%" %*
+if %ERRORLEVEL% NEQ 0 goto failed
+cmake --build build --config Release --parallel
+if %ERRORLEVEL% NEQ 0 goto failed
 
-if %ERRORLEVEL% EQU 0 (
-    echo Compilation successful! llama_jni.dll created.
-    
-    REM Copy DLL to resources folder
-    copy llama_jni.dll src\main\resources\
-    if %ERRORLEVEL% EQU 0 (
-        echo DLL copied to resources folder.
-    ) else (
-        echo Failed to copy DLL to resources folder.
-    )
-) else (
-    echo Compilation failed!
-    exit /b 1
-)
+REM Copy the DLLs to the resources folder
+cmake --install build --config Release
+if %ERRORLEVEL% NEQ 0 goto failed
 
+echo Build successful! Libraries copied to src\main\resources.
 echo Done!
 pause
+exit /b 0
+
+:failed
+echo Build failed!
+exit /b 1
@@ -1,54 +1,25 @@
-# PowerShell script to compile JNI library
-Write-Host "Compiling LLaMA JNI wrapper..."
+# PowerShell script to build the JNI libraries with CMake (extra arguments go to the configure step)
+Write-Host "Building the LLaMA JNI libraries with CMake..."
 
-# Set paths
-$JAVA_HOME = "C:\Program Files\Java\jdk-17"
+# Set paths. LLAMA_PATH is a llama.cpp checkout, built once per CPU variant and linked into
+# each llama_jni*.dll.
+$env:JAVA_HOME = "C:\Program Files\Java\jdk-17"
 $LLAMA_PATH = "C:\Users\Volodymyr_Prudnikov\source\repos\LLAama\llama.cpp"
 
-# Initialize Visual Studio environment in this session
-$env:Path += ";C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Tools\MSVC\14.44.35211\bin\Hostx64\x64"
-$env:INCLUDE += ";C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Tools\MSVC\14.44.35211\include"
-$env:LIB += ";C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Tools\MSVC\14.44.35211\lib\x64"
+try {
+    & cmake -S . -B build -A x64 "-DLLAMA_CPP_SOURCE_DIR=$LLAMA_PATH" @args
+    if ($LASTEXITCODE -ne 0) { throw "configure failed" }
 
-# Set up Windows SDK paths
-$env:INCLUDE += ";C:\Program Files (x86)\Windows Kits\10\Include\10.0.22621.0\ucrt"
-$env:INCLUDE += ";C:\Program Files (x86)\Windows Kits\10\Include\10.0.22621.0\shared"
-$env:INCLUDE += ";C:\Program Files (x86)\Windows Kits\10\Include\10.0.22621.0\um"
-$env:LIB += ";C:\Program Files (x86)\Windows Kits\10\Lib\10.0.22621.0\ucrt\x64"
-$env:LIB += ";C:\Program Files (x86)\Windows Kits\10\Lib\10.0.22621.0\um\x64"
+    & cmake --build build --config Release --parallel
+    if ($LASTEXITCODE -ne 0) { throw "build failed" }
 
-# Compile the JNI library
-$compilerArgs = @(
-    "/LD",
-    "/I`"$JAVA_HOME\include`"",
-    "/I`"$JAVA_HOME\include\win32`"",
-    "/I`"$LLAMA_PATH\include`"",
-    "/I`"$LLAMA_PATH`"",
-    "/I`"$LLAMA_PATH\ggml\include`"",
-    "llama_jni.c",
-    "/link",
-    "`"$LLAMA_PATH\build\src\Release\llama.lib`"",
-    "`"$LLAMA_PATH\build\ggml\src\Release\ggml.lib`"",
-    "/OUT:llama_jni.dll"
-)
+    # Copy the DLLs to the resources folder
+    & cmake --install build --config Release
+    if ($LASTEXITCODE -ne 0) { throw "install failed" }
 
-try {
-    & "C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Tools\MSVC\14.44.35211\bin\Hostx64\x64\cl.exe" @compilerArgs
-    
-    if ($LASTEXITCODE -eq 0) {
-        Write-Host "Compilation successful! llama_jni.dll created."
-        
-        # Copy DLL to resources folder
-        if (Test-Path "llama_jni.dll") {
-            Copy-Item "llama_jni.dll" "src\main\resources\" -Force
-            Write-Host "DLL copied to resources folder."
-        }
-    } else {
-        Write-Host "Compilation failed!"
-        exit 1
-    }
+    Write-Host "Build successful! Libraries copied to src\main\resources."
 } catch {
-    Write-Host "Error running compiler: $_"
+    Write-Host "Build failed: $_"
     exit 1
 }
 
@@ -0,0 +1,1996 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ggml-cpu.h>
+#include "llama_engine.h"
+
+// Job arenas: initial response capacity, the largest response buffer an idle arena may keep,
+// and how many idle arenas are kept per sequence
+#define ARENA_OUTPUT_INITIAL 4096
+#define ARENA_OUTPUT_RETAIN (256 * 1024)
+#define ARENA_POOL_FACTOR 2
+
+// Prefix cache granularity: cached sequences are compared by chained hashes of token blocks
+#define PREFIX_BLOCK_TOKENS 32
+// Shorter matches are not worth evicting another sequence's cached prefix for
+#define PREFIX_MIN_REUSE PREFIX_BLOCK_TOKENS
+#define PREFIX_HASH_SEED 0xcbf29ce484222325ULL
+
+// Sampler chains kept per sequence; idle ones stay around for later jobs with the same settings
+#define SAMPLER_POOL_FACTOR 2
+
+#define SESSION_PATH_MAX 1024
+
+// Core sets (or NUMA nodes) a cpu_sets spec can name
+#define MAX_CORE_SETS 64
+
+typedef enum {
+    SLOT_IDLE,      // free; job != NULL means the dispatcher reserved it for a queued job
+    SLOT_START,     // admitted, cached prefix not yet trimmed to the new prompt
+    SLOT_PREFILL,   // prompt tokens still being decoded
+    SLOT_DECODE     // generating, one token per step
+} llama_slot_state;
+
+// A sampler chain built for one set of sampling parameters, lent to one job at a time
+typedef struct {
+    llama_sampling_params params;   // params.grammar points to the entry's own copy
+    struct llama_sampler *chain;
+    int in_use;
+    uint64_t last_used;
+} llama_sampler_entry;
+
+// KV state of a conversation whose sequence went to another job, kept until the
+// conversation's next turn restores it into whichever sequence that turn is given
+typedef struct llama_session {
+    uint64_t id;
+    llama_token *tokens;    // what the state holds, to match against the next prompt
+    int n_tokens;
+    uint8_t *state;         // llama_state_seq_get_data output, NULL once spilled to disk
+    size_t size;
+    int on_disk;
+    uint64_t generation;    // unique per saved copy; names its file, so no two copies share one
+    uint64_t last_used;
+    struct llama_session *next;
+} llama_session;
+
+// One sequence (seq_id) inside a worker context
+typedef struct {
+    llama_seq_id seq_id;
+    llama_slot_state state;
+    llama_job *job;
+    llama_sampler_entry *sampler;
+    int n_past;             // tokens of this sequence held in the KV cache
+    int n_prompt_done;      // prompt tokens already submitted to llama_decode
+    llama_token last_token; // sampled token to feed in the next step
+    int i_batch;            // logits row in the current batch, -1 when none
+    const char *abort;      // set with the lock held when the job must stop before the next step
+
+    // Speculative decoding
+    int draft_n_past;       // leading cache_tokens also held in the draft context's KV cache
+    llama_token *draft;     // tokens proposed this step, verified by the main model
+    int n_drafted;
+    int draft_limit;        // proposals allowed this step, 0 = not speculating
+    int draft_row;          // logits row in the current draft batch, -1 when none
+
+    // Prefix cache: the tokens behind the KV cells this sequence still holds
+    llama_token *cache_tokens;  // n_past entries
+    uint64_t *block_hashes;     // chained hash of each complete block of cache_tokens
+    int n_reuse;                // cached tokens the reserved job can keep
+    uint64_t last_used;
+    uint64_t session_id;        // conversation the cached tokens belong to, 0 = none
+} llama_seq_slot;
+
+// One pooled context, driven by its own scheduler thread
+typedef struct {
+    llama_engine *engine;
+    struct llama_context *ctx;
+    struct llama_batch batch;
+    int n_batch;
+    int n_prefill_chunk;
+    int prefill_cursor;     // slot that gets the prefill budget first, rotated every step
+    struct llama_context *draft_ctx;    // same sequences as ctx, evaluated by the draft model
+    struct llama_batch draft_batch;
+    int n_draft;
+    llama_seq_slot *slots;
+    int n_slots;
+    int n_active;
+    jni_thread_t thread;
+    int thread_started;
+    int warmup;             // the scheduler thread runs the warmup decode before its first job
+
+    // Compute threads, pinned to the n_cpus cores in cpumask unless n_cpus is 0. threadpool_batch
+    // is threadpool itself when prompts use as many threads as generation.
+    bool cpumask[GGML_MAX_N_THREADS];
+    int n_cpus;
+    int n_threads;
+    int n_threads_batch;
+    ggml_threadpool_t threadpool;
+    ggml_threadpool_t threadpool_batch;
+
+    // Published by the scheduler thread each step for llama_engine_get_stats, guarded by lock
+    struct llama_perf_context_data perf;
+    int n_kv_used;
+} llama_worker;
+
+struct llama_engine {
+    struct llama_model *model;
+    const struct llama_vocab *vocab;
+    llama_worker *workers;
+    int n_workers;
+    int n_seq_per_worker;
+    int n_ctx_per_seq;
+    int64_t deadline_us;    // default job time limit, 0 = none
+    int context_shift;
+    int n_keep;             // leading tokens a context shift or prompt truncation keeps, BOS included
+    struct llama_model *draft_model;
+    int n_draft_vocab;
+
+    // Text of every token, piece t at pieces + piece_offsets[t] up to piece_offsets[t + 1];
+    // NULL when it could not be built, then pieces are decoded per token
+    char *pieces;
+    int32_t *piece_offsets;
+    int n_pieces;
+
+    // Guards the queue, slot reservation, worker occupancy and job completion state
+    jni_mutex_t lock;
+    jni_cond_t work_cond;
+    llama_job *queue_head;
+    llama_job *queue_tail;
+    int running;
+    int n_starting;         // scheduler threads still warming up, waited for by llama_engine_create
+    llama_engine_stats stats;   // counters only; the gauges are filled in by llama_engine_get_stats
+
+    // Dispatcher scratch space, sampler pool and LRU clock, only used with lock held
+    uint64_t *job_hashes;
+    llama_sampler_entry *samplers;
+    int n_samplers;
+    uint64_t tick;
+
+    // Idle job arenas, guarded by lock
+    llama_job_arena *free_arenas;
+    int n_free_arenas;
+    int max_free_arenas;
+
+    // Saved conversations, guarded by lock; the state itself is copied with it released
+    llama_session *sessions;
+    size_t session_mem_used;
+    size_t session_mem_budget;
+    size_t session_disk_used;
+    size_t session_disk_budget;
+    char session_dir[SESSION_PATH_MAX];
+};
+
+void llama_engine_default_params(llama_engine_params *params) {
+    params->n_contexts = DEFAULT_CONTEXT_POOL_SIZE;
+    params->n_seq_per_context = DEFAULT_SEQUENCES_PER_CONTEXT;
+    params->n_ctx_per_seq = DEFAULT_CONTEXT_LENGTH;
+    params->n_threads = DEFAULT_THREADS;
+    params->n_threads_batch = 0;
+    params->cpu_sets = NULL;
+    params->n_batch = DEFAULT_BATCH_SIZE;
+    params->n_ubatch = DEFAULT_UBATCH_SIZE;
+    params->n_prefill_chunk = DEFAULT_PREFILL_CHUNK;
+    params->flash_attn = 0;
+    params->deadline_ms = 0;
+    params->draft_model = NULL;
+    params->n_draft = DEFAULT_DRAFT_TOKENS;
+    params->session_memory_mb = DEFAULT_SESSION_MEMORY_MB;
+    params->session_disk_mb = 0;
+    params->session_dir = NULL;
+    params->warmup = 0;
+    params->context_shift = 0;
+    params->n_keep = 0;
+}
+
+void llama_sampling_default_params(llama_sampling_params *params) {
+    params->temperature = DEFAULT_TEMPERATURE;
+    params->top_k = DEFAULT_TOP_K;
+    params->top_p = DEFAULT_TOP_P;
+    params->seed = DEFAULT_SEED;
+    params->grammar = NULL;
+}
+
+void llama_job_init(llama_job *job) {
+    memset(job, 0, sizeof(*job));
+    llama_sampling_default_params(&job->sampling);
+    jni_cond_init(&job->done_cond);
+}
+
+void llama_job_destroy(llama_job *job) {
+    jni_cond_destroy(&job->done_cond);
+}
+
+static struct llama_sampler* create_sampler_chain(const llama_engine *engine, const llama_sampling_params *params) {
+    struct llama_sampler_chain_params sparams = llama_sampler_chain_default_params();
+    struct llama_sampler *sampler = llama_sampler_chain_init(sparams);
+    if (sampler == NULL) {
+        return NULL;
+    }
+
+    // The grammar goes first so every later layer only sees tokens it allows
+    if (params->grammar != NULL) {
+        struct llama_sampler *grammar = llama_sampler_init_grammar(engine->vocab, params->grammar, "root");
+        if (grammar == NULL) {
+            llama_sampler_free(sampler);
+            return NULL;
+        }
+        llama_sampler_chain_add(sampler, grammar);
+    }
+
+    if (params->temperature <= 0.0f) {
+        llama_sampler_chain_add(sampler, llama_sampler_init_greedy());
+        return sampler;
+    }
+
+    // Add sampling layers to the chain
+    if (params->top_k > 0) {
+        llama_sampler_chain_add(sampler, llama_sampler_init_top_k(params->top_k));
+    }
+    if (params->top_p < 1.0f) {
+        llama_sampler_chain_add(sampler, llama_sampler_init_top_p(params->top_p, 1));
+    }
+    llama_sampler_chain_add(sampler, llama_sampler_init_temp(params->temperature));
+    llama_sampler_chain_add(sampler, llama_sampler_init_dist(params->seed));
+    return sampler;
+}
+
+static int sampling_params_equal(const llama_sampling_params *a, const llama_sampling_params *b) {
+    return a->temperature == b->temperature && a->top_k == b->top_k
+        && a->top_p == b->top_p && a->seed == b->seed
+        && (a->grammar == NULL ? b->grammar == NULL : b->grammar != NULL && strcmp(a->grammar, b->grammar) == 0);
+}
+
+// Called with engine->lock held: lend out an idle chain built for these parameters, building
+// one in place of the least recently used idle chain when none matches. The pool is larger
+// than the number of sequences, so an idle entry always exists.
+static llama_sampler_entry* acquire_sampler(llama_engine *engine, const llama_sampling_params *params) {
+    llama_sampler_entry *victim = NULL;
+    for (int i = 0; i < engine->n_samplers; i++) {
+        llama_sampler_entry *entry = &engine->samplers[i];
+        if (entry->in_use) {
+            continue;
+        }
+        if (entry->chain != NULL && sampling_params_equal(&entry->params, params)) {
+            entry->in_use = 1;
+            entry->last_used = ++engine->tick;
+            return entry;
+        }
+        if (victim == NULL || (victim->chain != NULL
+                && (entry->chain == NULL || entry->last_used < victim->last_used))) {
+            victim = entry;
+        }
+    }
+
+    if (victim == NULL) {
+        return NULL;
+    }
+    if (victim->chain != NULL) {
+        llama_sampler_free(victim->chain);
+        victim->chain = NULL;
+    }
+    free((char*)victim->params.grammar);
+    victim->params = *params;
+    if (params->grammar != NULL) {
+        size_t len = strlen(params->grammar) + 1;
+        char *grammar = (char*)malloc(len);
+        if (grammar == NULL) {
+            victim->params.grammar = NULL;
+            return NULL;
+        }
+        victim->params.grammar = (const char*)memcpy(grammar, params->grammar, len);
+    }
+    victim->chain = create_sampler_chain(engine, &victim->params);
+    if (victim->chain == NULL) {
+        return NULL;
+    }
+    victim->in_use = 1;
+    victim->last_used = ++engine->tick;
+    return victim;
+}
+
+// Called with engine->lock held: rewind the chain's RNG and grammar so the next job starts afresh
+static void release_sampler(llama_sampler_entry *entry) {
+    llama_sampler_reset(entry->chain);
+    entry->in_use = 0;
+}
+
+static void batch_add(struct llama_batch *batch, llama_token token, llama_pos pos, llama_seq_id seq_id, int logits) {
+    int i = batch->n_tokens;
+    batch->token[i] = token;
+    batch->pos[i] = pos;
+    batch->n_seq_id[i] = 1;
+    batch->seq_id[i][0] = seq_id;
+    batch->logits[i] = (int8_t)logits;
+    batch->n_tokens++;
+}
+
+static uint64_t hash_tokens(uint64_t hash, const llama_token *tokens, int n_tokens) {
+    const unsigned char *bytes = (const unsigned char*)tokens;
+    for (size_t i = 0; i < n_tokens * sizeof(llama_token); i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Record a token that was just placed in the batch for this sequence
+static void slot_push_token(llama_seq_slot *slot, llama_token token) {
+    slot->cache_tokens[slot->n_past++] = token;
+
+    if (slot->n_past % PREFIX_BLOCK_TOKENS == 0) {
+        int block = slot->n_past / PREFIX_BLOCK_TOKENS - 1;
+        uint64_t prev = block > 0 ? slot->block_hashes[block - 1] : PREFIX_HASH_SEED;
+        slot->block_hashes[block] = hash_tokens(prev, slot->cache_tokens + block * PREFIX_BLOCK_TOKENS, PREFIX_BLOCK_TOKENS);
+    }
+}
+
+static void slot_clear_cache(llama_worker *worker, llama_seq_slot *slot) {
+    llama_memory_seq_rm(llama_get_memory(worker->ctx), slot->seq_id, -1, -1);
+    slot->n_past = 0;
+    slot->session_id = 0;
+    if (worker->draft_ctx != NULL) {
+        llama_memory_seq_rm(llama_get_memory(worker->draft_ctx), slot->seq_id, -1, -1);
+        slot->draft_n_past = 0;
+    }
+}
+
+// Drop draft cache entries past the main sequence, e.g. proposals the main model rejected
+static void slot_trim_draft(llama_worker *worker, llama_seq_slot *slot) {
+    if (worker->draft_ctx == NULL || slot->draft_n_past <= slot->n_past) {
+        return;
+    }
+    if (!llama_memory_seq_rm(llama_get_memory(worker->draft_ctx), slot->seq_id, slot->n_past, -1)) {
+        llama_memory_seq_rm(llama_get_memory(worker->draft_ctx), slot->seq_id, -1, -1);
+        slot->draft_n_past = 0;
+        return;
+    }
+    slot->draft_n_past = slot->n_past;
+}
+
+static void slot_rehash(llama_seq_slot *slot) {
+    uint64_t hash = PREFIX_HASH_SEED;
+    for (int b = 0; b < slot->n_past / PREFIX_BLOCK_TOKENS; b++) {
+        hash = hash_tokens(hash, slot->cache_tokens + b * PREFIX_BLOCK_TOKENS, PREFIX_BLOCK_TOKENS);
+        slot->block_hashes[b] = hash;
+    }
+}
+
+// The sequence filled its window: drop the older half of what follows the kept head from the
+// KV cache and move the rest down, so generation goes on without evaluating anything again.
+// The draft cache gets the same shift. Returns -1 when there is nothing left to drop.
+static int slot_shift(llama_worker *worker, llama_seq_slot *slot) {
+    llama_engine *engine = worker->engine;
+    int n_keep = engine->n_keep;
+    int n_discard = (slot->n_past - n_keep) / 2;
+    llama_memory_t mem = llama_get_memory(worker->ctx);
+    if (n_discard <= 0 || !llama_memory_seq_rm(mem, slot->seq_id, n_keep, n_keep + n_discard)) {
+        return -1;
+    }
+    llama_memory_seq_add(mem, slot->seq_id, n_keep + n_discard, slot->n_past, -n_discard);
+
+    memmove(slot->cache_tokens + n_keep, slot->cache_tokens + n_keep + n_discard,
+            (slot->n_past - n_keep - n_discard) * sizeof(llama_token));
+    slot->n_past -= n_discard;
+    slot_rehash(slot);
+
+    if (worker->draft_ctx != NULL && slot->draft_n_past > n_keep) {
+        llama_memory_t draft = llama_get_memory(worker->draft_ctx);
+        if (slot->draft_n_past > n_keep + n_discard) {
+            llama_memory_seq_rm(draft, slot->seq_id, n_keep, n_keep + n_discard);
+            llama_memory_seq_add(draft, slot->seq_id, n_keep + n_discard, slot->draft_n_past, -n_discard);
+            slot->draft_n_past -= n_discard;
+        } else {
+            llama_memory_seq_rm(draft, slot->seq_id, n_keep, -1);
+            slot->draft_n_past = n_keep;
+        }
+    }
+
+    slot->job->n_shifts++;
+    slot->job->n_discarded += n_discard;
+    return 0;
+}
+
+// Number of leading prompt tokens already present in the slot's KV cache
+static int prefix_match(const llama_seq_slot *slot, const llama_job *job, const uint64_t *job_hashes, int n_job_blocks) {
+    int n_blocks = slot->n_past / PREFIX_BLOCK_TOKENS;
+    if (n_blocks > n_job_blocks) {
+        n_blocks = n_job_blocks;
+    }
+
+    int block = 0;
+    while (block < n_blocks && slot->block_hashes[block] == job_hashes[block]) {
+        block++;
+    }
+
+    // Confirm the hashed blocks and extend into the first partial block token by token
+    int n_match = block * PREFIX_BLOCK_TOKENS;
+    if (n_match > 0 && memcmp(slot->cache_tokens, job->tokens, n_match * sizeof(llama_token)) != 0) {
+        n_match = 0;
+    }
+
+    int limit = slot->n_past < job->n_tokens ? slot->n_past : job->n_tokens;
+    while (n_match < limit && slot->cache_tokens[n_match] == job->tokens[n_match]) {
+        n_match++;
+    }
+
+    // The last prompt token is always decoded again so its logits are available
+    if (n_match >= job->n_tokens) {
+        n_match = job->n_tokens - 1;
+    }
+    return n_match;
+}
+
+// Called with engine->lock held: add a finished job to the metrics
+static void record_job(llama_engine *engine, const llama_job *job, const char *error) {
+    llama_engine_stats *stats = &engine->stats;
+    stats->n_jobs++;
+    if (error != NULL) {
+        stats->n_jobs_failed++;
+    }
+    stats->n_generated += (uint64_t)job->n_generated;
+    stats->n_draft_proposed += (uint64_t)job->n_draft_proposed;
+    stats->n_draft_accepted += (uint64_t)job->n_draft_accepted;
+    stats->n_context_shifts += (uint64_t)job->n_shifts;
+    stats->n_tokens_discarded += (uint64_t)job->n_discarded + (uint64_t)job->n_truncated;
+    if (job->t_start_us == 0) {
+        return;
+    }
+
+    stats->n_started++;
+    stats->t_queue_us += job->t_start_us - job->t_submit_us;
+    if (job->t_first_us == 0) {
+        return;
+    }
+
+    stats->n_prefilled++;
+    stats->t_prefill_us += job->t_first_us - job->t_start_us;
+    stats->t_first_token_us += job->t_first_us - job->t_submit_us;
+    stats->t_decode_us += llama_time_us() - job->t_first_us;
+    stats->n_prompt_tokens += (uint64_t)(job->n_tokens - job->n_prompt_reused);
+    stats->n_prompt_reused += (uint64_t)job->n_prompt_reused;
+    if (job->n_generated > 1) {
+        stats->n_decoded += (uint64_t)(job->n_generated - 1);
+    }
+}
+
+// Called with engine->lock held: publish the result and wake whoever waits for the job.
+// Once this returns the submitter may free the job.
+static void complete_job(llama_engine *engine, llama_job *job, const char *error) {
+    record_job(engine, job, error);
+    job->error = error;
+    job->output_ready = job->output_len;
+    job->done = 1;
+    jni_cond_signal(&job->done_cond);
+    if (job->on_done != NULL) {
+        job->on_done(job, job->user_data);
+    }
+}
+
+// Called with engine->lock held: reserve an idle sequence for each queued job, preferring
+// the one whose cached prefix matches the prompt longest, otherwise the least recently used
+// sequence of the least loaded context
+static void dispatch_jobs(llama_engine *engine) {
+    int dispatched = 0;
+    int64_t now = llama_time_us();
+
+    while (engine->running && engine->queue_head != NULL) {
+        llama_job *job = engine->queue_head;
+
+        // Don't spend a sequence on a job whose caller has already given up
+        if (job->deadline_us != 0 && now >= job->deadline_us) {
+            engine->queue_head = job->next;
+            if (engine->queue_head == NULL) {
+                engine->queue_tail = NULL;
+            }
+            complete_job(engine, job, "Deadline exceeded");
+            continue;
+        }
+
+        int n_job_blocks = job->n_tokens / PREFIX_BLOCK_TOKENS;
+        uint64_t hash = PREFIX_HASH_SEED;
+        for (int b = 0; b < n_job_blocks; b++) {
+            hash = hash_tokens(hash, job->tokens + b * PREFIX_BLOCK_TOKENS, PREFIX_BLOCK_TOKENS);
+            engine->job_hashes[b] = hash;
+        }
+
+        llama_worker *best_worker = NULL;
+        llama_seq_slot *best_slot = NULL;
+        int best_match = -1;
+        llama_worker *lru_worker = NULL;
+        llama_seq_slot *lru_slot = NULL;
+
+        for (int w = 0; w < engine->n_workers; w++) {
+            llama_worker *worker = &engine->workers[w];
+            for (int i = 0; i < worker->n_slots; i++) {
+                llama_seq_slot *slot = &worker->slots[i];
+                if (slot->state != SLOT_IDLE || slot->job != NULL) {
+                    continue;
+                }
+
+                int n_match = prefix_match(slot, job, engine->job_hashes, n_job_blocks);
+                if (n_match > best_match) {
+                    best_match = n_match;
+                    best_worker = worker;
+                    best_slot = slot;
+                }
+
+                if (lru_slot == NULL || worker->n_active < lru_worker->n_active
+                        || (worker == lru_worker && slot->last_used < lru_slot->last_used)) {
+                    lru_worker = worker;
+                    lru_slot = slot;
+                }
+            }
+        }
+
+        if (best_slot == NULL) {
+            break; // every sequence is busy; the job waits until one finishes
+        }
+
+        if (best_match < PREFIX_MIN_REUSE) {
+            best_worker = lru_worker;
+            best_slot = lru_slot;
+            best_match = prefix_match(best_slot, job, engine->job_hashes, n_job_blocks);
+        }
+
+        engine->queue_head = job->next;
+        if (engine->queue_head == NULL) {
+            engine->queue_tail = NULL;
+        }
+        job->next = NULL;
+
+        llama_sampler_entry *sampler = acquire_sampler(engine, &job->sampling);
+        if (sampler == NULL) {
+            complete_job(engine, job, job->sampling.grammar != NULL ? "Invalid grammar" : "Failed to create sampler");
+            continue;
+        }
+
+        best_slot->job = job;
+        best_slot->sampler = sampler;
+        best_slot->n_reuse = best_match;
+        best_slot->last_used = ++engine->tick;
+        best_worker->n_active++;
+        dispatched = 1;
+    }
+
+    if (dispatched) {
+        jni_cond_broadcast(&engine->work_cond);
+    }
+}
+
+// Called with engine->lock held: start the jobs the dispatcher reserved on this worker
+static void admit_jobs(llama_worker *worker) {
+    for (int i = 0; i < worker->n_slots; i++) {
+        llama_seq_slot *slot = &worker->slots[i];
+        if (slot->state == SLOT_IDLE && slot->job != NULL) {
+            slot->state = SLOT_START;
+        }
+    }
+}
+
+// Called with engine->lock held: flag sequences whose job was cancelled or ran out of time.
+// The scheduler finishes them before building the next batch, at a point where each slot's
+// KV cache matches its cached tokens, so the prefix stays reusable.
+static void abort_jobs(llama_worker *worker) {
+    int64_t now = 0;
+    for (int i = 0; i < worker->n_slots; i++) {
+        llama_seq_slot *slot = &worker->slots[i];
+        llama_job *job = slot->job;
+        if (job == NULL || slot->state == SLOT_IDLE) {
+            continue;
+        }
+        if (job->cancelled) {
+            slot->abort = "Cancelled";
+        } else if (job->deadline_us != 0) {
+            if (now == 0) {
+                now = llama_time_us();
+            }
+            if (now >= job->deadline_us) {
+                slot->abort = "Deadline exceeded";
+            }
+        }
+    }
+}
+
+// ---- Session store ----
+
+// Each copy owns its file: a spill never rewrites a file another copy (or a restore mapping
+// it) still uses. The engine address keeps engines sharing the directory apart.
+static void session_path(const llama_engine *engine, const llama_session *session, char *path, size_t size) {
+    snprintf(path, size, "%s/session-%016llx-%llx-%llu.kv", engine->session_dir,
+            (unsigned long long)session->id, (unsigned long long)(uintptr_t)engine,
+            (unsigned long long)session->generation);
+}
+
+static void session_free(const llama_engine *engine, llama_session *session) {
+    if (session->on_disk) {
+        char path[SESSION_PATH_MAX + 80];
+        session_path(engine, session, path, sizeof(path));
+        remove(path);
+    }
+    free(session->tokens);
+    free(session->state);
+    free(session);
+}
+
+static void session_free_list(const llama_engine *engine, llama_session *list) {
+    while (list != NULL) {
+        llama_session *next = list->next;
+        session_free(engine, list);
+        list = next;
+    }
+}
+
+static size_t session_mem_size(const llama_session *session) {
+    return session->size + session->n_tokens * sizeof(llama_token);
+}
+
+// Called with engine->lock held: remove a session from the store and stop counting it
+static void session_unlink(llama_engine *engine, llama_session *session) {
+    for (llama_session **link = &engine->sessions; *link != NULL; link = &(*link)->next) {
+        if (*link == session) {
+            *link = session->next;
+            break;
+        }
+    }
+    session->next = NULL;
+    if (session->on_disk) {
+        engine->session_disk_used -= session->size;
+    } else {
+        engine->session_mem_used -= session_mem_size(session);
+    }
+}
+
+// Called with engine->lock held: the least recently used session in memory or on disk
+static llama_session* session_lru(llama_engine *engine, int on_disk) {
+    llama_session *lru = NULL;
+    for (llama_session *s = engine->sessions; s != NULL; s = s->next) {
+        if (s->on_disk == on_disk && (lru == NULL || s->last_used < lru->last_used)) {
+            lru = s;
+        }
+    }
+    return lru;
+}
+
+// Called with engine->lock held: hand out the saved state of a conversation; the caller
+// restores and frees it
+static llama_session* session_take(llama_engine *engine, uint64_t id) {
+    for (llama_session *s = engine->sessions; s != NULL; s = s->next) {
+        if (s->id == id) {
+            session_unlink(engine, s);
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// Called with engine->lock held: drop any older copy of the conversation
+static void session_drop(llama_engine *engine, uint64_t id, llama_session **garbage) {
+    llama_session *old = session_take(engine, id);
+    if (old != NULL) {
+        old->next = *garbage;
+        *garbage = old;
+    }
+}
+
+static int session_write(const llama_engine *engine, llama_session *session) {
+    char path[SESSION_PATH_MAX + 80];
+    session_path(engine, session, path, sizeof(path));
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    int ok = fwrite(session->state, 1, session->size, file) == session->size;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+// Move a session evicted from memory to disk, evicting older files to stay within budget.
+// The file is written with the lock released; a turn arriving meanwhile just re-prefills.
+static void session_spill(llama_engine *engine, llama_session *session) {
+    llama_session *garbage = NULL;
+    if (session_write(engine, session) != 0) {
+        free(session->state);
+        session->state = NULL;
+        session_free(engine, session);
+        return;
+    }
+    free(session->state);
+    session->state = NULL;
+    session->on_disk = 1;
+
+    jni_mutex_lock(&engine->lock);
+    int superseded = 0;
+    for (llama_session *s = engine->sessions; s != NULL; s = s->next) {
+        superseded |= s->id == session->id;
+    }
+    if (superseded) {
+        // A newer copy was saved meanwhile; this one's file is its own and goes with it
+        session->next = garbage;
+        garbage = session;
+    } else {
+        while (engine->session_disk_used + session->size > engine->session_disk_budget) {
+            llama_session *victim = session_lru(engine, 1);
+            session_unlink(engine, victim);
+            victim->next = garbage;
+            garbage = victim;
+        }
+        session->next = engine->sessions;
+        engine->sessions = session;
+        engine->session_disk_used += session->size;
+    }
+    jni_mutex_unlock(&engine->lock);
+
+    session_free_list(engine, garbage);
+}
+
+// Keep the conversation cached in the slot before the slot's KV cells are reused. The state
+// is copied without the engine lock; only the bookkeeping takes it.
+static void session_save(llama_worker *worker, llama_seq_slot *slot) {
+    llama_engine *engine = worker->engine;
+    llama_session *session = (llama_session*)calloc(1, sizeof(llama_session));
+    if (session == NULL) {
+        return;
+    }
+    session->id = slot->session_id;
+    session->n_tokens = slot->n_past;
+    session->tokens = (llama_token*)malloc(slot->n_past * sizeof(llama_token));
+    size_t size = llama_state_seq_get_size(worker->ctx, slot->seq_id);
+    session->state = (uint8_t*)malloc(size);
+    if (session->tokens == NULL || session->state == NULL) {
+        session_free(engine, session);
+        return;
+    }
+    memcpy(session->tokens, slot->cache_tokens, slot->n_past * sizeof(llama_token));
+    session->size = llama_state_seq_get_data(worker->ctx, session->state, size, slot->seq_id);
+    if (session->size == 0) {
+        session_free(engine, session);
+        return;
+    }
+
+    llama_session *garbage = NULL;
+    llama_session *spill = NULL;
+    jni_mutex_lock(&engine->lock);
+    session_drop(engine, session->id, &garbage);
+    session->last_used = ++engine->tick;
+    session->generation = session->last_used;
+    session->next = engine->sessions;
+    engine->sessions = session;
+    engine->session_mem_used += session_mem_size(session);
+
+    // Over budget: the least recently used conversations go to disk, or are forgotten
+    while (engine->session_mem_used > engine->session_mem_budget) {
+        llama_session *victim = session_lru(engine, 0);
+        session_unlink(engine, victim);
+        if (engine->session_dir[0] != '\0' && victim->size <= engine->session_disk_budget) {
+            victim->next = spill;
+            spill = victim;
+        } else {
+            victim->next = garbage;
+            garbage = victim;
+        }
+    }
+    jni_mutex_unlock(&engine->lock);
+
+    session_free_list(engine, garbage);
+    while (spill != NULL) {
+        llama_session *next = spill->next;
+        session_spill(engine, spill);
+        spill = next;
+    }
+}
+
+// Load the conversation's saved state into the slot when it covers more of the prompt than
+// what the slot already caches. A saved state that matches no better is stale and dropped.
+static void session_restore(llama_worker *worker, llama_seq_slot *slot) {
+    llama_engine *engine = worker->engine;
+    llama_job *job = slot->job;
+
+    jni_mutex_lock(&engine->lock);
+    llama_session *session = session_take(engine, job->session_id);
+    jni_mutex_unlock(&engine->lock);
+    if (session == NULL) {
+        return;
+    }
+
+    int limit = session->n_tokens < job->n_tokens - 1 ? session->n_tokens : job->n_tokens - 1;
+    int n_match = 0;
+    while (n_match < limit && session->tokens[n_match] == job->tokens[n_match]) {
+        n_match++;
+    }
+
+    if (n_match > slot->n_reuse) {
+        const uint8_t *state = session->state;
+        void *mapped = NULL;
+        size_t mapped_size = 0;
+        if (session->on_disk) {
+            char path[SESSION_PATH_MAX + 80];
+            session_path(engine, session, path, sizeof(path));
+            mapped = jni_map_file(path, &mapped_size);
+            state = (const uint8_t*)mapped;
+        }
+
+        slot_clear_cache(worker, slot);
+        if (state != NULL && llama_state_seq_set_data(worker->ctx, state, session->size, slot->seq_id) != 0) {
+            memcpy(slot->cache_tokens, session->tokens, session->n_tokens * sizeof(llama_token));
+            slot->n_past = session->n_tokens;
+            slot_rehash(slot);
+            slot->n_reuse = n_match;
+        } else {
+            slot_clear_cache(worker, slot);
+            slot->n_reuse = 0;
+        }
+
+        if (mapped != NULL) {
+            jni_unmap_file(mapped, mapped_size);
+        }
+    }
+    session_free(engine, session);
+}
+
+// Drop the part of the cached sequence that diverges from the new prompt
+static void start_sequence(llama_worker *worker, llama_seq_slot *slot) {
+    llama_engine *engine = worker->engine;
+    llama_job *job = slot->job;
+
+    // Another conversation's cache is about to be overwritten: keep it for its next turn
+    if (slot->session_id != 0 && slot->session_id != job->session_id && slot->n_past > slot->n_reuse
+            && engine->session_mem_budget > 0) {
+        session_save(worker, slot);
+    }
+    if (job->session_id != 0 && job->session_id != slot->session_id) {
+        session_restore(worker, slot);
+    }
+    slot->session_id = job->session_id;
+
+    if (slot->n_past > slot->n_reuse
+            && !llama_memory_seq_rm(llama_get_memory(worker->ctx), slot->seq_id, slot->n_reuse, -1)) {
+        slot_clear_cache(worker, slot);
+        slot->n_reuse = 0;
+    }
+
+    slot->n_past = slot->n_reuse;
+    slot->n_prompt_done = slot->n_reuse;
+    slot->state = SLOT_PREFILL;
+    job->t_start_us = llama_time_us();
+    job->n_prompt_reused = slot->n_reuse;
+    slot_trim_draft(worker, slot);
+}
+
+// Completes the job bound to the slot and returns the sequence to the idle set.
+// The sequence keeps its KV cells so a later prompt with the same prefix can reuse them.
+static void finish_slot(llama_worker *worker, llama_seq_slot *slot, const char *error) {
+    llama_engine *engine = worker->engine;
+    llama_job *job = slot->job;
+
+    job->output[job->output_len] = '\0';
+
+    jni_mutex_lock(&engine->lock);
+    release_sampler(slot->sampler);
+    slot->sampler = NULL;
+    slot->job = NULL;
+    slot->state = SLOT_IDLE;
+    worker->n_active--;
+    complete_job(engine, job, error);
+    dispatch_jobs(engine);
+    jni_mutex_unlock(&engine->lock);
+}
+
+// Make room for `extra` more response bytes plus the terminator. The buffer only moves with
+// the engine lock held, which is also when streaming readers copy out of it.
+static int reserve_output(llama_engine *engine, llama_job *job, size_t extra) {
+    size_t need = job->output_len + extra + 1;
+    if (need <= job->output_cap) {
+        return 0;
+    }
+    if (job->output_fixed) {
+        return -1;
+    }
+
+    size_t cap = job->output_cap > 0 ? job->output_cap : ARENA_OUTPUT_INITIAL;
+    while (cap < need) {
+        cap *= 2;
+    }
+
+    jni_mutex_lock(&engine->lock);
+    char *output = (char*)realloc(job->output, cap);
+    if (output != NULL) {
+        job->output = output;
+        job->output_cap = cap;
+        if (job->arena != NULL) {
+            job->arena->output = output;
+            job->arena->output_cap = cap;
+        }
+    }
+    jni_mutex_unlock(&engine->lock);
+    return output != NULL ? 0 : -1;
+}
+
+// Decode the text of a sampled token straight into the job's response buffer, growing it
+// when the piece does not fit
+static int append_piece(llama_engine *engine, llama_job *job, llama_token token) {
+    if (engine->pieces != NULL && token >= 0 && token < engine->n_pieces) {
+        size_t len = (size_t)(engine->piece_offsets[token + 1] - engine->piece_offsets[token]);
+        if (len > 0) {
+            if (reserve_output(engine, job, len) != 0) {
+                return -1;
+            }
+            memcpy(job->output + job->output_len, engine->pieces + engine->piece_offsets[token], len);
+            job->output_len += len;
+        }
+        return 0;
+    }
+
+    int32_t room = (int32_t)(job->output_cap - job->output_len - 1);
+    int token_len = llama_token_to_piece(engine->vocab, token, job->output + job->output_len, room, 0, false);
+    if (token_len < 0) {
+        if (reserve_output(engine, job, (size_t)-token_len) != 0) {
+            return -1;
+        }
+        room = (int32_t)(job->output_cap - job->output_len - 1);
+        token_len = llama_token_to_piece(engine->vocab, token, job->output + job->output_len, room, 0, false);
+    }
+
+    if (token_len > 0) {
+        job->output_len += token_len;
+    }
+    return 0;
+}
+
+static llama_token draft_argmax(llama_worker *worker, int row) {
+    const float *logits = llama_get_logits_ith(worker->draft_ctx, row);
+    int n_vocab = worker->engine->n_draft_vocab;
+    llama_token best = 0;
+    for (llama_token t = 1; t < n_vocab; t++) {
+        if (logits[t] > logits[best]) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+// The draft cache can no longer be trusted after a failed decode: rebuild it from scratch
+static void draft_reset(llama_worker *worker) {
+    llama_memory_seq_rm(llama_get_memory(worker->draft_ctx), -1, -1, -1);
+    for (int i = 0; i < worker->n_slots; i++) {
+        worker->slots[i].draft_n_past = 0;
+        worker->slots[i].n_drafted = 0;
+    }
+}
+
+// Speculative decoding: the draft model greedily proposes up to n_draft tokens for every
+// generating sequence, one batched draft decode per proposed position. The first decode also
+// feeds the draft whatever the main sequence gained since the last step (prompt chunks and
+// accepted tokens), so each draft sequence never trails its main sequence by much.
+static void draft_step(llama_worker *worker) {
+    llama_engine *engine = worker->engine;
+    struct llama_batch *batch = &worker->draft_batch;
+    batch->n_tokens = 0;
+
+    int n_speculating = 0;
+    for (int i = 0; i < worker->n_slots; i++) {
+        llama_seq_slot *slot = &worker->slots[i];
+        slot->n_drafted = 0;
+        slot->draft_limit = 0;
+        slot->draft_row = -1;
+        if (slot->state != SLOT_PREFILL && slot->state != SLOT_DECODE) {
+            continue;
+        }
+
+        while (slot->draft_n_past < slot->n_past && batch->n_tokens < worker->n_batch) {
+            batch_add(batch, slot->cache_tokens[slot->draft_n_past], slot->draft_n_past, slot->seq_id, 0);
+            slot->draft_n_past++;
+        }
+
+        // Propose no more than the job may still generate or the sequence can hold
+        if (slot->state != SLOT_DECODE || slot->draft_n_past < slot->n_past
+                || batch->n_tokens >= worker->n_batch) {
+            continue;
+        }
+        llama_job *job = slot->job;
+        int limit = worker->n_draft;
+        if (limit > job->max_tokens - job->n_generated - 1) {
+            limit = job->max_tokens - job->n_generated - 1;
+        }
+        if (limit > engine->n_ctx_per_seq - slot->n_past - 1) {
+            limit = engine->n_ctx_per_seq - slot->n_past - 1;
+        }
+        if (limit <= 0) {
+            continue;
+        }
+        slot->draft_limit = limit;
+        slot->draft_row = batch->n_tokens;
+        batch_add(batch, slot->last_token, slot->n_past, slot->seq_id, 1);
+        slot->draft_n_past++;
+        n_speculating++;
+    }
+
+    while (batch->n_tokens > 0) {
+        if (llama_decode(worker->draft_ctx, *batch) != 0) {
+            draft_reset(worker);
+            return;
+        }
+        if (n_speculating == 0) {
+            return;
+        }
+
+        batch->n_tokens = 0;
+        n_speculating = 0;
+        for (int i = 0; i < worker->n_slots; i++) {
+            llama_seq_slot *slot = &worker->slots[i];
+            if (slot->draft_row < 0) {
+                continue;
+            }
+            llama_token token = draft_argmax(worker, slot->draft_row);
+            slot->draft[slot->n_drafted++] = token;
+            slot->draft_row = -1;
+
+            // The last proposal is verified without being decoded by the draft
+            if (slot->n_drafted < slot->draft_limit && !llama_vocab_is_eog(engine->vocab, token)) {
+                slot->draft_row = batch->n_tokens;
+                batch_add(batch, token, slot->draft_n_past, slot->seq_id, 1);
+                slot->draft_n_past++;
+                n_speculating++;
+            }
+        }
+    }
+}
+
+// One scheduler step: pack every active sequence into a single batch and decode it
+static void worker_step(llama_worker *worker) {
+    llama_engine *engine = worker->engine;
+    struct llama_batch *batch = &worker->batch;
+    batch->n_tokens = 0;
+
+    for (int i = 0; i < worker->n_slots; i++) {
+        llama_seq_slot *slot = &worker->slots[i];
+        slot->i_batch = -1;
+        slot->n_drafted = 0;
+        if (slot->abort != NULL) {
+            const char *error = slot->abort;
+            slot->abort = NULL;
+            finish_slot(worker, slot, error);
+        } else if (slot->state == SLOT_START) {
+            start_sequence(worker, slot);
+        } else if (slot->state == SLOT_DECODE && slot->n_past >= engine->n_ctx_per_seq
+                && slot_shift(worker, slot) != 0) {
+            finish_slot(worker, slot, NULL);
+        }
+    }
+
+    // Prompts are prefilled one chunk per step; the generating sequences below still advance
+    // every step, and the starting slot rotates so concurrent long prompts share the budget
+    int budget = worker->n_prefill_chunk;
+    for (int k = 0; k < worker->n_slots && budget > 0; k++) {
+        llama_seq_slot *slot = &worker->slots[(worker->prefill_cursor + k) % worker->n_slots];
+        if (slot->state != SLOT_PREFILL) {
+            continue;
+        }
+
+        llama_job *job = slot->job;
+        while (slot->n_prompt_done < job->n_tokens && budget > 0) {
+            int is_last = slot->n_prompt_done == job->n_tokens - 1;
+            if (is_last) {
+                slot->i_batch = batch->n_tokens;
+            }
+            llama_token token = job->tokens[slot->n_prompt_done++];
+            batch_add(batch, token, slot->n_past, slot->seq_id, is_last);
+            slot_push_token(slot, token);
+            budget--;
+        }
+    }
+    worker->prefill_cursor = (worker->prefill_cursor + 1) % worker->n_slots;
+
+    if (worker->draft_ctx != NULL) {
+        draft_step(worker);
+    }
+
+    // Generating sequences contribute their last sampled token, followed by any draft
+    // proposals so the main model scores them all in this same decode
+    for (int i = 0; i < worker->n_slots; i++) {
+        llama_seq_slot *slot = &worker->slots[i];
+        if (slot->state != SLOT_DECODE) {
+            continue;
+        }
+        slot->i_batch = batch->n_tokens;
+        batch_add(batch, slot->last_token, slot->n_past, slot->seq_id, 1);
+        slot_push_token(slot, slot->last_token);
+        for (int d = 0; d < slot->n_drafted; d++) {
+            batch_add(batch, slot->draft[d], slot->n_past, slot->seq_id, 1);
+            slot_push_token(slot, slot->draft[d]);
+        }
+    }
+
+    if (batch->n_tokens == 0) {
+        return;
+    }
+
+    if (llama_decode(worker->ctx, *batch) != 0) {
+        // Sequences still in prefill fail; generating ones keep what they produced so far.
+        // Their cache contents are unknown after a failed decode, so drop them.
+        for (int i = 0; i < worker->n_slots; i++) {
+            llama_seq_slot *slot = &worker->slots[i];
+            if (slot->state == SLOT_PREFILL || slot->state == SLOT_DECODE) {
+                int prefill = slot->state == SLOT_PREFILL;
+                slot_clear_cache(worker, slot);
+                finish_slot(worker, slot, prefill ? "Failed to evaluate prompt" : NULL);
+            }
+        }
+        return;
+    }
+
+    int n_streaming = 0;
+    for (int i = 0; i < worker->n_slots; i++) {
+        llama_seq_slot *slot = &worker->slots[i];
+        if (slot->i_batch < 0) {
+            continue;
+        }
+
+        // Row d holds the main model's logits after the d-th proposal. Sampling each row with
+        // the job's own chain and keeping proposals only while they match what it picked
+        // leaves the output exactly as it would be without a draft.
+        llama_job *job = slot->job;
+        int n_past_base = slot->n_past - slot->n_drafted;
+        int n_accepted = 0;
+        int finished = 0;
+        if (slot->state == SLOT_PREFILL) {
+            job->t_first_us = llama_time_us();
+        }
+        slot->state = SLOT_DECODE;
+        for (int d = 0; d <= slot->n_drafted; d++) {
+            llama_token next_token = llama_sampler_sample(slot->sampler->chain, worker->ctx, slot->i_batch + d);
+
+            if (llama_vocab_is_eog(engine->vocab, next_token)) {
+                finished = 1;
+                break;
+            }
+
+            // No room for a longer response: return what was generated so far
+            if (append_piece(engine, job, next_token) != 0) {
+                finished = 1;
+                break;
+            }
+            job->n_generated++;
+            slot->last_token = next_token;
+
+            // With context shifting, a full window is shifted at the start of the next step instead
+            if (job->n_generated >= job->max_tokens
+                    || (n_past_base + d >= engine->n_ctx_per_seq && !engine->context_shift)) {
+                finished = 1;
+                break;
+            }
+            if (d == slot->n_drafted || next_token != slot->draft[d]) {
+                break;
+            }
+            n_accepted++;
+        }
+
+        job->n_draft_proposed += slot->n_drafted;
+        job->n_draft_accepted += n_accepted;
+
+        // Forget rejected proposals; the cache again ends with the last accepted token
+        if (n_accepted < slot->n_drafted) {
+            slot->n_past = n_past_base + n_accepted;
+            if (!llama_memory_seq_rm(llama_get_memory(worker->ctx), slot->seq_id, slot->n_past, -1)) {
+                slot_clear_cache(worker, slot);
+            }
+        }
+        slot_trim_draft(worker, slot);
+
+        if (finished) {
+            finish_slot(worker, slot, NULL);
+        } else if (job->stream) {
+            n_streaming++;
+        }
+    }
+
+    // Publish new text of streaming jobs once per step rather than once per token
+    if (n_streaming > 0) {
+        jni_mutex_lock(&engine->lock);
+        for (int i = 0; i < worker->n_slots; i++) {
+            llama_job *job = worker->slots[i].job;
+            if (worker->slots[i].state == SLOT_DECODE && job->stream && job->output_ready != job->output_len) {
+                job->output_ready = job->output_len;
+                jni_cond_signal(&job->done_cond);
+            }
+        }
+        jni_mutex_unlock(&engine->lock);
+    }
+}
+
+// Run one throwaway decode: the first llama_decode allocates the compute buffers and faults in
+// every weight page, which would otherwise land on the first request's prefill
+static void warmup_context(struct llama_context *ctx, struct llama_batch *batch, const struct llama_vocab *vocab) {
+    llama_token token = llama_vocab_bos(vocab);
+    batch->n_tokens = 0;
+    batch_add(batch, token != LLAMA_TOKEN_NULL ? token : 0, 0, 0, 1);
+    llama_decode(ctx, *batch);
+    llama_synchronize(ctx);
+    batch->n_tokens = 0;
+
+    llama_memory_clear(llama_get_memory(ctx), true);
+    llama_perf_context_reset(ctx);
+}
+
+static ggml_threadpool_t new_threadpool(const llama_worker *worker, int n_threads) {
+    struct ggml_threadpool_params tpp = ggml_threadpool_params_default(n_threads);
+    memcpy(tpp.cpumask, worker->cpumask, sizeof(tpp.cpumask));
+    tpp.strict_cpu = n_threads <= worker->n_cpus; // one core per thread while there are enough
+    return ggml_threadpool_new(&tpp);
+}
+
+// Replace llama.cpp's unpinned compute threads with pools pinned to the worker's cores; a
+// context whose pool can't be created keeps the unpinned threads
+static void attach_threadpools(llama_worker *worker) {
+    worker->threadpool = new_threadpool(worker, worker->n_threads);
+    if (worker->threadpool == NULL) {
+        return;
+    }
+    worker->threadpool_batch = worker->threadpool;
+    if (worker->n_threads_batch != worker->n_threads) {
+        ggml_threadpool_t batch = new_threadpool(worker, worker->n_threads_batch);
+        if (batch != NULL) {
+            worker->threadpool_batch = batch;
+        }
+    }
+    llama_attach_threadpool(worker->ctx, worker->threadpool, worker->threadpool_batch);
+    // The draft context is only ever evaluated by this thread between main-model decodes
+    if (worker->draft_ctx != NULL) {
+        llama_attach_threadpool(worker->draft_ctx, worker->threadpool, worker->threadpool_batch);
+    }
+}
+
+static JNI_THREAD_PROC(worker_main, arg) {
+    llama_worker *worker = (llama_worker*)arg;
+    llama_engine *engine = worker->engine;
+
+    // Both happen on this thread: running a graph pins the calling thread to the first core of
+    // the context's threadpool, and first-touch puts the compute buffers on that core's node
+    if (worker->n_cpus > 0) {
+        attach_threadpools(worker);
+    }
+    if (worker->warmup) {
+        warmup_context(worker->ctx, &worker->batch, engine->vocab);
+        if (worker->draft_ctx != NULL) {
+            warmup_context(worker->draft_ctx, &worker->draft_batch, llama_model_get_vocab(engine->draft_model));
+        }
+    }
+    jni_mutex_lock(&engine->lock);
+    engine->n_starting--;
+    jni_cond_broadcast(&engine->work_cond);
+    jni_mutex_unlock(&engine->lock);
+
+    for (;;) {
+        struct llama_perf_context_data perf = llama_perf_context(worker->ctx);
+        int n_kv_used = 0;
+        for (int i = 0; i < worker->n_slots; i++) {
+            n_kv_used += worker->slots[i].n_past;
+        }
+
+        jni_mutex_lock(&engine->lock);
+        worker->perf = perf;
+        worker->n_kv_used = n_kv_used;
+        while (engine->running && worker->n_active == 0) {
+            jni_cond_wait(&engine->work_cond, &engine->lock);
+        }
+        if (!engine->running) {
+            jni_mutex_unlock(&engine->lock);
+            break;
+        }
+        admit_jobs(worker);
+        abort_jobs(worker);
+        jni_mutex_unlock(&engine->lock);
+
+        worker_step(worker);
+    }
+
+    for (int i = 0; i < worker->n_slots; i++) {
+        if (worker->slots[i].job != NULL) {
+            finish_slot(worker, &worker->slots[i], "Engine shutting down");
+        }
+    }
+
+    JNI_THREAD_RETURN;
+}
+
+static void free_worker(llama_worker *worker) {
+    if (worker->slots != NULL) {
+        for (int i = 0; i < worker->n_slots; i++) {
+            free(worker->slots[i].cache_tokens);
+            free(worker->slots[i].block_hashes);
+            free(worker->slots[i].draft);
+        }
+        free(worker->slots);
+    }
+    if (worker->batch.token != NULL) {
+        llama_batch_free(worker->batch);
+    }
+    if (worker->ctx != NULL) {
+        llama_free(worker->ctx);
+    }
+    if (worker->draft_batch.token != NULL) {
+        llama_batch_free(worker->draft_batch);
+    }
+    if (worker->draft_ctx != NULL) {
+        llama_free(worker->draft_ctx);
+    }
+    // After the contexts, which compute with them until freed
+    if (worker->threadpool_batch != NULL && worker->threadpool_batch != worker->threadpool) {
+        ggml_threadpool_free(worker->threadpool_batch);
+    }
+    if (worker->threadpool != NULL) {
+        ggml_threadpool_free(worker->threadpool);
+    }
+}
+
+static int init_worker(llama_engine *engine, llama_worker *worker, const llama_engine_params *params) {
+    worker->engine = engine;
+
+    // One KV cache holds n_seq_per_context independent sequences
+    struct llama_context_params ctx_params = llama_context_default_params();
+    ctx_params.n_ctx = params->n_ctx_per_seq * params->n_seq_per_context;
+    ctx_params.n_seq_max = params->n_seq_per_context;
+    ctx_params.n_threads = worker->n_threads;
+    ctx_params.n_threads_batch = worker->n_threads_batch;
+    ctx_params.n_batch = params->n_batch;
+    ctx_params.n_ubatch = params->n_ubatch;
+    ctx_params.no_perf = false; // llama_engine_get_stats reports the context's timings
+    if (params->flash_attn != 0) {
+        ctx_params.flash_attn_type = params->flash_attn > 0
+            ? LLAMA_FLASH_ATTN_TYPE_ENABLED : LLAMA_FLASH_ATTN_TYPE_DISABLED;
+    }
+
+    worker->ctx = llama_init_from_model(engine->model, ctx_params);
+    if (worker->ctx == NULL) {
+        return -1;
+    }
+
+    worker->n_batch = (int)llama_n_batch(worker->ctx);
+    worker->batch = llama_batch_init(worker->n_batch, 0, 1);
+
+    // The draft context holds the same sequences, so give it the same (possibly rounded) size
+    if (engine->draft_model != NULL) {
+        ctx_params.n_ctx = llama_n_ctx(worker->ctx);
+        worker->draft_ctx = llama_init_from_model(engine->draft_model, ctx_params);
+        if (worker->draft_ctx == NULL) {
+            return -1;
+        }
+        worker->draft_batch = llama_batch_init(worker->n_batch, 0, 1);
+
+        // Each generating sequence puts its last token and every proposal in the main batch
+        worker->n_draft = params->n_draft;
+        if (worker->n_draft > (worker->n_batch - 1) / params->n_seq_per_context - 1) {
+            worker->n_draft = (worker->n_batch - 1) / params->n_seq_per_context - 1;
+        }
+        if (worker->n_draft < 0) {
+            worker->n_draft = 0;
+        }
+    }
+
+    // Every generating sequence needs its batch entries each step; prompts get the rest
+    int n_decode_entries = params->n_seq_per_context * (worker->n_draft + 1);
+    worker->n_prefill_chunk = params->n_prefill_chunk;
+    if (worker->n_prefill_chunk > worker->n_batch - n_decode_entries) {
+        worker->n_prefill_chunk = worker->n_batch - n_decode_entries;
+    }
+    if (worker->n_prefill_chunk < 1) {
+        worker->n_prefill_chunk = 1;
+    }
+
+    // The context may round n_ctx up; split what was actually allocated
+    int n_ctx_per_seq = (int)llama_n_ctx(worker->ctx) / params->n_seq_per_context;
+    engine->n_ctx_per_seq = n_ctx_per_seq;
+
+    worker->slots = (llama_seq_slot*)calloc(params->n_seq_per_context, sizeof(llama_seq_slot));
+    if (worker->slots == NULL) {
+        return -1;
+    }
+    worker->n_slots = params->n_seq_per_context;
+
+    for (int i = 0; i < worker->n_slots; i++) {
+        worker->slots[i].seq_id = i;
+        worker->slots[i].state = SLOT_IDLE;
+        worker->slots[i].cache_tokens = (llama_token*)malloc(n_ctx_per_seq * sizeof(llama_token));
+        worker->slots[i].block_hashes = (uint64_t*)malloc((n_ctx_per_seq / PREFIX_BLOCK_TOKENS + 1) * sizeof(uint64_t));
+        worker->slots[i].draft = (llama_token*)malloc((worker->n_draft + 1) * sizeof(llama_token));
+        if (worker->slots[i].cache_tokens == NULL || worker->slots[i].block_hashes == NULL
+                || worker->slots[i].draft == NULL) {
+            return -1;
+        }
+    }
+
+    worker->warmup = params->warmup;
+    return 0;
+}
+
+// Add the CPUs of a cpulist such as "0-7,16-23" (up to end) to mask; -1 if malformed.
+// CPUs past GGML_MAX_N_THREADS are ignored.
+static int parse_cpulist(const char *list, const char *end, bool *mask) {
+    const char *p = list;
+    while (p < end) {
+        char *next;
+        long first = strtol(p, &next, 10);
+        if (next == p || next > end || first < 0) {
+            return -1;
+        }
+        long last = first;
+        p = next;
+        if (p < end && *p == '-') {
+            last = strtol(p + 1, &next, 10);
+            if (next == p + 1 || next > end || last < first) {
+                return -1;
+            }
+            p = next;
+        }
+        for (long cpu = first; cpu <= last && cpu < GGML_MAX_N_THREADS; cpu++) {
+            mask[cpu] = true;
+        }
+        while (p < end && *p == ' ') {
+            p++;
+        }
+        if (p < end && *p++ != ',') {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int count_cpus(const bool *mask) {
+    int n = 0;
+    for (int cpu = 0; cpu < GGML_MAX_N_THREADS; cpu++) {
+        n += mask[cpu];
+    }
+    return n;
+}
+
+// Physical cores of a NUMA node, i.e. the first hardware thread of each core on it: a second
+// thread per core only competes for the same vector units. -1 without sysfs topology.
+static int node_cores(int node, bool *mask) {
+    char path[96];
+    char list[1024];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (jni_read_sysfs(path, list, sizeof(list)) != 0 || parse_cpulist(list, list + strlen(list), mask) != 0) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < GGML_MAX_N_THREADS; cpu++) {
+        if (!mask[cpu]) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (jni_read_sysfs(path, list, sizeof(list)) == 0 && strtol(list, NULL, 10) != cpu) {
+            mask[cpu] = false;
+        }
+    }
+    return 0;
+}
+
+// "auto": contexts go to the nodes in turn, and the contexts of one node split its cores into
+// contiguous shares. Without topology information every CPU counts as one node.
+static void assign_node_cores(llama_worker *workers, int n_workers, bool (*groups)[GGML_MAX_N_THREADS]) {
+    int n_groups = 0;
+    for (int node = 0; node < MAX_CORE_SETS; node++) {
+        if (node_cores(node, groups[n_groups]) == 0 && count_cpus(groups[n_groups]) > 0) {
+            n_groups++;
+        } else {
+            memset(groups[n_groups], 0, sizeof(groups[n_groups]));
+        }
+    }
+    if (n_groups == 0) {
+        for (int cpu = 0; cpu < jni_cpu_count() && cpu < GGML_MAX_N_THREADS; cpu++) {
+            groups[0][cpu] = true;
+        }
+        n_groups = 1;
+    }
+
+    for (int i = 0; i < n_workers; i++) {
+        int group = i % n_groups;
+        int n_sharing = n_workers / n_groups + (group < n_workers % n_groups);
+        int n_cores = count_cpus(groups[group]);
+        int from = n_cores * (i / n_groups) / n_sharing;
+        int to = n_cores * (i / n_groups + 1) / n_sharing;
+        if (to == from) {
+            to = from + 1; // more contexts than cores: neighbours share one
+        }
+        for (int cpu = 0, k = 0; cpu < GGML_MAX_N_THREADS; cpu++) {
+            if (groups[group][cpu]) {
+                workers[i].cpumask[cpu] = k >= from && k < to;
+                k++;
+            }
+        }
+    }
+}
+
+// Fill in every worker's cpumask from a cpu_sets spec; -1 if it is malformed or a set holds no
+// usable CPU
+static int assign_core_sets(llama_worker *workers, int n_workers, const char *spec) {
+    if (spec == NULL || spec[0] == '\0') {
+        return 0;
+    }
+    bool (*groups)[GGML_MAX_N_THREADS] = calloc(MAX_CORE_SETS, sizeof(*groups));
+    if (groups == NULL) {
+        return -1;
+    }
+
+    int result = 0;
+    if (strcmp(spec, "auto") == 0) {
+        assign_node_cores(workers, n_workers, groups);
+    } else {
+        int n_groups = 0;
+        for (const char *set = spec; result == 0; ) {
+            const char *end = strchr(set, ';');
+            if (end == NULL) {
+                end = set + strlen(set);
+            }
+            if (n_groups == MAX_CORE_SETS || parse_cpulist(set, end, groups[n_groups]) != 0) {
+                result = -1;
+                break;
+            }
+            n_groups++;
+            if (*end == '\0') {
+                break;
+            }
+            set = end + 1;
+        }
+        for (int i = 0; result == 0 && i < n_workers; i++) {
+            memcpy(workers[i].cpumask, groups[i % n_groups], sizeof(workers[i].cpumask));
+        }
+    }
+
+    for (int i = 0; result == 0 && i < n_workers; i++) {
+        workers[i].n_cpus = count_cpus(workers[i].cpumask);
+        if (workers[i].n_cpus == 0) {
+            result = -1;
+        }
+    }
+    free(groups);
+    return result;
+}
+
+// Decode every token of the vocabulary once, so the scheduler copies pieces instead of calling
+// llama_token_to_piece per sampled token. About 1-2 MB for a 150k-token vocabulary.
+static void build_piece_table(llama_engine *engine) {
+    int n_vocab = llama_vocab_n_tokens(engine->vocab);
+    int32_t *offsets = (int32_t*)malloc(sizeof(int32_t) * ((size_t)n_vocab + 1));
+    size_t cap = (size_t)n_vocab * 8 + 64;
+    char *pieces = (char*)malloc(cap);
+    if (offsets == NULL || pieces == NULL) {
+        free(offsets);
+        free(pieces);
+        return;
+    }
+
+    size_t len = 0;
+    for (llama_token t = 0; t < n_vocab; t++) {
+        offsets[t] = (int32_t)len;
+        int32_t n = llama_token_to_piece(engine->vocab, t, pieces + len, (int32_t)(cap - len), 0, false);
+        if (n < 0) {
+            while (cap < len + (size_t)-n) {
+                cap *= 2;
+            }
+            char *grown = cap <= INT32_MAX ? (char*)realloc(pieces, cap) : NULL;
+            if (grown == NULL) {
+                free(offsets);
+                free(pieces);
+                return;
+            }
+            pieces = grown;
+            n = llama_token_to_piece(engine->vocab, t, pieces + len, (int32_t)(cap - len), 0, false);
+        }
+        if (n > 0) {
+            len += (size_t)n;
+        }
+    }
+    offsets[n_vocab] = (int32_t)len;
+
+    engine->pieces = pieces;
+    engine->piece_offsets = offsets;
+    engine->n_pieces = n_vocab;
+}
+
+llama_engine* llama_engine_create(struct llama_model *model, const llama_engine_params *params) {
+    llama_engine_params p;
+    llama_engine_default_params(&p);
+    if (params != NULL) {
+        if (params->n_contexts > 0) p.n_contexts = params->n_contexts;
+        if (params->n_seq_per_context > 0) p.n_seq_per_context = params->n_seq_per_context;
+        if (params->n_ctx_per_seq > 0) p.n_ctx_per_seq = params->n_ctx_per_seq;
+        if (params->n_threads > 0) p.n_threads = params->n_threads;
+        if (params->n_threads_batch > 0) p.n_threads_batch = params->n_threads_batch;
+        p.cpu_sets = params->cpu_sets;
+        if (params->n_batch > 0) p.n_batch = params->n_batch;
+        if (params->n_ubatch > 0) p.n_ubatch = params->n_ubatch;
+        if (params->n_prefill_chunk > 0) p.n_prefill_chunk = params->n_prefill_chunk;
+        p.flash_attn = params->flash_attn;
+        if (params->deadline_ms > 0) p.deadline_ms = params->deadline_ms;
+        p.draft_model = params->draft_model;
+        if (params->n_draft > 0) p.n_draft = params->n_draft;
+        if (params->session_memory_mb > 0) p.session_memory_mb = params->session_memory_mb;
+        if (params->session_disk_mb > 0) p.session_disk_mb = params->session_disk_mb;
+        p.session_dir = params->session_dir;
+        p.warmup = params->warmup;
+        p.context_shift = params->context_shift;
+        if (params->n_keep > 0) p.n_keep = params->n_keep;
+    }
+
+    // Proposals are token ids of the draft vocabulary, so it has to be the main one
+    if (p.draft_model != NULL && llama_vocab_n_tokens(llama_model_get_vocab(p.draft_model))
+            != llama_vocab_n_tokens(llama_model_get_vocab(model))) {
+        return NULL;
+    }
+
+    llama_engine *engine = (llama_engine*)calloc(1, sizeof(llama_engine));
+    if (engine == NULL) {
+        return NULL;
+    }
+    engine->model = model;
+    engine->vocab = llama_model_get_vocab(model);
+    engine->n_seq_per_worker = p.n_seq_per_context;
+    engine->deadline_us = (int64_t)p.deadline_ms * 1000;
+    engine->session_mem_budget = (size_t)p.session_memory_mb << 20;
+    if (p.session_dir != NULL && p.session_dir[0] != '\0' && p.session_disk_mb > 0
+            && strlen(p.session_dir) < sizeof(engine->session_dir)) {
+        strcpy(engine->session_dir, p.session_dir);
+        engine->session_disk_budget = (size_t)p.session_disk_mb << 20;
+    }
+    if (p.draft_model != NULL) {
+        engine->draft_model = p.draft_model;
+        engine->n_draft_vocab = llama_vocab_n_tokens(llama_model_get_vocab(p.draft_model));
+    }
+    jni_mutex_init(&engine->lock);
+    jni_cond_init(&engine->work_cond);
+    build_piece_table(engine);
+
+    engine->workers = (llama_worker*)calloc(p.n_contexts, sizeof(llama_worker));
+    if (engine->workers == NULL) {
+        llama_engine_free(engine);
+        return NULL;
+    }
+    engine->n_workers = p.n_contexts;
+
+    if (assign_core_sets(engine->workers, engine->n_workers, p.cpu_sets) != 0) {
+        llama_engine_free(engine);
+        return NULL;
+    }
+    for (int i = 0; i < engine->n_workers; i++) {
+        llama_worker *worker = &engine->workers[i];
+        // A pinned context runs one thread per core unless told otherwise
+        worker->n_threads = worker->n_cpus > 0 && (params == NULL || params->n_threads <= 0)
+            ? worker->n_cpus : p.n_threads;
+        worker->n_threads_batch = p.n_threads_batch > 0 ? p.n_threads_batch : worker->n_threads;
+        if (init_worker(engine, worker, &p) != 0) {
+            llama_engine_free(engine);
+            return NULL;
+        }
+    }
+
+    // Shifting moves positions in both caches; the head keeps BOS and leaves half the window
+    engine->context_shift = p.context_shift && llama_memory_can_shift(llama_get_memory(engine->workers[0].ctx))
+        && (engine->workers[0].draft_ctx == NULL || llama_memory_can_shift(llama_get_memory(engine->workers[0].draft_ctx)));
+    engine->n_keep = p.n_keep + (llama_vocab_get_add_bos(engine->vocab) ? 1 : 0);
+    if (engine->n_keep > engine->n_ctx_per_seq / 2) {
+        engine->n_keep = engine->n_ctx_per_seq / 2;
+    }
+
+    engine->job_hashes = (uint64_t*)malloc((engine->n_ctx_per_seq / PREFIX_BLOCK_TOKENS + 1) * sizeof(uint64_t));
+    engine->n_samplers = SAMPLER_POOL_FACTOR * engine->n_workers * engine->n_seq_per_worker;
+    engine->max_free_arenas = ARENA_POOL_FACTOR * engine->n_workers * engine->n_seq_per_worker;
+    engine->samplers = (llama_sampler_entry*)calloc(engine->n_samplers, sizeof(llama_sampler_entry));
+    if (engine->job_hashes == NULL || engine->samplers == NULL) {
+        llama_engine_free(engine);
+        return NULL;
+    }
+
+    engine->running = 1;
+    engine->n_starting = engine->n_workers;
+    for (int i = 0; i < engine->n_workers; i++) {
+        if (jni_thread_create(&engine->workers[i].thread, worker_main, &engine->workers[i]) != 0) {
+            llama_engine_free(engine);
+            return NULL;
+        }
+        engine->workers[i].thread_started = 1;
+    }
+
+    // The contexts warm up in parallel, each on its own cores
+    jni_mutex_lock(&engine->lock);
+    while (engine->n_starting > 0) {
+        jni_cond_wait(&engine->work_cond, &engine->lock);
+    }
+    jni_mutex_unlock(&engine->lock);
+
+    return engine;
+}
+
+static void free_arena(llama_job_arena *arena) {
+    free(arena->tokens);
+    free(arena->text);
+    free(arena->output);
+    free(arena);
+}
+
+void llama_engine_stop(llama_engine *engine) {
+    jni_mutex_lock(&engine->lock);
+    engine->running = 0;
+    jni_cond_broadcast(&engine->work_cond);
+    jni_mutex_unlock(&engine->lock);
+
+    for (int i = 0; i < engine->n_workers; i++) {
+        if (engine->workers[i].thread_started) {
+            jni_thread_join(engine->workers[i].thread);
+            engine->workers[i].thread_started = 0;
+        }
+    }
+
+    // Fail anything that never reached a sequence
+    jni_mutex_lock(&engine->lock);
+    while (engine->queue_head != NULL) {
+        llama_job *job = engine->queue_head;
+        engine->queue_head = job->next;
+        complete_job(engine, job, "Engine shutting down");
+    }
+    engine->queue_tail = NULL;
+    jni_mutex_unlock(&engine->lock);
+}
+
+void llama_engine_free(llama_engine *engine) {
+    if (engine == NULL) {
+        return;
+    }
+
+    llama_engine_stop(engine);
+
+    if (engine->workers != NULL) {
+        for (int i = 0; i < engine->n_workers; i++) {
+            free_worker(&engine->workers[i]);
+        }
+        free(engine->workers);
+    }
+    free(engine->job_hashes);
+    free(engine->pieces);
+    free(engine->piece_offsets);
+    session_free_list(engine, engine->sessions);
+    while (engine->free_arenas != NULL) {
+        llama_job_arena *arena = engine->free_arenas;
+        engine->free_arenas = arena->next;
+        free_arena(arena);
+    }
+    if (engine->samplers != NULL) {
+        for (int i = 0; i < engine->n_samplers; i++) {
+            if (engine->samplers[i].chain != NULL) {
+                llama_sampler_free(engine->samplers[i].chain);
+            }
+            free((char*)engine->samplers[i].params.grammar);
+        }
+        free(engine->samplers);
+    }
+
+    jni_cond_destroy(&engine->work_cond);
+    jni_mutex_destroy(&engine->lock);
+    free(engine);
+}
+
+int llama_engine_submit(llama_engine *engine, llama_job *job) {
+    jni_mutex_lock(&engine->lock);
+    if (!engine->running) {
+        jni_mutex_unlock(&engine->lock);
+        return -1;
+    }
+
+    job->next = NULL;
+    job->done = 0;
+    job->cancelled = 0;
+    job->t_submit_us = llama_time_us();
+    job->t_start_us = 0;
+    job->t_first_us = 0;
+    job->n_prompt_reused = 0;
+    job->n_draft_proposed = 0;
+    job->n_draft_accepted = 0;
+    job->n_shifts = 0;
+    job->n_discarded = 0;
+    if (job->deadline_us == 0 && engine->deadline_us > 0) {
+        job->deadline_us = job->t_submit_us + engine->deadline_us;
+    }
+    if (engine->queue_tail != NULL) {
+        engine->queue_tail->next = job;
+    } else {
+        engine->queue_head = job;
+    }
+    engine->queue_tail = job;
+
+    // Idle workers sleep on work_cond; busy ones pick the job up between steps
+    dispatch_jobs(engine);
+    jni_mutex_unlock(&engine->lock);
+    return 0;
+}
+
+int llama_engine_cancel(llama_engine *engine, uint64_t id) {
+    if (id == 0) {
+        return 0;
+    }
+
+    jni_mutex_lock(&engine->lock);
+
+    llama_job *prev = NULL;
+    for (llama_job *job = engine->queue_head; job != NULL; prev = job, job = job->next) {
+        if (job->id != id) {
+            continue;
+        }
+        if (prev != NULL) {
+            prev->next = job->next;
+        } else {
+            engine->queue_head = job->next;
+        }
+        if (engine->queue_tail == job) {
+            engine->queue_tail = prev;
+        }
+        complete_job(engine, job, "Cancelled");
+        jni_mutex_unlock(&engine->lock);
+        return 1;
+    }
+
+    // Reserved or running: the owning scheduler notices before its next step
+    for (int w = 0; w < engine->n_workers; w++) {
+        llama_worker *worker = &engine->workers[w];
+        for (int i = 0; i < worker->n_slots; i++) {
+            llama_job *job = worker->slots[i].job;
+            if (job != NULL && job->id == id) {
+                job->cancelled = 1;
+                jni_mutex_unlock(&engine->lock);
+                return 1;
+            }
+        }
+    }
+
+    jni_mutex_unlock(&engine->lock);
+    return 0;
+}
+
+void llama_engine_wait(llama_engine *engine, llama_job *job) {
+    jni_mutex_lock(&engine->lock);
+    while (!job->done) {
+        jni_cond_wait(&job->done_cond, &engine->lock);
+    }
+    jni_mutex_unlock(&engine->lock);
+}
+
+int llama_engine_read_output(llama_engine *engine, llama_job *job, size_t consumed,
+                             char *buf, size_t size, size_t *n_read) {
+    jni_mutex_lock(&engine->lock);
+    while (!job->done && job->output_ready <= consumed) {
+        jni_cond_wait(&job->done_cond, &engine->lock);
+    }
+
+    // Copy under the lock: the scheduler may move the buffer when the response grows
+    size_t n = job->output_ready - consumed;
+    if (n > size) {
+        n = size;
+    }
+    memcpy(buf, job->output + consumed, n);
+    *n_read = n;
+    int done = job->done && consumed + n == job->output_ready;
+    jni_mutex_unlock(&engine->lock);
+    return done;
+}
+
+llama_job_arena* llama_engine_acquire_arena(llama_engine *engine) {
+    jni_mutex_lock(&engine->lock);
+    llama_job_arena *arena = engine->free_arenas;
+    if (arena != NULL) {
+        engine->free_arenas = arena->next;
+        engine->n_free_arenas--;
+    }
+    jni_mutex_unlock(&engine->lock);
+
+    if (arena != NULL) {
+        arena->next = NULL;
+        return arena;
+    }
+
+    arena = (llama_job_arena*)calloc(1, sizeof(llama_job_arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->tokens = (llama_token*)malloc(engine->n_ctx_per_seq * sizeof(llama_token));
+    arena->output = (char*)malloc(ARENA_OUTPUT_INITIAL);
+    arena->output_cap = ARENA_OUTPUT_INITIAL;
+    if (arena->tokens == NULL || arena->output == NULL) {
+        free_arena(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+void llama_engine_release_arena(llama_engine *engine, llama_job_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    // Keep a bounded number of idle arenas; one that grew for an unusually long response is dropped
+    jni_mutex_lock(&engine->lock);
+    int keep = engine->n_free_arenas < engine->max_free_arenas && arena->output_cap <= ARENA_OUTPUT_RETAIN;
+    if (keep) {
+        arena->next = engine->free_arenas;
+        engine->free_arenas = arena;
+        engine->n_free_arenas++;
+    }
+    jni_mutex_unlock(&engine->lock);
+
+    if (!keep) {
+        free_arena(arena);
+    }
+}
+
+int llama_job_arena_reserve_text(llama_job_arena *arena, size_t size) {
+    if (size <= arena->text_cap) {
+        return 0;
+    }
+    char *text = (char*)realloc(arena->text, size);
+    if (text == NULL) {
+        return -1;
+    }
+    arena->text = text;
+    arena->text_cap = size;
+    return 0;
+}
+
+int llama_engine_n_ctx_per_seq(const llama_engine *engine) {
+    return engine->n_ctx_per_seq;
+}
+
+int llama_engine_context_shift(const llama_engine *engine) {
+    return engine->context_shift;
+}
+
+int llama_engine_truncate_prompt(const llama_engine *engine, const llama_token *tokens, int n_tokens,
+                                 llama_token *out) {
+    int n_tail = n_tokens;
+    if (n_tokens >= engine->n_ctx_per_seq) {
+        n_tail = (engine->n_ctx_per_seq - engine->n_keep) / 2;
+        memmove(out, tokens, engine->n_keep * sizeof(llama_token));
+        memmove(out + engine->n_keep, tokens + n_tokens - n_tail, n_tail * sizeof(llama_token));
+        return engine->n_keep + n_tail;
+    }
+    memmove(out, tokens, n_tail * sizeof(llama_token));
+    return n_tail;
+}
+
+int llama_engine_n_sequences(const llama_engine *engine) {
+    return engine->n_workers * engine->n_seq_per_worker;
+}
+
+int llama_engine_n_active(llama_engine *engine) {
+    jni_mutex_lock(&engine->lock);
+    int n_active = 0;
+    for (int i = 0; i < engine->n_workers; i++) {
+        n_active += engine->workers[i].n_active;
+    }
+    jni_mutex_unlock(&engine->lock);
+    return n_active;
+}
+
+void llama_engine_get_stats(llama_engine *engine, llama_engine_stats *stats) {
+    jni_mutex_lock(&engine->lock);
+    *stats = engine->stats;
+    stats->n_active = 0;
+    stats->n_kv_used = 0;
+    for (int i = 0; i < engine->n_workers; i++) {
+        const llama_worker *worker = &engine->workers[i];
+        stats->perf_t_prompt_eval_us += (int64_t)(worker->perf.t_p_eval_ms * 1000.0);
+        stats->perf_t_eval_us += (int64_t)(worker->perf.t_eval_ms * 1000.0);
+        stats->perf_n_prompt_eval += (uint64_t)worker->perf.n_p_eval;
+        stats->perf_n_eval += (uint64_t)worker->perf.n_eval;
+        stats->n_active += worker->n_active;
+        stats->n_kv_used += worker->n_kv_used;
+    }
+    stats->n_queued = 0;
+    for (const llama_job *job = engine->queue_head; job != NULL; job = job->next) {
+        stats->n_queued++;
+    }
+    jni_mutex_unlock(&engine->lock);
+
+    stats->n_sequences = llama_engine_n_sequences(engine);
+    stats->n_kv_total = (int64_t)stats->n_sequences * engine->n_ctx_per_seq;
+}
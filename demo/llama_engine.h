@@ -0,0 +1,239 @@
+// Continuous batching engine shared by the JNI entry points
+#ifndef LLAMA_ENGINE_H
+#define LLAMA_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <llama.h>
+#include "llama_jni_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Defaults used when the caller leaves a parameter at 0
+#define DEFAULT_CONTEXT_POOL_SIZE 2
+#define DEFAULT_SEQUENCES_PER_CONTEXT 4
+#define DEFAULT_CONTEXT_LENGTH 2048
+#define DEFAULT_THREADS 4
+#define DEFAULT_BATCH_SIZE 512
+#define DEFAULT_UBATCH_SIZE 512
+#define DEFAULT_PREFILL_CHUNK 256
+#define DEFAULT_DRAFT_TOKENS 4
+#define DEFAULT_SESSION_MEMORY_MB 512
+
+// Sampling defaults, mirrored by com.livecoding.demo.SamplingParams
+#define DEFAULT_TEMPERATURE 0.8f
+#define DEFAULT_TOP_K 40
+#define DEFAULT_TOP_P 0.9f
+#define DEFAULT_SEED 42
+
+typedef struct llama_engine llama_engine;
+
+typedef struct {
+    int n_contexts;         // contexts (each with its own scheduler thread)
+    int n_seq_per_context;  // concurrent sequences batched into one context
+    int n_ctx_per_seq;      // KV cache length available to each sequence
+    int n_threads;          // compute threads per context (generation)
+    int n_threads_batch;    // compute threads per context for prompt batches, 0 = n_threads
+    int n_batch;            // logical batch: max tokens passed to one llama_decode
+    int n_ubatch;           // physical micro-batch the backend computes at once
+    int n_prefill_chunk;    // max prompt tokens per step, so long prompts don't stall decoding
+    int flash_attn;         // 1 = enabled, -1 = disabled, 0 = llama.cpp default
+    int deadline_ms;        // default time limit per job from submission, 0 = none
+
+    // Cores each context's compute threads are pinned to: cpulists separated by ';' (e.g.
+    // "0-7,16-23;8-15,24-31") handed to the contexts round-robin, or "auto" to give every
+    // context an equal share of one NUMA node's physical cores, spreading contexts over the
+    // nodes. A pinned context with n_threads 0 runs one thread per core. NULL or empty:
+    // threads are left to the OS.
+    const char *cpu_sets;
+
+    // Speculative decoding: a small model sharing the vocabulary proposes n_draft tokens per
+    // step for each generating sequence, and the main model verifies them in the same batch.
+    // The engine does not take ownership; NULL disables it.
+    struct llama_model *draft_model;
+    int n_draft;
+
+    // Conversations (jobs with a session_id) keep their KV state when their sequence is
+    // given to another job: in memory up to session_memory_mb, least recently used first out,
+    // then in files under session_dir up to session_disk_mb. NULL session_dir: memory only.
+    int session_memory_mb;
+    int session_disk_mb;
+    const char *session_dir;
+
+    // Decode one token in every context before llama_engine_create returns, so compute
+    // buffers are allocated and the weights paged in before the first job
+    int warmup;
+
+    // Context overflow. With context_shift set, a generating sequence that fills its window
+    // keeps the BOS token plus its first n_keep tokens (at most half the window), drops the
+    // older half of the rest from the KV cache and shifts the remainder down, instead of
+    // stopping. Prompts too long for the window are cut the same way by
+    // llama_engine_truncate_prompt. Models whose cache cannot shift positions keep stopping.
+    int context_shift;
+    int n_keep;
+} llama_engine_params;
+
+typedef struct {
+    float temperature;      // 0 samples greedily
+    int top_k;              // 0 disables top-k
+    float top_p;            // 1 disables top-p
+    uint32_t seed;
+    const char *grammar;    // GBNF with a "root" rule constraining the output, NULL = none;
+                            // it must stay valid until the job is done
+} llama_sampling_params;
+
+// Reusable per-request buffers, recycled by the engine so the generation path does not
+// allocate. The output buffer grows in place and keeps its capacity when the arena is reused.
+typedef struct llama_job_arena {
+    llama_token *tokens;    // n_ctx_per_seq entries
+    char *text;             // scratch for the prompt bytes, then the job's grammar
+    size_t text_cap;
+    char *output;
+    size_t output_cap;
+    struct llama_job_arena *next;
+} llama_job_arena;
+
+// One generation request. The submitter owns the memory; the scheduler
+// only writes the result fields until it sets done.
+typedef struct llama_job {
+    // Request
+    uint64_t id;            // chosen by the submitter; names the job for llama_engine_cancel
+    int64_t deadline_us;    // llama_time_us() after which the job fails, 0 = engine default
+    uint64_t session_id;    // conversation this turn continues, 0 = none
+    llama_token *tokens;
+    int n_tokens;
+    int max_tokens;
+    llama_sampling_params sampling; // served from the engine's pool of sampler chains
+    int n_truncated;        // prompt tokens llama_engine_truncate_prompt cut, for the metrics
+
+    // Result. Unless output_fixed is set, output must be heap memory: the scheduler reallocs
+    // it (with the engine lock held) when a response outgrows it, keeping arena->output in step.
+    char *output;
+    size_t output_len;
+    size_t output_cap;
+    llama_job_arena *arena; // buffers behind tokens and output, or NULL
+    int output_fixed;       // output is caller memory: generation stops when it is full
+    int n_generated;
+    const char *error;      // static message when the job failed, NULL otherwise
+    int done;
+
+    // Streaming: when set, output_ready is published after every decode step
+    int stream;
+    size_t output_ready;    // bytes of output safe to read before done
+
+    // Optional completion hook, called once by a scheduler thread with the engine lock held.
+    // It must not call back into the engine; the job may be freed as soon as it returns.
+    void (*on_done)(struct llama_job *job, void *user_data);
+    void *user_data;
+
+    // Scheduler bookkeeping
+    int cancelled;          // set by llama_engine_cancel once the job holds a sequence
+    int64_t t_submit_us;    // timestamps folded into the engine metrics on completion
+    int64_t t_start_us;     // sequence assigned, 0 while queued
+    int64_t t_first_us;     // first token sampled, 0 before
+    int n_prompt_reused;    // leading prompt tokens taken from the prefix cache or a session
+    int n_draft_proposed;
+    int n_draft_accepted;
+    int n_shifts;           // context shifts of the job's sequence
+    int n_discarded;        // tokens the shifts dropped from its KV cache
+    jni_cond_t done_cond;
+    struct llama_job *next;
+} llama_job;
+
+// Metrics snapshot. Counters accumulate from engine creation; times are in microseconds and
+// each one sums over the jobs its count field names. The last group is sampled at snapshot time.
+typedef struct {
+    uint64_t n_jobs;                // completed, successfully or not
+    uint64_t n_jobs_failed;
+    uint64_t n_started;             // jobs that got a sequence
+    int64_t t_queue_us;             // submit to sequence start
+    uint64_t n_prefilled;           // jobs that produced a first token
+    int64_t t_prefill_us;           // sequence start to first token
+    int64_t t_first_token_us;       // submit to first token
+    int64_t t_decode_us;            // first token to completion
+    uint64_t n_prompt_tokens;       // prompt tokens evaluated by prefilled jobs
+    uint64_t n_prompt_reused;       // prompt tokens they took from the prefix cache instead
+    uint64_t n_generated;           // tokens generated, all jobs
+    uint64_t n_decoded;             // tokens generated after the first, prefilled jobs
+    uint64_t n_draft_proposed;
+    uint64_t n_draft_accepted;
+    uint64_t n_context_shifts;
+    uint64_t n_tokens_discarded;    // by context shifts and prompt truncation
+
+    // llama_perf_context totals over all contexts, as of each context's latest step
+    int64_t perf_t_prompt_eval_us;
+    int64_t perf_t_eval_us;
+    uint64_t perf_n_prompt_eval;
+    uint64_t perf_n_eval;
+
+    int n_queued;                   // waiting for a sequence
+    int n_active;                   // sequences holding a job
+    int n_sequences;
+    int64_t n_kv_used;              // KV cells held by sequences, including cached prefixes
+    int64_t n_kv_total;
+} llama_engine_stats;
+
+void llama_engine_default_params(llama_engine_params *params);
+void llama_sampling_default_params(llama_sampling_params *params);
+
+// Creates the contexts and starts one scheduler thread per context. Returns NULL on failure.
+llama_engine* llama_engine_create(struct llama_model *model, const llama_engine_params *params);
+
+// Stops accepting jobs, finishes or fails every job it holds and joins the scheduler threads.
+// Completion hooks have all run when it returns. Safe to call more than once.
+void llama_engine_stop(llama_engine *engine);
+
+// Stops the engine if needed and frees the contexts. No job may be submitted or awaited concurrently.
+void llama_engine_free(llama_engine *engine);
+
+// Resets the job and gives it the default sampling parameters
+void llama_job_init(llama_job *job);
+void llama_job_destroy(llama_job *job);
+
+// Queues the job; it joins the next decode step of whichever context has a free sequence.
+int llama_engine_submit(llama_engine *engine, llama_job *job);
+
+// Fails the in-flight job with this id ("Cancelled"). A queued job completes at once; a running
+// one gives up its sequence before the next decode step. Returns 0 when no such job is in flight;
+// id 0 never matches, so jobs nobody will cancel can leave it unset.
+int llama_engine_cancel(llama_engine *engine, uint64_t id);
+
+// Blocks until the scheduler has finished the job (successfully or with job->error set).
+void llama_engine_wait(llama_engine *engine, llama_job *job);
+
+// For streaming jobs: blocks until more than `consumed` bytes of output are ready or the job
+// is done, then copies up to `size` of the new bytes into buf. Stores the number copied in
+// *n_read and returns 1 once the job is done and all of its output has been read.
+int llama_engine_read_output(llama_engine *engine, llama_job *job, size_t consumed,
+                             char *buf, size_t size, size_t *n_read);
+
+// Borrow buffers for one job (NULL on allocation failure); return them once the job is released
+llama_job_arena* llama_engine_acquire_arena(llama_engine *engine);
+void llama_engine_release_arena(llama_engine *engine, llama_job_arena *arena);
+
+// Grow the arena's text scratch to at least `size` bytes; returns -1 on allocation failure
+int llama_job_arena_reserve_text(llama_job_arena *arena, size_t size);
+
+int llama_engine_n_ctx_per_seq(const llama_engine *engine);
+
+// Whether sequences shift their KV cache instead of stopping when the window is full
+int llama_engine_context_shift(const llama_engine *engine);
+
+// Fit a prompt of n_tokens into the window: the kept head, then the most recent tokens, so
+// that half of the rest of the window stays free for generation. Writes to out, which may be
+// tokens itself, and returns the new length; a prompt that fits is copied unchanged.
+int llama_engine_truncate_prompt(const llama_engine *engine, const llama_token *tokens, int n_tokens,
+                                 llama_token *out);
+int llama_engine_n_sequences(const llama_engine *engine);
+int llama_engine_n_active(llama_engine *engine);
+
+// Copies the metrics with the engine lock held; cheap enough to call on every scrape
+void llama_engine_get_stats(llama_engine *engine, llama_engine_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LLAMA_ENGINE_H
@@ -2,262 +2,2006 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <llama.h>
+#include "llama_engine.h"
 #include "com_livecoding_demo_LlamaJNI.h"
 
 // Constants for input validation
 #define MAX_PROMPT_LENGTH 4096
-#define MAX_RESPONSE_LENGTH 8192
+#define STREAM_CHUNK_SIZE 4096
 #define DEFAULT_MAX_TOKENS 512
+#define MAX_SESSION_ID_LENGTH 256
+#define MAX_MODEL_ID_LENGTH 128
+#define MAX_MODEL_PATH_LENGTH 1024
+#define MAX_CHAT_MESSAGES 256
+#define MAX_CHAT_ROLE_LENGTH 32
+#define MAX_CHAT_LENGTH (2 * MAX_PROMPT_LENGTH) // templated chat: the messages plus the template's markup
+#define MAX_GRAMMAR_LENGTH 65536
+#define EMBED_MAX_SEQS 64           // inputs pooled per embedding decode
+#define EMBED_MIN_CTX 512
 
-// Simple structure to simulate model handle
+// Asynchronous job: completed by the scheduler, delivered to Java by the completion thread
+typedef struct async_job {
+    llama_job job;          // first member, so the engine's llama_job* converts back
+    jobject listener;       // global ref to a com.livecoding.demo.CompletionListener
+    struct async_job *next;
+} async_job;
+
+// Finished async jobs waiting for delivery
 typedef struct {
-    int model_id;
-    char model_path[1024];
-} simple_model_context;
+    jni_mutex_t lock;
+    jni_cond_t cond;
+    async_job *head;
+    async_job *tail;
+    int stopping;
+    jlong next_id;          // job ids handed to Java for cancel()
+    jni_thread_t thread;
+    int thread_started;
+} completion_queue;
 
-static simple_model_context* global_model = NULL;
+// Model handle: one shared llama_model driven by the batching engine
+typedef struct llama_model_context {
+    struct llama_model *model;
+    struct llama_model *draft_model;    // speculative decoding, or NULL
+    llama_engine *engine;
+    completion_queue completions;
+    char model_path[MAX_MODEL_PATH_LENGTH];
 
-JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_loadModel(JNIEnv *env, jobject obj, jstring path) {
-    if (path == NULL) {
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"), 
-                        "Model path cannot be null");
+    // Embeddings run on their own context, created on first use; one caller at a time
+    jni_mutex_t embed_lock;
+    struct llama_context *embed_ctx;
+    int embed_n_ctx;                    // tokens per embedding batch, and so per input
+    int embed_threads;
+
+    // Registry bookkeeping (acquireModel handles only; guarded by the registry lock)
+    char id[MAX_MODEL_ID_LENGTH + 1];   // empty for loadModel handles
+    int refs;                           // acquireModel calls not yet released
+    int evicted;                        // unlinked; freed once refs drops to 0
+    uint64_t resident_bytes;
+    uint64_t last_used;
+    struct llama_model_context *next;
+} llama_model_context;
+
+// Models loaded through acquireModel, keyed by id. Idle models are evicted least recently
+// used first to stay within the budget; models in use are never freed, so the budget can be
+// exceeded until they are released.
+typedef struct {
+    jni_mutex_t lock;
+    jni_mutex_t load_lock;          // serializes loads so an id is never loaded twice
+    llama_model_context *head;
+    uint64_t resident_bytes;
+    uint64_t budget_bytes;          // 0: unlimited
+    uint64_t clock;
+} model_registry;
+
+// Cached in JNI_OnLoad so the completion thread can attach itself
+static JavaVM *g_jvm = NULL;
+static model_registry g_registry;
+
+static int start_completions(llama_model_context *model_ctx);
+static void stop_completions(llama_model_context *model_ctx);
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+    g_jvm = vm;
+    jni_mutex_init(&g_registry.lock);
+    jni_mutex_init(&g_registry.load_lock);
+    return JNI_VERSION_1_6;
+}
+
+// Model and engine settings requested from Java; zero fields keep the native defaults
+typedef struct {
+    struct llama_model_params model;
+    llama_engine_params engine;
+    char draft_model_path[MAX_MODEL_PATH_LENGTH];   // empty: no speculative decoding
+    char session_dir[1024];         // empty: sessions are kept in memory only
+    char cpu_sets[1024];            // empty: compute threads are not pinned
+    enum ggml_numa_strategy numa;
+    int interleave;                 // spread the weights' pages over all NUMA nodes while loading
+} load_settings;
+
+// Per-request settings from a SamplingParams
+typedef struct {
+    int max_tokens;
+    llama_sampling_params sampling;
+    uint64_t session_id;    // 0: not part of a conversation
+    jstring grammar;        // local ref to the GBNF text, copied into the job's arena; NULL = none
+} request_settings;
+
+static int get_int_option(JNIEnv *env, jclass cls, jobject options, const char *name) {
+    if ((*env)->ExceptionCheck(env)) {
+        return 0;
+    }
+    jfieldID field = (*env)->GetFieldID(env, cls, name, "I");
+    return field != NULL ? (*env)->GetIntField(env, options, field) : 0;
+}
+
+static int get_bool_option(JNIEnv *env, jclass cls, jobject options, const char *name) {
+    if ((*env)->ExceptionCheck(env)) {
         return 0;
     }
+    jfieldID field = (*env)->GetFieldID(env, cls, name, "Z");
+    return field != NULL && (*env)->GetBooleanField(env, options, field) == JNI_TRUE;
+}
 
-    const char *model_path = (*env)->GetStringUTFChars(env, path, 0);
-    if (model_path == NULL) {
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"), 
-                        "Failed to get string from JNI");
+static float get_float_option(JNIEnv *env, jclass cls, jobject options, const char *name) {
+    if ((*env)->ExceptionCheck(env)) {
+        return 0.0f;
+    }
+    jfieldID field = (*env)->GetFieldID(env, cls, name, "F");
+    return field != NULL ? (*env)->GetFloatField(env, options, field) : 0.0f;
+}
+
+static jlong get_long_option(JNIEnv *env, jclass cls, jobject options, const char *name) {
+    if ((*env)->ExceptionCheck(env)) {
+        return 0;
+    }
+    jfieldID field = (*env)->GetFieldID(env, cls, name, "J");
+    return field != NULL ? (*env)->GetLongField(env, options, field) : 0;
+}
+
+// Copies a String field into buf; null leaves it empty
+static void get_string_option(JNIEnv *env, jclass cls, jobject options, const char *name, char *buf, size_t size) {
+    buf[0] = '\0';
+    if ((*env)->ExceptionCheck(env)) {
+        return;
+    }
+    jfieldID field = (*env)->GetFieldID(env, cls, name, "Ljava/lang/String;");
+    jstring value = field != NULL ? (jstring)(*env)->GetObjectField(env, options, field) : NULL;
+    if (value == NULL) {
+        return;
+    }
+    const char *chars = (*env)->GetStringUTFChars(env, value, 0);
+    if (chars != NULL) {
+        strncpy(buf, chars, size - 1);
+        buf[size - 1] = '\0';
+        (*env)->ReleaseStringUTFChars(env, value, chars);
+    }
+    (*env)->DeleteLocalRef(env, value);
+}
+
+// Copy a com.livecoding.demo.LoadOptions into native parameters; returns -1 with an exception pending on failure
+static int read_load_options(JNIEnv *env, jobject options, load_settings *settings) {
+    settings->model = llama_model_default_params();
+    settings->model.n_gpu_layers = 0; // CPU only unless requested
+    llama_engine_default_params(&settings->engine);
+    settings->draft_model_path[0] = '\0';
+    settings->session_dir[0] = '\0';
+    settings->cpu_sets[0] = '\0';
+    settings->numa = GGML_NUMA_STRATEGY_DISABLED;
+    settings->interleave = 0;
+
+    if (options == NULL) {
         return 0;
     }
 
+    jclass cls = (*env)->GetObjectClass(env, options);
+    int n_gpu_layers = get_int_option(env, cls, options, "gpuLayers");
+    int use_mmap = get_bool_option(env, cls, options, "useMmap");
+    int use_mlock = get_bool_option(env, cls, options, "useMlock");
+    int warmup = get_bool_option(env, cls, options, "warmup");
+    int context_shift = get_bool_option(env, cls, options, "contextShift");
+
+    llama_engine_params *engine = &settings->engine;
+    engine->n_ctx_per_seq = get_int_option(env, cls, options, "contextLength");
+    engine->n_contexts = get_int_option(env, cls, options, "contexts");
+    engine->n_seq_per_context = get_int_option(env, cls, options, "sequencesPerContext");
+    engine->n_threads = get_int_option(env, cls, options, "threads");
+    engine->n_threads_batch = get_int_option(env, cls, options, "threadsBatch");
+    get_string_option(env, cls, options, "cpuSets", settings->cpu_sets, sizeof(settings->cpu_sets));
+    char numa[16];
+    get_string_option(env, cls, options, "numa", numa, sizeof(numa));
+    char flash_attn[8];
+    get_string_option(env, cls, options, "flashAttention", flash_attn, sizeof(flash_attn));
+    engine->n_batch = get_int_option(env, cls, options, "batchSize");
+    engine->n_ubatch = get_int_option(env, cls, options, "ubatchSize");
+    engine->n_prefill_chunk = get_int_option(env, cls, options, "prefillChunk");
+    engine->deadline_ms = get_int_option(env, cls, options, "deadlineMillis");
+    engine->n_draft = get_int_option(env, cls, options, "draftTokens");
+    get_string_option(env, cls, options, "draftModelPath", settings->draft_model_path,
+                      sizeof(settings->draft_model_path));
+    engine->session_memory_mb = get_int_option(env, cls, options, "sessionMemoryMb");
+    engine->session_disk_mb = get_int_option(env, cls, options, "sessionDiskMb");
+    get_string_option(env, cls, options, "sessionDir", settings->session_dir, sizeof(settings->session_dir));
+    engine->n_keep = get_int_option(env, cls, options, "keepTokens");
+    (*env)->DeleteLocalRef(env, cls);
+
+    // A missing field leaves NoSuchFieldError pending
+    if ((*env)->ExceptionCheck(env)) {
+        return -1;
+    }
+
+    if (n_gpu_layers < 0 || engine->n_ctx_per_seq < 0 || engine->n_contexts < 0
+            || engine->n_seq_per_context < 0 || engine->n_threads < 0 || engine->n_threads_batch < 0
+            || engine->n_batch < 0 || engine->n_ubatch < 0 || engine->n_prefill_chunk < 0
+            || engine->deadline_ms < 0 || engine->n_draft < 0
+            || engine->session_memory_mb < 0 || engine->session_disk_mb < 0 || engine->n_keep < 0) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Load options cannot be negative");
+        return -1;
+    }
+
+    // "interleave" is distribute plus interleaved weights
+    if (strcmp(numa, "distribute") == 0 || strcmp(numa, "interleave") == 0) {
+        settings->numa = GGML_NUMA_STRATEGY_DISTRIBUTE;
+        settings->interleave = numa[0] == 'i';
+    } else if (strcmp(numa, "isolate") == 0) {
+        settings->numa = GGML_NUMA_STRATEGY_ISOLATE;
+    } else if (strcmp(numa, "numactl") == 0) {
+        settings->numa = GGML_NUMA_STRATEGY_NUMACTL;
+    } else if (numa[0] != '\0') {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Unknown NUMA strategy");
+        return -1;
+    }
+
+    // Unset or "auto" leaves the choice to llama.cpp, which enables it where the backend supports it
+    if (strcmp(flash_attn, "on") == 0) {
+        engine->flash_attn = 1;
+    } else if (strcmp(flash_attn, "off") == 0) {
+        engine->flash_attn = -1;
+    } else if (flash_attn[0] != '\0' && strcmp(flash_attn, "auto") != 0) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Unknown flash attention mode");
+        return -1;
+    }
+
+    settings->model.n_gpu_layers = n_gpu_layers;
+    settings->model.use_mmap = use_mmap;
+    settings->model.use_mlock = use_mlock;
+    engine->session_dir = settings->session_dir[0] != '\0' ? settings->session_dir : NULL;
+    engine->cpu_sets = settings->cpu_sets[0] != '\0' ? settings->cpu_sets : NULL;
+    engine->warmup = warmup;
+    engine->context_shift = context_shift;
+    return 0;
+}
+
+// Load the model(s) and start the engine; throws and returns NULL on failure
+static llama_model_context* create_model_context(JNIEnv *env, const char *model_path, load_settings *settings) {
+    // Allocate the model context structure up front so the path can be kept for getModelInfo
+    llama_model_context *model_ctx = (llama_model_context*)calloc(1, sizeof(llama_model_context));
+    if (model_ctx == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to allocate memory for model context");
+        return NULL;
+    }
+    strncpy(model_ctx->model_path, model_path, sizeof(model_ctx->model_path) - 1);
+
     // Initialize llama backend
     llama_backend_init();
-    
-    // Set model parameters
-    struct llama_model_params model_params = llama_model_default_params();
-    model_params.n_gpu_layers = 0; // CPU only for now
-    
+
+    // Process-wide, so the first load that asks for a NUMA strategy picks it
+    if (settings->numa != GGML_NUMA_STRATEGY_DISABLED) {
+        static int numa_initialized;
+        jni_mutex_lock(&g_registry.lock);
+        if (!numa_initialized) {
+            llama_numa_init(settings->numa);
+            numa_initialized = 1;
+        }
+        jni_mutex_unlock(&g_registry.lock);
+    }
+
+    // Pages this thread allocates from here to the prefetch below, read buffers without mmap
+    // and page cache with it, go to the nodes in turn, so every context reads the weights at
+    // the same average distance instead of all from the loader's node
+    int interleaved = settings->interleave && jni_interleave_memory(1) == 0;
+
     // Load model using new API
-    struct llama_model *model = llama_model_load_from_file(model_path, model_params);
-    (*env)->ReleaseStringUTFChars(env, path, model_path);
-    
+    struct llama_model *model = llama_model_load_from_file(model_path, settings->model);
+
     if (model == NULL) {
+        if (interleaved) {
+            jni_interleave_memory(0);
+        }
+        free(model_ctx);
         llama_backend_free();
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), 
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"),
                         "Failed to load model");
-        return 0;
+        return NULL;
+    }
+    model_ctx->model = model;
+    model_ctx->resident_bytes = llama_model_size(model);
+
+    // The draft model shares the main model's placement settings
+    if (settings->draft_model_path[0] != '\0') {
+        const char *error = NULL;
+        model_ctx->draft_model = llama_model_load_from_file(settings->draft_model_path, settings->model);
+        if (model_ctx->draft_model == NULL) {
+            error = "Failed to load draft model";
+        } else if (llama_vocab_n_tokens(llama_model_get_vocab(model_ctx->draft_model))
+                != llama_vocab_n_tokens(llama_model_get_vocab(model))) {
+            error = "Draft model vocabulary does not match the model";
+            llama_model_free(model_ctx->draft_model);
+        }
+        if (error != NULL) {
+            if (interleaved) {
+                jni_interleave_memory(0);
+            }
+            llama_model_free(model);
+            free(model_ctx);
+            llama_backend_free();
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), error);
+            return NULL;
+        }
+        settings->engine.draft_model = model_ctx->draft_model;
+        model_ctx->resident_bytes += llama_model_size(model_ctx->draft_model);
     }
 
-    // Set context parameters (no seed parameter in new API)
-    struct llama_context_params ctx_params = llama_context_default_params();
-    ctx_params.n_ctx = 2048;
-    ctx_params.n_threads = 4;
-    
-    // Create context using new API
-    struct llama_context *ctx = llama_init_from_model(model, ctx_params);
-    if (ctx == NULL) {
+    // Fill the page cache behind the mmap'd weights in one sequential pass instead of
+    // page faults scattered over the first decode. Under a NUMA strategy without interleaving
+    // that would put every page on this thread's node, so the compute threads fault them in.
+    if (settings->model.use_mmap && (interleaved
+            || (settings->engine.warmup && settings->numa == GGML_NUMA_STRATEGY_DISABLED))) {
+        jni_prefetch_file(model_path);
+        if (model_ctx->draft_model != NULL) {
+            jni_prefetch_file(settings->draft_model_path);
+        }
+    }
+    if (interleaved) {
+        jni_interleave_memory(0);
+    }
+
+    // Contexts, sequences and scheduler threads are owned by the engine
+    model_ctx->engine = llama_engine_create(model, &settings->engine);
+    if (model_ctx->engine == NULL) {
+        if (model_ctx->draft_model != NULL) {
+            llama_model_free(model_ctx->draft_model);
+        }
         llama_model_free(model);
+        free(model_ctx);
         llama_backend_free();
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), 
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"),
                         "Failed to create context");
-        return 0;
+        return NULL;
     }
 
-    // Create sampler chain
-    struct llama_sampler_chain_params sparams = llama_sampler_chain_default_params();
-    struct llama_sampler *sampler = llama_sampler_chain_init(sparams);
-    
-    if (sampler == NULL) {
-        llama_free(ctx);
+    if (start_completions(model_ctx) != 0) {
+        llama_engine_free(model_ctx->engine);
+        if (model_ctx->draft_model != NULL) {
+            llama_model_free(model_ctx->draft_model);
+        }
         llama_model_free(model);
+        free(model_ctx);
         llama_backend_free();
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), 
-                        "Failed to create sampler");
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"),
+                        "Failed to start completion thread");
+        return NULL;
+    }
+
+    jni_mutex_init(&model_ctx->embed_lock);
+    int n_ctx = llama_engine_n_ctx_per_seq(model_ctx->engine);
+    model_ctx->embed_n_ctx = n_ctx > EMBED_MIN_CTX ? n_ctx : EMBED_MIN_CTX;
+    model_ctx->embed_threads = settings->engine.n_threads_batch > 0
+            ? settings->engine.n_threads_batch : settings->engine.n_threads;
+    return model_ctx;
+}
+
+// Every job finishes (or fails) before the completion thread drains and exits
+static void free_model_context(llama_model_context *model_ctx) {
+    llama_engine_stop(model_ctx->engine);
+    stop_completions(model_ctx);
+    llama_engine_free(model_ctx->engine);
+    if (model_ctx->embed_ctx != NULL) {
+        llama_free(model_ctx->embed_ctx);
+    }
+    jni_mutex_destroy(&model_ctx->embed_lock);
+
+    if (model_ctx->draft_model != NULL) {
+        llama_model_free(model_ctx->draft_model);
+    }
+    if (model_ctx->model != NULL) {
+        llama_model_free(model_ctx->model);
+    }
+
+    free(model_ctx);
+    llama_backend_free();
+}
+
+static jlong load_model(JNIEnv *env, jstring path, jobject options) {
+    if (path == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Model path cannot be null");
         return 0;
     }
-    
-    // Add sampling layers to the chain
-    llama_sampler_chain_add(sampler, llama_sampler_init_top_k(40));
-    llama_sampler_chain_add(sampler, llama_sampler_init_top_p(0.9f, 1));
-    llama_sampler_chain_add(sampler, llama_sampler_init_temp(0.8f));
-    llama_sampler_chain_add(sampler, llama_sampler_init_dist(42));
 
-    // Allocate and populate the model context structure
-    llama_model_context *model_ctx = (llama_model_context*)malloc(sizeof(llama_model_context));
-    if (model_ctx == NULL) {
-        llama_sampler_free(sampler);
-        llama_free(ctx);
-        llama_model_free(model);
-        llama_backend_free();
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"), 
-                        "Failed to allocate memory for model context");
+    load_settings settings;
+    if (read_load_options(env, options, &settings) != 0) {
         return 0;
     }
-    
-    model_ctx->model = model;
-    model_ctx->ctx = ctx;
-    model_ctx->sampler = sampler;
-    
+
+    const char *model_path = (*env)->GetStringUTFChars(env, path, 0);
+    if (model_path == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to get string from JNI");
+        return 0;
+    }
+
+    llama_model_context *model_ctx = create_model_context(env, model_path, &settings);
+    (*env)->ReleaseStringUTFChars(env, path, model_path);
     return (jlong)model_ctx;
 }
 
-JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateText(JNIEnv *env, jobject obj, jlong modelHandle, jstring prompt) {
-    if (modelHandle == 0) {
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"), 
-                        "Model not loaded");
-        return NULL;
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_loadModel__Ljava_lang_String_2(JNIEnv *env, jobject obj, jstring path) {
+    return load_model(env, path, NULL);
+}
+
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_loadModel__Ljava_lang_String_2Lcom_livecoding_demo_LoadOptions_2(
+        JNIEnv *env, jobject obj, jstring path, jobject options) {
+    return load_model(env, path, options);
+}
+
+// Registry lock held: drop the model from the registry and its budget
+static void registry_unlink(llama_model_context *model_ctx) {
+    llama_model_context **link = &g_registry.head;
+    while (*link != NULL && *link != model_ctx) {
+        link = &(*link)->next;
+    }
+    if (*link != NULL) {
+        *link = model_ctx->next;
+        g_registry.resident_bytes -= model_ctx->resident_bytes;
     }
+    model_ctx->next = NULL;
+    model_ctx->evicted = 1;
+}
 
-    if (prompt == NULL) {
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"), 
-                        "Prompt cannot be null");
-        return NULL;
+// Registry lock held
+static llama_model_context* registry_find(const char *id) {
+    for (llama_model_context *model_ctx = g_registry.head; model_ctx != NULL; model_ctx = model_ctx->next) {
+        if (strcmp(model_ctx->id, id) == 0) {
+            return model_ctx;
+        }
     }
+    return NULL;
+}
 
-    llama_model_context *model_ctx = (llama_model_context*)modelHandle;
-    if (model_ctx->model == NULL || model_ctx->ctx == NULL || model_ctx->sampler == NULL) {
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalStateException"), 
-                        "Invalid model state");
-        return NULL;
+// Registry lock held: unlink idle models, least recently used first, until `incoming` more
+// bytes fit the budget. Returns them chained through next; free them once the lock is released.
+static llama_model_context* registry_evict(uint64_t incoming, llama_model_context *victims) {
+    while (g_registry.budget_bytes > 0 && g_registry.resident_bytes + incoming > g_registry.budget_bytes) {
+        llama_model_context *lru = NULL;
+        for (llama_model_context *model_ctx = g_registry.head; model_ctx != NULL; model_ctx = model_ctx->next) {
+            if (model_ctx->refs == 0 && (lru == NULL || model_ctx->last_used < lru->last_used)) {
+                lru = model_ctx;
+            }
+        }
+        if (lru == NULL) {
+            break; // everything left is in use
+        }
+        registry_unlink(lru);
+        lru->next = victims;
+        victims = lru;
     }
+    return victims;
+}
 
-    const char *prompt_text = (*env)->GetStringUTFChars(env, prompt, 0);
-    if (prompt_text == NULL) {
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"), 
-                        "Failed to get prompt string");
-        return NULL;
+// Stopping an engine joins its threads, so this never runs under the registry lock
+static void free_model_list(llama_model_context *victims) {
+    while (victims != NULL) {
+        llama_model_context *next = victims->next;
+        free_model_context(victims);
+        victims = next;
     }
+}
 
-    // Validate prompt length
-    size_t prompt_len = strlen(prompt_text);
-    if (prompt_len == 0 || prompt_len > MAX_PROMPT_LENGTH) {
-        (*env)->ReleaseStringUTFChars(env, prompt, prompt_text);
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"), 
-                        "Invalid prompt length");
+// Take a reference on a resident model; registry lock held. Only reloadModel changes which
+// file an id maps to, so the path a caller passes matters only for the load on a miss.
+static llama_model_context* registry_acquire(const char *id) {
+    llama_model_context *model_ctx = registry_find(id);
+    if (model_ctx == NULL) {
         return NULL;
     }
+    model_ctx->refs++;
+    model_ctx->last_used = ++g_registry.clock;
+    return model_ctx;
+}
 
-    // Use default max tokens
-    int max_gen_tokens = DEFAULT_MAX_TOKENS;
+// Remove a model from the registry; it is freed now if idle, otherwise by its last release
+static int registry_evict_model(llama_model_context *model_ctx) {
+    jni_mutex_lock(&g_registry.lock);
+    int idle = !model_ctx->evicted && model_ctx->refs == 0;
+    int found = !model_ctx->evicted;
+    if (found) {
+        registry_unlink(model_ctx);
+    }
+    jni_mutex_unlock(&g_registry.lock);
 
-    // Clear memory using new API
-    llama_memory_clear(llama_get_memory(model_ctx->ctx), true);
+    if (idle) {
+        free_model_context(model_ctx);
+    }
+    return found;
+}
 
-    // Tokenize the prompt
-    const int n_ctx = llama_n_ctx(model_ctx->ctx);
-    llama_token *tokens = (llama_token*)malloc(n_ctx * sizeof(llama_token));
-    if (tokens == NULL) {
-        (*env)->ReleaseStringUTFChars(env, prompt, prompt_text);
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"), 
-                        "Failed to allocate token buffer");
-        return NULL;
+// Copies a String argument into buf; throws IllegalArgumentException unless it is 1..size-1 bytes
+static int get_string_arg(JNIEnv *env, jstring value, char *buf, size_t size, const char *error) {
+    const char *chars = value != NULL ? (*env)->GetStringUTFChars(env, value, 0) : NULL;
+    size_t len = chars != NULL ? strlen(chars) : 0;
+    if (chars != NULL && len > 0 && len < size) {
+        memcpy(buf, chars, len + 1);
     }
-    
-    const struct llama_vocab * vocab = llama_model_get_vocab(model_ctx->model);
-    int n_tokens = llama_tokenize(vocab, prompt_text, prompt_len, tokens, n_ctx, true, true);
-    
-    (*env)->ReleaseStringUTFChars(env, prompt, prompt_text);
+    if (chars != NULL) {
+        (*env)->ReleaseStringUTFChars(env, value, chars);
+    }
+    if (len == 0 || len >= size) {
+        if (!(*env)->ExceptionCheck(env)) {
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"), error);
+        }
+        return -1;
+    }
+    return 0;
+}
 
-    if (n_tokens < 0) {
-        free(tokens);
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), 
-                        "Failed to tokenize prompt");
-        return NULL;
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_acquireModel(JNIEnv *env, jobject obj, jstring id,
+        jstring path, jobject options) {
+    char model_id[MAX_MODEL_ID_LENGTH + 1];
+    char model_path[MAX_MODEL_PATH_LENGTH];
+    if (get_string_arg(env, id, model_id, sizeof(model_id), "Invalid model id") != 0
+            || get_string_arg(env, path, model_path, sizeof(model_path), "Invalid model path") != 0) {
+        return 0;
     }
 
-    if (n_tokens >= n_ctx) {
-        free(tokens);
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"), 
-                        "Prompt too long for context");
-        return NULL;
+    // Fast path: the model is resident
+    jni_mutex_lock(&g_registry.lock);
+    llama_model_context *model_ctx = registry_acquire(model_id);
+    jni_mutex_unlock(&g_registry.lock);
+    if (model_ctx != NULL) {
+        return (jlong)model_ctx;
     }
 
-    // Create batch for prompt evaluation
-    struct llama_batch batch = llama_batch_get_one(tokens, n_tokens);
+    load_settings settings;
+    if (read_load_options(env, options, &settings) != 0) {
+        return 0;
+    }
 
-    // Evaluate the prompt
-    if (llama_decode(model_ctx->ctx, batch) != 0) {
-        free(tokens);
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), 
-                        "Failed to evaluate prompt");
-        return NULL;
+    jni_mutex_lock(&g_registry.load_lock);
+    jni_mutex_lock(&g_registry.lock);
+    model_ctx = registry_acquire(model_id); // loaded while we waited
+    llama_model_context *victims = NULL;
+    if (model_ctx == NULL) {
+        // Make room before loading; the file size is close to what the weights take
+        long long file_size = jni_file_size(model_path);
+        victims = registry_evict(file_size > 0 ? (uint64_t)file_size : 0, NULL);
     }
+    jni_mutex_unlock(&g_registry.lock);
+    free_model_list(victims);
 
-    // Generate response
-    char *response = (char*)malloc(MAX_RESPONSE_LENGTH);
-    if (response == NULL) {
-        free(tokens);
-        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"), 
-                        "Failed to allocate response buffer");
-        return NULL;
+    if (model_ctx == NULL) {
+        model_ctx = create_model_context(env, model_path, &settings);
+        if (model_ctx != NULL) {
+            strcpy(model_ctx->id, model_id);
+            model_ctx->refs = 1;
+
+            jni_mutex_lock(&g_registry.lock);
+            model_ctx->last_used = ++g_registry.clock;
+            model_ctx->next = g_registry.head;
+            g_registry.head = model_ctx;
+            g_registry.resident_bytes += model_ctx->resident_bytes;
+            victims = registry_evict(0, NULL);
+            jni_mutex_unlock(&g_registry.lock);
+            free_model_list(victims);
+        }
     }
+    jni_mutex_unlock(&g_registry.load_lock);
+    return (jlong)model_ctx;
+}
 
-    int response_pos = 0;
-    int generated_tokens = 0;
+// Blue/green swap: the new model loads while the old one keeps serving, then the id is pointed
+// at it in one step. Requests holding the old model finish on it; it is freed by their last
+// release. On failure the old model stays in place.
+JNIEXPORT jboolean JNICALL Java_com_livecoding_demo_LlamaJNI_reloadModel(JNIEnv *env, jobject obj, jstring id,
+        jstring path, jobject options) {
+    char model_id[MAX_MODEL_ID_LENGTH + 1];
+    char model_path[MAX_MODEL_PATH_LENGTH];
+    load_settings settings;
+    if (get_string_arg(env, id, model_id, sizeof(model_id), "Invalid model id") != 0
+            || get_string_arg(env, path, model_path, sizeof(model_path), "Invalid model path") != 0
+            || read_load_options(env, options, &settings) != 0) {
+        return JNI_FALSE;
+    }
 
-    for (int i = 0; i < max_gen_tokens && response_pos < MAX_RESPONSE_LENGTH - 256; i++) {
-        // Sample next token using the sampler chain
-        llama_token next_token = llama_sampler_sample(model_ctx->sampler, model_ctx->ctx, -1);
+    jni_mutex_lock(&g_registry.load_lock);
 
-        // Check for end token
-        if (next_token == llama_token_eos(model_ctx->model)) {
-            break;
+    // Both copies are resident for a while; make room among the other idle models
+    jni_mutex_lock(&g_registry.lock);
+    long long file_size = jni_file_size(model_path);
+    llama_model_context *victims = registry_evict(file_size > 0 ? (uint64_t)file_size : 0, NULL);
+    jni_mutex_unlock(&g_registry.lock);
+    free_model_list(victims);
+
+    llama_model_context *model_ctx = create_model_context(env, model_path, &settings);
+    if (model_ctx != NULL) {
+        strcpy(model_ctx->id, model_id);
+
+        jni_mutex_lock(&g_registry.lock);
+        llama_model_context *old = registry_find(model_id);
+        victims = NULL;
+        if (old != NULL) {
+            registry_unlink(old);
+            if (old->refs == 0) {
+                victims = old;
+            }
         }
+        model_ctx->last_used = ++g_registry.clock;
+        model_ctx->next = g_registry.head;
+        g_registry.head = model_ctx;
+        g_registry.resident_bytes += model_ctx->resident_bytes;
+        model_ctx->refs = 1; // never trim the model that was just swapped in
+        victims = registry_evict(0, victims);
+        model_ctx->refs = 0;
+        jni_mutex_unlock(&g_registry.lock);
+        free_model_list(victims);
+    }
+    jni_mutex_unlock(&g_registry.load_lock);
+    return model_ctx != NULL ? JNI_TRUE : JNI_FALSE;
+}
 
-        // Accept the token (updates sampler state)
-        llama_sampler_accept(model_ctx->sampler, next_token);
+JNIEXPORT void JNICALL Java_com_livecoding_demo_LlamaJNI_releaseModel(JNIEnv *env, jobject obj, jlong modelHandle) {
+    if (modelHandle == 0) {
+        return;
+    }
 
-        // Convert token to text using correct API
-        char token_str[256];
-        int token_len = llama_token_to_piece(vocab, next_token, token_str, sizeof(token_str), 0, false);
-        
-        if (token_len > 0 && response_pos + token_len < MAX_RESPONSE_LENGTH - 1) {
-            memcpy(response + response_pos, token_str, token_len);
-            response_pos += token_len;
+    llama_model_context *model_ctx = (llama_model_context*)modelHandle;
+    llama_model_context *victims = NULL;
+    jni_mutex_lock(&g_registry.lock);
+    if (model_ctx->refs > 0 && --model_ctx->refs == 0) {
+        if (model_ctx->evicted) {
+            victims = model_ctx;
+        } else {
+            victims = registry_evict(0, NULL); // it may have been kept over budget while in use
         }
+    }
+    jni_mutex_unlock(&g_registry.lock);
+    free_model_list(victims);
+}
 
-        // Create batch for single token
-        struct llama_batch next_batch = llama_batch_get_one(&next_token, 1);
+JNIEXPORT jboolean JNICALL Java_com_livecoding_demo_LlamaJNI_evictModel(JNIEnv *env, jobject obj, jstring id) {
+    char model_id[MAX_MODEL_ID_LENGTH + 1];
+    if (get_string_arg(env, id, model_id, sizeof(model_id), "Invalid model id") != 0) {
+        return JNI_FALSE;
+    }
 
-        // Evaluate the new token
-        if (llama_decode(model_ctx->ctx, next_batch) != 0) {
-            break;
+    jni_mutex_lock(&g_registry.lock);
+    llama_model_context *model_ctx = registry_find(model_id);
+    int idle = model_ctx != NULL && model_ctx->refs == 0;
+    if (model_ctx != NULL) {
+        registry_unlink(model_ctx);
+    }
+    jni_mutex_unlock(&g_registry.lock);
+
+    if (idle) {
+        free_model_context(model_ctx);
+    }
+    return model_ctx != NULL ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL Java_com_livecoding_demo_LlamaJNI_setModelMemoryBudget(JNIEnv *env, jobject obj, jlong bytes) {
+    if (bytes < 0) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Memory budget cannot be negative");
+        return;
+    }
+
+    jni_mutex_lock(&g_registry.lock);
+    g_registry.budget_bytes = (uint64_t)bytes;
+    llama_model_context *victims = registry_evict(0, NULL);
+    jni_mutex_unlock(&g_registry.lock);
+    free_model_list(victims);
+}
+
+// Resident model ids, most recently used first
+JNIEXPORT jobjectArray JNICALL Java_com_livecoding_demo_LlamaJNI_residentModels(JNIEnv *env, jobject obj) {
+    jni_mutex_lock(&g_registry.lock);
+    jsize count = 0;
+    for (llama_model_context *model_ctx = g_registry.head; model_ctx != NULL; model_ctx = model_ctx->next) {
+        count++;
+    }
+    char (*ids)[MAX_MODEL_ID_LENGTH + 1] = count > 0 ? malloc((size_t)count * sizeof(*ids)) : NULL;
+    uint64_t *used = count > 0 ? malloc((size_t)count * sizeof(*used)) : NULL;
+    jsize n = 0;
+    if (count == 0 || (ids != NULL && used != NULL)) {
+        for (llama_model_context *model_ctx = g_registry.head; model_ctx != NULL; model_ctx = model_ctx->next) {
+            // Insertion sort on last_used, newest first
+            jsize i = n++;
+            while (i > 0 && used[i - 1] < model_ctx->last_used) {
+                memcpy(ids[i], ids[i - 1], sizeof(ids[i]));
+                used[i] = used[i - 1];
+                i--;
+            }
+            memcpy(ids[i], model_ctx->id, sizeof(ids[i]));
+            used[i] = model_ctx->last_used;
         }
+    }
+    jni_mutex_unlock(&g_registry.lock);
 
-        generated_tokens++;
+    jobjectArray result = NULL;
+    jclass string_class = (*env)->FindClass(env, "java/lang/String");
+    if (count > 0 && n == 0) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to list models");
+    } else if (string_class != NULL) {
+        result = (*env)->NewObjectArray(env, n, string_class, NULL);
+        for (jsize i = 0; result != NULL && i < n; i++) {
+            jstring id = (*env)->NewStringUTF(env, ids[i]);
+            if (id == NULL) {
+                result = NULL;
+                break;
+            }
+            (*env)->SetObjectArrayElement(env, result, i, id);
+            (*env)->DeleteLocalRef(env, id);
+        }
     }
+    free(ids);
+    free(used);
+    return result;
+}
 
-    // Null-terminate the response
-    response[response_pos] = '\0';
+// Metrics of the model registered under id, or null when none is. Element order follows the
+// index constants in LlamaMetrics.
+JNIEXPORT jlongArray JNICALL Java_com_livecoding_demo_LlamaJNI_getMetrics(JNIEnv *env, jobject obj, jstring id) {
+    char model_id[MAX_MODEL_ID_LENGTH + 1];
+    if (get_string_arg(env, id, model_id, sizeof(model_id), "Invalid model id") != 0) {
+        return NULL;
+    }
 
-    // Create Java string from response
-    jstring result = (*env)->NewStringUTF(env, response);
-    free(response);
-    free(tokens);
+    // Freeing a model unlinks it first, so the engine outlives this lookup
+    llama_engine_stats stats;
+    jni_mutex_lock(&g_registry.lock);
+    llama_model_context *model_ctx = registry_find(model_id);
+    if (model_ctx != NULL) {
+        llama_engine_get_stats(model_ctx->engine, &stats);
+    }
+    jni_mutex_unlock(&g_registry.lock);
+    if (model_ctx == NULL) {
+        return NULL;
+    }
 
+    jlong values[] = {
+        (jlong)stats.n_jobs, (jlong)stats.n_jobs_failed,
+        (jlong)stats.n_started, stats.t_queue_us,
+        (jlong)stats.n_prefilled, stats.t_prefill_us, stats.t_first_token_us, stats.t_decode_us,
+        (jlong)stats.n_prompt_tokens, (jlong)stats.n_prompt_reused,
+        (jlong)stats.n_generated, (jlong)stats.n_decoded,
+        (jlong)stats.n_draft_proposed, (jlong)stats.n_draft_accepted,
+        (jlong)stats.n_context_shifts, (jlong)stats.n_tokens_discarded,
+        stats.perf_t_prompt_eval_us, stats.perf_t_eval_us,
+        (jlong)stats.perf_n_prompt_eval, (jlong)stats.perf_n_eval,
+        stats.n_queued, stats.n_active, stats.n_sequences, stats.n_kv_used, stats.n_kv_total
+    };
+    jsize count = (jsize)(sizeof(values) / sizeof(values[0]));
+    jlongArray result = (*env)->NewLongArray(env, count);
+    if (result != NULL) {
+        (*env)->SetLongArrayRegion(env, result, 0, count, values);
+    }
     return result;
 }
 
-JNIEXPORT void JNICALL Java_com_livecoding_demo_LlamaJNI_unloadModel(JNIEnv *env, jobject obj, jlong modelHandle) {
+// Resolve and validate a model handle passed in from Java; throws and returns NULL if unusable
+static llama_model_context* get_model_context(JNIEnv *env, jlong modelHandle) {
     if (modelHandle == 0) {
-        return; // Already unloaded or never loaded
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Model not loaded");
+        return NULL;
     }
 
     llama_model_context *model_ctx = (llama_model_context*)modelHandle;
-    
-    if (model_ctx->sampler != NULL) {
-        llama_sampler_free(model_ctx->sampler);
+    if (model_ctx->model == NULL || model_ctx->engine == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalStateException"),
+                        "Invalid model state");
+        return NULL;
     }
-    
-    if (model_ctx->ctx != NULL) {
-        llama_free(model_ctx->ctx);
+    return model_ctx;
+}
+
+// Build a java.lang.String from real UTF-8 bytes (NewStringUTF expects modified UTF-8 and
+// mangles supplementary characters such as emoji)
+static jstring new_string_utf8(JNIEnv *env, const char *bytes, size_t len) {
+    jbyteArray array = (*env)->NewByteArray(env, (jsize)len);
+    if (array == NULL) {
+        return NULL;
     }
-    
-    if (model_ctx->model != NULL) {
-        llama_model_free(model_ctx->model);
+    (*env)->SetByteArrayRegion(env, array, 0, (jsize)len, (const jbyte*)bytes);
+
+    jclass string_class = (*env)->FindClass(env, "java/lang/String");
+    jmethodID ctor = (*env)->GetMethodID(env, string_class, "<init>", "([BLjava/lang/String;)V");
+    jstring charset = (*env)->NewStringUTF(env, "UTF-8");
+    jstring result = (jstring)(*env)->NewObject(env, string_class, ctor, array, charset);
+
+    (*env)->DeleteLocalRef(env, charset);
+    (*env)->DeleteLocalRef(env, array);
+    (*env)->DeleteLocalRef(env, string_class);
+    return result;
+}
+
+// Length of the longest prefix of buf that does not end inside a multi-byte UTF-8 sequence
+static size_t utf8_complete_length(const char *buf, size_t len) {
+    size_t i = len;
+    int back = 0;
+    while (i > 0 && back < 4) {
+        unsigned char c = (unsigned char)buf[i - 1];
+        back++;
+        if ((c & 0xC0) != 0x80) {
+            size_t need = (c & 0x80) == 0 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : 4;
+            return (size_t)back >= need ? len : i - 1;
+        }
+        i--;
     }
-    
-    free(model_ctx);
-    llama_backend_free();
+    return len;
+}
+
+// Session ids are hashed to the engine's 64-bit ids (FNV-1a over the UTF-16 units). Two ids
+// that collide only share a cache entry, which is matched token by token before it is used.
+static uint64_t read_session_id(JNIEnv *env, jclass cls, jobject sampling) {
+    if ((*env)->ExceptionCheck(env)) {
+        return 0;
+    }
+    jfieldID field = (*env)->GetFieldID(env, cls, "sessionId", "Ljava/lang/String;");
+    jstring value = field != NULL ? (jstring)(*env)->GetObjectField(env, sampling, field) : NULL;
+    if (value == NULL) {
+        return 0;
+    }
+
+    jsize n_units = (*env)->GetStringLength(env, value);
+    if (n_units == 0 || n_units > MAX_SESSION_ID_LENGTH) {
+        (*env)->DeleteLocalRef(env, value);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Invalid session id");
+        return 0;
+    }
+
+    jchar units[MAX_SESSION_ID_LENGTH];
+    (*env)->GetStringRegion(env, value, 0, n_units, units);
+    (*env)->DeleteLocalRef(env, value);
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (jsize i = 0; i < n_units; i++) {
+        hash = (hash ^ units[i]) * 0x100000001b3ULL;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// Copy a com.livecoding.demo.SamplingParams (NULL keeps the defaults); returns -1 with an exception pending on failure
+static int read_sampling_params(JNIEnv *env, jobject sampling, request_settings *settings) {
+    llama_sampling_params *params = &settings->sampling;
+    settings->max_tokens = DEFAULT_MAX_TOKENS;
+    settings->session_id = 0;
+    settings->grammar = NULL;
+    llama_sampling_default_params(params);
+
+    if (sampling == NULL) {
+        return 0;
+    }
+
+    jclass cls = (*env)->GetObjectClass(env, sampling);
+    int n_max = get_int_option(env, cls, sampling, "maxTokens");
+    float temperature = get_float_option(env, cls, sampling, "temperature");
+    int top_k = get_int_option(env, cls, sampling, "topK");
+    float top_p = get_float_option(env, cls, sampling, "topP");
+    jlong seed = get_long_option(env, cls, sampling, "seed");
+    settings->session_id = read_session_id(env, cls, sampling);
+    jfieldID grammar_field = !(*env)->ExceptionCheck(env)
+        ? (*env)->GetFieldID(env, cls, "grammar", "Ljava/lang/String;") : NULL;
+    jstring grammar = grammar_field != NULL ? (jstring)(*env)->GetObjectField(env, sampling, grammar_field) : NULL;
+    (*env)->DeleteLocalRef(env, cls);
+
+    if ((*env)->ExceptionCheck(env)) {
+        return -1;
+    }
+
+    if (grammar != NULL) {
+        jsize n_units = (*env)->GetStringLength(env, grammar);
+        if (n_units == 0 || n_units > MAX_GRAMMAR_LENGTH) {
+            (*env)->DeleteLocalRef(env, grammar);
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                            "Invalid grammar length");
+            return -1;
+        }
+        settings->grammar = grammar;
+    }
+
+    // Negated comparisons so NaN is rejected too
+    if (n_max <= 0 || !(temperature >= 0.0f) || top_k < 0 || !(top_p > 0.0f && top_p <= 1.0f)
+            || seed < 0 || seed > 0xFFFFFFFFLL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Invalid sampling parameters");
+        return -1;
+    }
+
+    settings->max_tokens = n_max;
+    params->temperature = temperature;
+    params->top_k = top_k;
+    params->top_p = top_p;
+    params->seed = (uint32_t)seed;
+    return 0;
+}
+
+// Return the job's buffers to the engine for the next request
+static void release_job(llama_model_context *model_ctx, llama_job *job) {
+    llama_engine_release_arena(model_ctx->engine, job->arena);
+    llama_job_destroy(job);
+}
+
+// Convert UTF-16 to standard UTF-8 (4-byte sequences for supplementary characters, unlike the
+// modified UTF-8 of GetStringUTFChars). dst needs 3 bytes per unit; returns the bytes written.
+static size_t utf16_to_utf8(const jchar *src, jsize n_units, char *dst) {
+    unsigned char *out = (unsigned char*)dst;
+    for (jsize i = 0; i < n_units; i++) {
+        unsigned int c = src[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < n_units && src[i + 1] >= 0xDC00 && src[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (src[++i] - 0xDC00);
+        } else if (c >= 0xD800 && c <= 0xDFFF) {
+            c = 0xFFFD; // unpaired surrogate
+        }
+
+        if (c < 0x80) {
+            *out++ = (unsigned char)c;
+        } else if (c < 0x800) {
+            *out++ = (unsigned char)(0xC0 | (c >> 6));
+            *out++ = (unsigned char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            *out++ = (unsigned char)(0xE0 | (c >> 12));
+            *out++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+            *out++ = (unsigned char)(0x80 | (c & 0x3F));
+        } else {
+            *out++ = (unsigned char)(0xF0 | (c >> 18));
+            *out++ = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+            *out++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+            *out++ = (unsigned char)(0x80 | (c & 0x3F));
+        }
+    }
+    return (size_t)(out - (unsigned char*)dst);
+}
+
+// Copy the grammar into the arena's text scratch as UTF-8, NUL-terminated, and drop the local ref
+static int copy_grammar(JNIEnv *env, llama_job_arena *arena, jstring grammar) {
+    jsize n_units = (*env)->GetStringLength(env, grammar);
+    const jchar *chars = NULL;
+    if (llama_job_arena_reserve_text(arena, (size_t)n_units * 3 + 1) == 0) {
+        chars = (*env)->GetStringCritical(env, grammar, NULL);
+    }
+    if (chars != NULL) {
+        size_t len = utf16_to_utf8(chars, n_units, arena->text);
+        (*env)->ReleaseStringCritical(env, grammar, chars);
+        arena->text[len] = '\0';
+    }
+    (*env)->DeleteLocalRef(env, grammar);
+    return chars != NULL ? 0 : -1;
+}
+
+// Tokenize UTF-8 prompt bytes into a ready-to-submit job backed by the arena. On failure the
+// arena is returned to the engine, an exception is thrown and -1 is returned.
+static int prepare_job_tokens(JNIEnv *env, llama_model_context *model_ctx, llama_job_arena *arena,
+                              const char *text, size_t text_len, size_t max_len,
+                              const request_settings *settings, llama_job *job) {
+    // Validate prompt length
+    if (text_len == 0 || text_len > max_len) {
+        llama_engine_release_arena(model_ctx->engine, arena);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Invalid prompt length");
+        return -1;
+    }
+
+    // Tokenize the prompt; each sequence owns n_ctx_per_seq cells of the shared KV cache
+    const int n_ctx = llama_engine_n_ctx_per_seq(model_ctx->engine);
+    const struct llama_vocab * vocab = llama_model_get_vocab(model_ctx->model);
+    int n_tokens = llama_tokenize(vocab, text, (int32_t)text_len, arena->tokens, n_ctx, true, true);
+
+    // With context shifting the middle of a prompt that does not fit is dropped instead
+    int n_truncated = 0;
+    if (n_tokens < 0 && llama_engine_context_shift(model_ctx->engine)) {
+        int n_all = -n_tokens;
+        llama_token *all = (llama_token*)malloc((size_t)n_all * sizeof(llama_token));
+        n_tokens = all != NULL ? llama_tokenize(vocab, text, (int32_t)text_len, all, n_all, true, true) : 0;
+        if (n_tokens > 0) {
+            n_tokens = llama_engine_truncate_prompt(model_ctx->engine, all, n_tokens, arena->tokens);
+            n_truncated = n_all - n_tokens;
+        }
+        free(all);
+    } else if (n_tokens >= n_ctx && llama_engine_context_shift(model_ctx->engine)) {
+        int n_all = n_tokens;
+        n_tokens = llama_engine_truncate_prompt(model_ctx->engine, arena->tokens, n_all, arena->tokens);
+        n_truncated = n_all - n_tokens;
+    }
+
+    if (n_tokens == 0) {
+        llama_engine_release_arena(model_ctx->engine, arena);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"),
+                        "Failed to tokenize prompt");
+        return -1;
+    }
+
+    if (n_tokens < 0 || n_tokens >= n_ctx) {
+        llama_engine_release_arena(model_ctx->engine, arena);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Prompt too long for context");
+        return -1;
+    }
+
+    // The prompt bytes are no longer needed, so the text scratch holds the grammar from here on
+    if (settings->grammar != NULL && copy_grammar(env, arena, settings->grammar) != 0) {
+        llama_engine_release_arena(model_ctx->engine, arena);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to copy grammar");
+        return -1;
+    }
+
+    llama_job_init(job);
+    job->arena = arena;
+    job->tokens = arena->tokens;
+    job->n_tokens = n_tokens;
+    job->max_tokens = settings->max_tokens;
+    job->sampling = settings->sampling;
+    job->sampling.grammar = settings->grammar != NULL ? arena->text : NULL;
+    job->session_id = settings->session_id;
+    job->n_truncated = n_truncated;
+    job->output = arena->output;
+    job->output_cap = arena->output_cap;
+    return 0;
+}
+
+static llama_job_arena* acquire_arena(JNIEnv *env, llama_model_context *model_ctx) {
+    llama_job_arena *arena = llama_engine_acquire_arena(model_ctx->engine);
+    if (arena == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to allocate job buffers");
+    }
+    return arena;
+}
+
+// Validate and tokenize the prompt into a ready-to-submit job; throws and returns -1 on failure
+static int prepare_job(JNIEnv *env, llama_model_context *model_ctx, jstring prompt, jobject sampling, llama_job *job) {
+    if (prompt == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Prompt cannot be null");
+        return -1;
+    }
+
+    request_settings settings;
+    if (read_sampling_params(env, sampling, &settings) != 0) {
+        return -1;
+    }
+
+    jsize n_units = (*env)->GetStringLength(env, prompt);
+    if (n_units == 0 || n_units > MAX_PROMPT_LENGTH) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Invalid prompt length");
+        return -1;
+    }
+
+    llama_job_arena *arena = acquire_arena(env, model_ctx);
+    if (arena == NULL) {
+        return -1;
+    }
+    if (llama_job_arena_reserve_text(arena, (size_t)n_units * 3) != 0) {
+        llama_engine_release_arena(model_ctx->engine, arena);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to allocate job buffers");
+        return -1;
+    }
+
+    // Encode the UTF-16 chars straight into the arena; no JNI calls until the release
+    const jchar *chars = (*env)->GetStringCritical(env, prompt, NULL);
+    if (chars == NULL) {
+        llama_engine_release_arena(model_ctx->engine, arena);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to get prompt string");
+        return -1;
+    }
+    size_t text_len = utf16_to_utf8(chars, n_units, arena->text);
+    (*env)->ReleaseStringCritical(env, prompt, chars);
+
+    return prepare_job_tokens(env, model_ctx, arena, arena->text, text_len, MAX_PROMPT_LENGTH, &settings, job);
+}
+
+// Same as prepare_job for UTF-8 bytes in a direct ByteBuffer, tokenized in place. When output
+// is given, the response is decoded straight into that direct buffer as well.
+static int prepare_job_direct(JNIEnv *env, llama_model_context *model_ctx, jobject prompt, jint prompt_length,
+                              jobject sampling, jobject output, llama_job *job) {
+    const char *text = prompt != NULL ? (const char*)(*env)->GetDirectBufferAddress(env, prompt) : NULL;
+    if (text == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Prompt must be a direct ByteBuffer");
+        return -1;
+    }
+    if (prompt_length < 0 || prompt_length > (*env)->GetDirectBufferCapacity(env, prompt)) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Prompt length exceeds buffer capacity");
+        return -1;
+    }
+
+    char *output_addr = NULL;
+    jlong output_cap = 0;
+    if (output != NULL) {
+        output_addr = (char*)(*env)->GetDirectBufferAddress(env, output);
+        output_cap = (*env)->GetDirectBufferCapacity(env, output);
+        if (output_addr == NULL || output_cap < 1) {
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                            "Output must be a non-empty direct ByteBuffer");
+            return -1;
+        }
+    }
+
+    request_settings settings;
+    if (read_sampling_params(env, sampling, &settings) != 0) {
+        return -1;
+    }
+
+    llama_job_arena *arena = acquire_arena(env, model_ctx);
+    if (arena == NULL
+            || prepare_job_tokens(env, model_ctx, arena, text, (size_t)prompt_length, MAX_PROMPT_LENGTH,
+                                  &settings, job) != 0) {
+        return -1;
+    }
+
+    if (output_addr != NULL) {
+        job->output = output_addr;
+        job->output_cap = (size_t)output_cap;
+        job->output_fixed = 1;
+    }
+    return 0;
+}
+
+// Bytes of template markup expected per chat message, so one formatting pass usually suffices
+#define CHAT_MARKUP_BYTES 64
+
+// Apply the model's own chat template (tokenizer.chat_template in the GGUF) to the messages,
+// ending with the opening of the assistant's turn, and tokenize the result like a prompt.
+// Earlier turns format to the same prefix every time, so the prefix cache reuses them.
+static int prepare_chat_job(JNIEnv *env, llama_model_context *model_ctx, jobjectArray roles,
+                            jobjectArray contents, jobject sampling, llama_job *job) {
+    jsize n_msg = roles != NULL && contents != NULL ? (*env)->GetArrayLength(env, roles) : 0;
+    if (n_msg == 0 || n_msg > MAX_CHAT_MESSAGES || (*env)->GetArrayLength(env, contents) != n_msg) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Invalid chat messages");
+        return -1;
+    }
+
+    const char *tmpl = llama_model_chat_template(model_ctx->model, NULL);
+    if (tmpl == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalStateException"),
+                        "Model has no chat template");
+        return -1;
+    }
+
+    request_settings settings;
+    if (read_sampling_params(env, sampling, &settings) != 0) {
+        return -1;
+    }
+
+    // First pass: validate and size the messages. Element i of the pair is roles[i] or contents[i].
+    size_t n_units = 0;
+    for (jsize i = 0; i < 2 * n_msg; i++) {
+        jstring value = (jstring)(*env)->GetObjectArrayElement(env, i % 2 == 0 ? roles : contents, i / 2);
+        jsize len = value != NULL ? (*env)->GetStringLength(env, value) : -1;
+        (*env)->DeleteLocalRef(env, value);
+        if (len < 0 || (i % 2 == 0 && (len == 0 || len > MAX_CHAT_ROLE_LENGTH))) {
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                            "Invalid chat messages");
+            return -1;
+        }
+        n_units += (size_t)len;
+    }
+    if (n_units > MAX_PROMPT_LENGTH) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Invalid prompt length");
+        return -1;
+    }
+
+    // Second pass: every role and content as NUL-terminated UTF-8 in one buffer
+    size_t strings_cap = n_units * 3 + 2 * (size_t)n_msg;
+    char *strings = (char*)malloc(strings_cap);
+    llama_job_arena *arena = strings != NULL ? acquire_arena(env, model_ctx) : NULL;
+    if (arena == NULL) {
+        free(strings);
+        if (!(*env)->ExceptionCheck(env)) {
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                            "Failed to allocate chat messages");
+        }
+        return -1;
+    }
+
+    llama_chat_message msgs[MAX_CHAT_MESSAGES];
+    size_t n_bytes = 0;
+    for (jsize i = 0; i < 2 * n_msg; i++) {
+        jstring value = (jstring)(*env)->GetObjectArrayElement(env, i % 2 == 0 ? roles : contents, i / 2);
+        // The arrays may have changed since the first pass; never write past the buffer
+        jsize len = value != NULL ? (*env)->GetStringLength(env, value) : 0;
+        const jchar *chars = value != NULL && n_bytes + (size_t)len * 3 + 1 <= strings_cap
+            ? (*env)->GetStringCritical(env, value, NULL) : NULL;
+        if (chars == NULL) {
+            (*env)->DeleteLocalRef(env, value);
+            free(strings);
+            llama_engine_release_arena(model_ctx->engine, arena);
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                            "Failed to get chat message");
+            return -1;
+        }
+        char *dst = strings + n_bytes;
+        n_bytes += utf16_to_utf8(chars, len, dst);
+        (*env)->ReleaseStringCritical(env, value, chars);
+        (*env)->DeleteLocalRef(env, value);
+        strings[n_bytes++] = '\0';
+        if (i % 2 == 0) {
+            msgs[i / 2].role = dst;
+        } else {
+            msgs[i / 2].content = dst;
+        }
+    }
+
+    // The template reports the length it needs when the buffer is too small
+    int32_t n_text = -1;
+    if (llama_job_arena_reserve_text(arena, n_bytes + CHAT_MARKUP_BYTES * (size_t)n_msg) == 0) {
+        n_text = llama_chat_apply_template(tmpl, msgs, (size_t)n_msg, true, arena->text, (int32_t)arena->text_cap);
+        if (n_text > (int32_t)arena->text_cap && n_text <= MAX_CHAT_LENGTH) {
+            n_text = llama_job_arena_reserve_text(arena, (size_t)n_text) == 0
+                ? llama_chat_apply_template(tmpl, msgs, (size_t)n_msg, true, arena->text, (int32_t)arena->text_cap)
+                : -2;
+        }
+    } else {
+        n_text = -2;
+    }
+    free(strings);
+
+    if (n_text < 0) {
+        llama_engine_release_arena(model_ctx->engine, arena);
+        if (n_text == -2) {
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                            "Failed to allocate job buffers");
+        } else {
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalStateException"),
+                            "Unsupported chat template");
+        }
+        return -1;
+    }
+    return prepare_job_tokens(env, model_ctx, arena, arena->text, (size_t)n_text, MAX_CHAT_LENGTH, &settings, job);
+}
+
+static jlong next_job_id(llama_model_context *model_ctx) {
+    jni_mutex_lock(&model_ctx->completions.lock);
+    jlong id = ++model_ctx->completions.next_id;
+    jni_mutex_unlock(&model_ctx->completions.lock);
+    return id;
+}
+
+// Hand the job to the scheduler; it is decoded together with the other in-flight sequences
+static int submit_job(JNIEnv *env, llama_model_context *model_ctx, llama_job *job) {
+    if (llama_engine_submit(model_ctx->engine, job) != 0) {
+        release_job(model_ctx, job);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalStateException"),
+                        "Model is being unloaded");
+        return -1;
+    }
+    return 0;
+}
+
+// Convert a finished job into the Java result (or exception) and free it
+static jstring finish_job(JNIEnv *env, llama_model_context *model_ctx, llama_job *job) {
+    jstring result = NULL;
+    if ((*env)->ExceptionCheck(env)) {
+        // keep the exception raised by a streaming callback
+    } else if (job->error != NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), job->error);
+    } else {
+        result = new_string_utf8(env, job->output, job->output_len);
+    }
+    release_job(model_ctx, job);
+    return result;
+}
+
+static jstring generate_text(JNIEnv *env, jlong modelHandle, jstring prompt, jobject sampling) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return NULL;
+    }
+
+    llama_job job;
+    if (prepare_job(env, model_ctx, prompt, sampling, &job) != 0 || submit_job(env, model_ctx, &job) != 0) {
+        return NULL;
+    }
+    llama_engine_wait(model_ctx->engine, &job);
+
+    return finish_job(env, model_ctx, &job);
+}
+
+static jstring generate_chat(JNIEnv *env, jlong modelHandle, jobjectArray roles, jobjectArray contents,
+                             jobject sampling) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return NULL;
+    }
+
+    llama_job job;
+    if (prepare_chat_job(env, model_ctx, roles, contents, sampling, &job) != 0
+            || submit_job(env, model_ctx, &job) != 0) {
+        return NULL;
+    }
+    llama_engine_wait(model_ctx->engine, &job);
+
+    return finish_job(env, model_ctx, &job);
+}
+
+static jstring generate_text_streaming(JNIEnv *env, jlong modelHandle, jstring prompt, jobject sampling, jobject callback) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return NULL;
+    }
+
+    if (callback == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Callback cannot be null");
+        return NULL;
+    }
+
+    jclass callback_class = (*env)->GetObjectClass(env, callback);
+    jmethodID on_token = (*env)->GetMethodID(env, callback_class, "onToken", "(Ljava/lang/String;)V");
+    (*env)->DeleteLocalRef(env, callback_class);
+    if (on_token == NULL) {
+        return NULL; // NoSuchMethodError pending
+    }
+
+    llama_job job;
+    if (prepare_job(env, model_ctx, prompt, sampling, &job) != 0) {
+        return NULL;
+    }
+    job.stream = 1;
+    job.id = (uint64_t)next_job_id(model_ctx);
+    if (submit_job(env, model_ctx, &job) != 0) {
+        return NULL;
+    }
+
+    // Forward text on this (Java) thread as the scheduler publishes it, holding back any
+    // trailing bytes of an incomplete UTF-8 sequence until the rest arrives
+    char chunk[STREAM_CHUNK_SIZE];
+    size_t carry = 0;
+    size_t consumed = 0;
+    int done = 0;
+    int cancelled = 0;
+    while (!done) {
+        size_t n_read;
+        done = llama_engine_read_output(model_ctx->engine, &job, consumed,
+                                        chunk + carry, sizeof(chunk) - carry, &n_read);
+        consumed += n_read;
+
+        size_t len = carry + n_read;
+        size_t end = done ? len : utf8_complete_length(chunk, len);
+        if (end > 0 && !(*env)->ExceptionCheck(env)) {
+            jstring piece = new_string_utf8(env, chunk, end);
+            if (piece != NULL) {
+                (*env)->CallVoidMethod(env, callback, on_token, piece);
+                (*env)->DeleteLocalRef(env, piece);
+            }
+        }
+        carry = len - end;
+        memmove(chunk, chunk + end, carry);
+
+        // The callback failed (typically the client went away): free the sequence now
+        if (!cancelled && (*env)->ExceptionCheck(env)) {
+            llama_engine_cancel(model_ctx->engine, job.id);
+            cancelled = 1;
+        }
+    }
+
+    // A callback exception stays pending and is rethrown in Java once generation has finished
+    return finish_job(env, model_ctx, &job);
+}
+
+// All prompts are submitted before any is waited on, so the scheduler prefills and decodes
+// them side by side in shared batches. A prompt that fails to generate yields a null element;
+// one that fails validation fails the whole call before anything is submitted.
+static jobjectArray generate_batch(JNIEnv *env, jlong modelHandle, jobjectArray prompts, jobject sampling) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return NULL;
+    }
+
+    if (prompts == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Prompts cannot be null");
+        return NULL;
+    }
+    jsize n_prompts = (*env)->GetArrayLength(env, prompts);
+    jclass string_class = (*env)->FindClass(env, "java/lang/String");
+    jobjectArray results = string_class != NULL ? (*env)->NewObjectArray(env, n_prompts, string_class, NULL) : NULL;
+    if (results == NULL || n_prompts == 0) {
+        return results;
+    }
+
+    // The scheduler keeps pointers to submitted jobs, so they need stable addresses
+    llama_job *jobs = (llama_job*)malloc(sizeof(llama_job) * (size_t)n_prompts);
+    if (jobs == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to allocate batch jobs");
+        return NULL;
+    }
+
+    jsize n_prepared = 0;
+    while (n_prepared < n_prompts) {
+        jstring prompt = (jstring)(*env)->GetObjectArrayElement(env, prompts, n_prepared);
+        int rc = prepare_job(env, model_ctx, prompt, sampling, &jobs[n_prepared]);
+        (*env)->DeleteLocalRef(env, prompt);
+        if (rc != 0) {
+            break;
+        }
+        n_prepared++;
+    }
+    if (n_prepared < n_prompts) {
+        for (jsize i = 0; i < n_prepared; i++) {
+            release_job(model_ctx, &jobs[i]);
+        }
+        free(jobs);
+        return NULL;
+    }
+
+    jsize n_submitted = 0;
+    while (n_submitted < n_prompts && llama_engine_submit(model_ctx->engine, &jobs[n_submitted]) == 0) {
+        n_submitted++;
+    }
+
+    for (jsize i = 0; i < n_submitted; i++) {
+        llama_engine_wait(model_ctx->engine, &jobs[i]);
+        if (jobs[i].error == NULL && !(*env)->ExceptionCheck(env)) {
+            jstring text = new_string_utf8(env, jobs[i].output, jobs[i].output_len);
+            if (text != NULL) {
+                (*env)->SetObjectArrayElement(env, results, i, text);
+                (*env)->DeleteLocalRef(env, text);
+            }
+        }
+        release_job(model_ctx, &jobs[i]);
+    }
+    for (jsize i = n_submitted; i < n_prompts; i++) {
+        release_job(model_ctx, &jobs[i]);
+    }
+    free(jobs);
+
+    if (n_submitted < n_prompts && !(*env)->ExceptionCheck(env)) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalStateException"),
+                        "Model is being unloaded");
+    }
+    return (*env)->ExceptionCheck(env) ? NULL : results;
+}
+
+// Embedding context on first use (embed_lock held). Sequences share one unified KV cache that
+// is cleared for every batch, and each batch is a single micro-batch, as non-causal models need.
+// Generative models have no pooling of their own and get mean pooling.
+static struct llama_context* embed_context(llama_model_context *model_ctx) {
+    if (model_ctx->embed_ctx != NULL) {
+        return model_ctx->embed_ctx;
+    }
+
+    struct llama_context_params params = llama_context_default_params();
+    params.n_ctx = (uint32_t)model_ctx->embed_n_ctx;
+    params.n_batch = params.n_ctx;
+    params.n_ubatch = params.n_ctx;
+    params.n_seq_max = EMBED_MAX_SEQS;
+    params.kv_unified = true;
+    params.embeddings = true;
+    params.pooling_type = LLAMA_POOLING_TYPE_UNSPECIFIED;
+    if (model_ctx->embed_threads > 0) {
+        params.n_threads = model_ctx->embed_threads;
+        params.n_threads_batch = model_ctx->embed_threads;
+    }
+
+    struct llama_context *ctx = llama_init_from_model(model_ctx->model, params);
+    if (ctx != NULL && llama_pooling_type(ctx) == LLAMA_POOLING_TYPE_NONE) {
+        llama_free(ctx);
+        params.pooling_type = LLAMA_POOLING_TYPE_MEAN;
+        ctx = llama_init_from_model(model_ctx->model, params);
+    }
+    model_ctx->embed_ctx = ctx;
+    return ctx;
+}
+
+// Run the sequences in the batch and copy each pooled vector to its input's row of out
+static int embed_flush(llama_model_context *model_ctx, struct llama_context *ctx, struct llama_batch *batch,
+                       const jsize *rows, int n_seqs, float *out, int n_embd, int normalize) {
+    if (n_seqs == 0) {
+        return 0;
+    }
+
+    llama_memory_clear(llama_get_memory(ctx), true);
+    int rc = llama_model_has_encoder(model_ctx->model) && !llama_model_has_decoder(model_ctx->model)
+            ? llama_encode(ctx, *batch) : llama_decode(ctx, *batch);
+    if (rc != 0) {
+        return -1;
+    }
+
+    for (int s = 0; s < n_seqs; s++) {
+        const float *embd = llama_get_embeddings_seq(ctx, s);
+        if (embd == NULL) {
+            return -1;
+        }
+        float *row = out + (size_t)rows[s] * (size_t)n_embd;
+        double norm = 0.0;
+        for (int i = 0; i < n_embd; i++) {
+            norm += (double)embd[i] * embd[i];
+        }
+        float scale = normalize && norm > 0.0 ? (float)(1.0 / sqrt(norm)) : 1.0f;
+        for (int i = 0; i < n_embd; i++) {
+            row[i] = embd[i] * scale;
+        }
+    }
+    batch->n_tokens = 0;
+    return 0;
+}
+
+// Pooled embeddings of all inputs, written row by row (n_embd floats each, in input order) to
+// the direct FloatBuffer. Inputs are packed into shared batches of up to EMBED_MAX_SEQS
+// sequences. Returns n_embd, or throws and returns -1.
+static jint embed(JNIEnv *env, jlong modelHandle, jobjectArray inputs, jobject output, jboolean normalize) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return -1;
+    }
+
+    if (inputs == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Inputs cannot be null");
+        return -1;
+    }
+    jsize n_inputs = (*env)->GetArrayLength(env, inputs);
+    const int n_embd = llama_model_n_embd(model_ctx->model);
+
+    float *out = output != NULL ? (float*)(*env)->GetDirectBufferAddress(env, output) : NULL;
+    if (out == NULL || (*env)->GetDirectBufferCapacity(env, output) < (jlong)n_inputs * n_embd) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Output must be a direct FloatBuffer with room for every vector");
+        return -1;
+    }
+
+    jni_mutex_lock(&model_ctx->embed_lock);
+    struct llama_context *ctx = embed_context(model_ctx);
+    if (ctx == NULL) {
+        jni_mutex_unlock(&model_ctx->embed_lock);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"),
+                        "Failed to create embedding context");
+        return -1;
+    }
+
+    const int n_ctx = model_ctx->embed_n_ctx;
+    const struct llama_vocab *vocab = llama_model_get_vocab(model_ctx->model);
+    struct llama_batch batch = llama_batch_init(n_ctx, 0, 1);
+    llama_token *tokens = (llama_token*)malloc(sizeof(llama_token) * (size_t)n_ctx);
+    char *text = (char*)malloc((size_t)MAX_PROMPT_LENGTH * 3);
+    jsize rows[EMBED_MAX_SEQS];
+    int n_seqs = 0;
+    const char *error = NULL;
+    const char *error_class = "java/lang/RuntimeException";
+    batch.n_tokens = 0;
+
+    if (tokens == NULL || text == NULL) {
+        error = "Failed to allocate embedding buffers";
+        error_class = "java/lang/OutOfMemoryError";
+    }
+
+    for (jsize i = 0; i < n_inputs && error == NULL; i++) {
+        jstring input = (jstring)(*env)->GetObjectArrayElement(env, inputs, i);
+        jsize n_units = input != NULL ? (*env)->GetStringLength(env, input) : 0;
+        if (n_units == 0 || n_units > MAX_PROMPT_LENGTH) {
+            (*env)->DeleteLocalRef(env, input);
+            error = "Invalid input length";
+            error_class = "java/lang/IllegalArgumentException";
+            break;
+        }
+        const jchar *chars = (*env)->GetStringCritical(env, input, NULL);
+        if (chars == NULL) {
+            (*env)->DeleteLocalRef(env, input);
+            error = "Failed to get input string";
+            error_class = "java/lang/OutOfMemoryError";
+            break;
+        }
+        size_t text_len = utf16_to_utf8(chars, n_units, text);
+        (*env)->ReleaseStringCritical(env, input, chars);
+        (*env)->DeleteLocalRef(env, input);
+
+        int n_tokens = llama_tokenize(vocab, text, (int32_t)text_len, tokens, n_ctx, true, true);
+        if (n_tokens <= 0) {
+            error = n_tokens < 0 ? "Input too long for the embedding context" : "Failed to tokenize input";
+            error_class = "java/lang/IllegalArgumentException";
+            break;
+        }
+
+        // Run what is queued when this input does not fit next to it
+        if (n_seqs == EMBED_MAX_SEQS || batch.n_tokens + n_tokens > n_ctx) {
+            if (embed_flush(model_ctx, ctx, &batch, rows, n_seqs, out, n_embd, normalize) != 0) {
+                error = "Failed to compute embeddings";
+                break;
+            }
+            n_seqs = 0;
+        }
+
+        for (int t = 0; t < n_tokens; t++) {
+            int k = batch.n_tokens++;
+            batch.token[k] = tokens[t];
+            batch.pos[k] = t;
+            batch.n_seq_id[k] = 1;
+            batch.seq_id[k][0] = n_seqs;
+            batch.logits[k] = 1;
+        }
+        rows[n_seqs++] = i;
+    }
+
+    if (error == NULL && embed_flush(model_ctx, ctx, &batch, rows, n_seqs, out, n_embd, normalize) != 0) {
+        error = "Failed to compute embeddings";
+    }
+
+    llama_batch_free(batch);
+    free(tokens);
+    free(text);
+    jni_mutex_unlock(&model_ctx->embed_lock);
+
+    if (error != NULL) {
+        if (!(*env)->ExceptionCheck(env)) {
+            (*env)->ThrowNew(env, (*env)->FindClass(env, error_class), error);
+        }
+        return -1;
+    }
+    return n_embd;
+}
+
+// Tokenize a Java string the way prompts are (special tokens added and parsed). With tokens
+// NULL only counts them. Returns the count, or -1 with an exception thrown.
+static jint tokenize_string(JNIEnv *env, jlong modelHandle, jstring text, llama_token **tokens) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return -1;
+    }
+
+    jsize n_units = text != NULL ? (*env)->GetStringLength(env, text) : 0;
+    if (text == NULL || n_units > MAX_PROMPT_LENGTH) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Invalid text length");
+        return -1;
+    }
+
+    char *utf8 = (char*)malloc((size_t)n_units * 3 + 1);
+    if (utf8 == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to allocate tokenizer buffers");
+        return -1;
+    }
+    const jchar *chars = (*env)->GetStringCritical(env, text, NULL);
+    if (chars == NULL) {
+        free(utf8);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to get text string");
+        return -1;
+    }
+    size_t text_len = utf16_to_utf8(chars, n_units, utf8);
+    (*env)->ReleaseStringCritical(env, text, chars);
+
+    // A buffer that is too small makes llama_tokenize return minus the count it needs
+    const struct llama_vocab *vocab = llama_model_get_vocab(model_ctx->model);
+    int32_t n_tokens = -llama_tokenize(vocab, utf8, (int32_t)text_len, NULL, 0, true, true);
+    if (n_tokens >= 0 && tokens != NULL) {
+        *tokens = (llama_token*)malloc(sizeof(llama_token) * ((size_t)n_tokens + 1));
+        if (*tokens == NULL) {
+            free(utf8);
+            (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                            "Failed to allocate tokenizer buffers");
+            return -1;
+        }
+        n_tokens = llama_tokenize(vocab, utf8, (int32_t)text_len, *tokens, n_tokens + 1, true, true);
+    }
+    free(utf8);
+
+    if (n_tokens < 0) {
+        if (tokens != NULL) {
+            free(*tokens);
+        }
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"),
+                        "Failed to tokenize text");
+        return -1;
+    }
+    return n_tokens;
+}
+
+// Scheduler hook (engine lock held): hand the finished job to the completion thread
+static void async_job_done(llama_job *job, void *user_data) {
+    llama_model_context *model_ctx = (llama_model_context*)user_data;
+    completion_queue *queue = &model_ctx->completions;
+    async_job *aj = (async_job*)job;
+
+    jni_mutex_lock(&queue->lock);
+    aj->next = NULL;
+    if (queue->tail != NULL) {
+        queue->tail->next = aj;
+    } else {
+        queue->head = aj;
+    }
+    queue->tail = aj;
+    jni_cond_signal(&queue->cond);
+    jni_mutex_unlock(&queue->lock);
+}
+
+// Call the listener's onComplete/onError and free the job
+static void deliver_completion(JNIEnv *env, llama_model_context *model_ctx, async_job *aj) {
+    if (env != NULL) {
+        jclass cls = (*env)->GetObjectClass(env, aj->listener);
+        int failed = aj->job.error != NULL;
+        jmethodID method = (*env)->GetMethodID(env, cls, failed ? "onError" : "onComplete", "(Ljava/lang/String;)V");
+        jstring arg = failed ? (*env)->NewStringUTF(env, aj->job.error)
+                             : new_string_utf8(env, aj->job.output, aj->job.output_len);
+        if (method != NULL && arg != NULL) {
+            (*env)->CallVoidMethod(env, aj->listener, method, arg);
+        }
+
+        // Nobody above this thread can handle a listener exception
+        if ((*env)->ExceptionCheck(env)) {
+            (*env)->ExceptionDescribe(env);
+            (*env)->ExceptionClear(env);
+        }
+        if (arg != NULL) {
+            (*env)->DeleteLocalRef(env, arg);
+        }
+        (*env)->DeleteLocalRef(env, cls);
+        (*env)->DeleteGlobalRef(env, aj->listener);
+    }
+
+    release_job(model_ctx, &aj->job);
+    free(aj);
+}
+
+static JNI_THREAD_PROC(completion_main, arg) {
+    llama_model_context *model_ctx = (llama_model_context*)arg;
+    completion_queue *queue = &model_ctx->completions;
+
+    JNIEnv *env = NULL;
+    if ((*g_jvm)->AttachCurrentThreadAsDaemon(g_jvm, (void**)&env, NULL) != JNI_OK) {
+        env = NULL; // jobs are still freed, but listeners can't be called
+    }
+
+    for (;;) {
+        jni_mutex_lock(&queue->lock);
+        while (!queue->stopping && queue->head == NULL) {
+            jni_cond_wait(&queue->cond, &queue->lock);
+        }
+        async_job *aj = queue->head;
+        if (aj == NULL) {
+            jni_mutex_unlock(&queue->lock);
+            break; // stopping and drained
+        }
+        queue->head = aj->next;
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
+        jni_mutex_unlock(&queue->lock);
+
+        deliver_completion(env, model_ctx, aj);
+    }
+
+    if (env != NULL) {
+        (*g_jvm)->DetachCurrentThread(g_jvm);
+    }
+    JNI_THREAD_RETURN;
+}
+
+static int start_completions(llama_model_context *model_ctx) {
+    completion_queue *queue = &model_ctx->completions;
+    jni_mutex_init(&queue->lock);
+    jni_cond_init(&queue->cond);
+    if (g_jvm == NULL || jni_thread_create(&queue->thread, completion_main, model_ctx) != 0) {
+        jni_cond_destroy(&queue->cond);
+        jni_mutex_destroy(&queue->lock);
+        return -1;
+    }
+    queue->thread_started = 1;
+    return 0;
+}
+
+// Call after llama_engine_stop, once no more jobs can complete
+static void stop_completions(llama_model_context *model_ctx) {
+    completion_queue *queue = &model_ctx->completions;
+    if (!queue->thread_started) {
+        return;
+    }
+
+    jni_mutex_lock(&queue->lock);
+    queue->stopping = 1;
+    jni_cond_signal(&queue->cond);
+    jni_mutex_unlock(&queue->lock);
+
+    jni_thread_join(queue->thread);
+    queue->thread_started = 0;
+    jni_cond_destroy(&queue->cond);
+    jni_mutex_destroy(&queue->lock);
+}
+
+JNIEXPORT jlong JNICALL Java_com_livecoding_demo_LlamaJNI_submitText(JNIEnv *env, jobject obj, jlong modelHandle,
+        jstring prompt, jobject sampling, jobject listener) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return 0;
+    }
+
+    if (listener == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Listener cannot be null");
+        return 0;
+    }
+
+    async_job *aj = (async_job*)calloc(1, sizeof(async_job));
+    if (aj == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to allocate job");
+        return 0;
+    }
+
+    if (prepare_job(env, model_ctx, prompt, sampling, &aj->job) != 0) {
+        free(aj);
+        return 0;
+    }
+
+    aj->listener = (*env)->NewGlobalRef(env, listener);
+    if (aj->listener == NULL) {
+        release_job(model_ctx, &aj->job);
+        free(aj);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/OutOfMemoryError"),
+                        "Failed to reference listener");
+        return 0;
+    }
+
+    jlong id = next_job_id(model_ctx);
+    aj->job.id = (uint64_t)id;
+    aj->job.on_done = async_job_done;
+    aj->job.user_data = model_ctx;
+
+    // From here on the completion thread owns the job; it may already be gone when submit returns
+    if (llama_engine_submit(model_ctx->engine, &aj->job) != 0) {
+        (*env)->DeleteGlobalRef(env, aj->listener);
+        release_job(model_ctx, &aj->job);
+        free(aj);
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalStateException"),
+                        "Model is being unloaded");
+        return 0;
+    }
+    return id;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_livecoding_demo_LlamaJNI_cancel(JNIEnv *env, jobject obj, jlong modelHandle, jlong jobId) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return JNI_FALSE;
+    }
+    return llama_engine_cancel(model_ctx->engine, (uint64_t)jobId) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_generateText__JLjava_nio_ByteBuffer_2ILcom_livecoding_demo_SamplingParams_2Ljava_nio_ByteBuffer_2(
+        JNIEnv *env, jobject obj, jlong modelHandle, jobject prompt, jint promptLength, jobject sampling, jobject output) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    if (model_ctx == NULL) {
+        return -1;
+    }
+
+    if (output == NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"),
+                        "Output buffer cannot be null");
+        return -1;
+    }
+
+    llama_job job;
+    if (prepare_job_direct(env, model_ctx, prompt, promptLength, sampling, output, &job) != 0
+            || submit_job(env, model_ctx, &job) != 0) {
+        return -1;
+    }
+    llama_engine_wait(model_ctx->engine, &job);
+
+    // Generation stops once the buffer is full; never report a cut-off UTF-8 sequence
+    jint written = -1;
+    if (job.error != NULL) {
+        (*env)->ThrowNew(env, (*env)->FindClass(env, "java/lang/RuntimeException"), job.error);
+    } else {
+        written = (jint)utf8_complete_length(job.output, job.output_len);
+    }
+    release_job(model_ctx, &job);
+    return written;
+}
+
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateText__JLjava_lang_String_2(JNIEnv *env, jobject obj, jlong modelHandle, jstring prompt) {
+    return generate_text(env, modelHandle, prompt, NULL);
+}
+
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateText__JLjava_lang_String_2Lcom_livecoding_demo_SamplingParams_2(
+        JNIEnv *env, jobject obj, jlong modelHandle, jstring prompt, jobject sampling) {
+    return generate_text(env, modelHandle, prompt, sampling);
+}
+
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateTextStreaming__JLjava_lang_String_2Lcom_livecoding_demo_TokenCallback_2(
+        JNIEnv *env, jobject obj, jlong modelHandle, jstring prompt, jobject callback) {
+    return generate_text_streaming(env, modelHandle, prompt, NULL, callback);
+}
+
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateTextStreaming__JLjava_lang_String_2Lcom_livecoding_demo_SamplingParams_2Lcom_livecoding_demo_TokenCallback_2(
+        JNIEnv *env, jobject obj, jlong modelHandle, jstring prompt, jobject sampling, jobject callback) {
+    return generate_text_streaming(env, modelHandle, prompt, sampling, callback);
+}
+
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_generateChat(JNIEnv *env, jobject obj, jlong modelHandle,
+        jobjectArray roles, jobjectArray contents, jobject params) {
+    return generate_chat(env, modelHandle, roles, contents, params);
+}
+
+JNIEXPORT jobjectArray JNICALL Java_com_livecoding_demo_LlamaJNI_generateBatch(JNIEnv *env, jobject obj,
+        jlong modelHandle, jobjectArray prompts, jobject params) {
+    return generate_batch(env, modelHandle, prompts, params);
+}
+
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_getEmbeddingSize(JNIEnv *env, jobject obj, jlong modelHandle) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    return model_ctx != NULL ? llama_model_n_embd(model_ctx->model) : 0;
+}
+
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_embed(JNIEnv *env, jobject obj, jlong modelHandle,
+        jobjectArray inputs, jobject output, jboolean normalize) {
+    return embed(env, modelHandle, inputs, output, normalize);
+}
+
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_countTokens(JNIEnv *env, jobject obj, jlong modelHandle,
+        jstring text) {
+    return tokenize_string(env, modelHandle, text, NULL);
+}
+
+JNIEXPORT jintArray JNICALL Java_com_livecoding_demo_LlamaJNI_tokenize(JNIEnv *env, jobject obj, jlong modelHandle,
+        jstring text) {
+    llama_token *tokens = NULL;
+    jint n_tokens = tokenize_string(env, modelHandle, text, &tokens);
+    if (n_tokens < 0) {
+        return NULL;
+    }
+
+    jintArray result = (*env)->NewIntArray(env, n_tokens);
+    if (result != NULL) {
+        (*env)->SetIntArrayRegion(env, result, 0, n_tokens, (const jint*)tokens);
+    }
+    free(tokens);
+    return result;
+}
+
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_LlamaJNI_getContextSize(JNIEnv *env, jobject obj, jlong modelHandle) {
+    llama_model_context *model_ctx = get_model_context(env, modelHandle);
+    return model_ctx != NULL ? llama_engine_n_ctx_per_seq(model_ctx->engine) : 0;
+}
+
+JNIEXPORT void JNICALL Java_com_livecoding_demo_LlamaJNI_unloadModel(JNIEnv *env, jobject obj, jlong modelHandle) {
+    if (modelHandle == 0) {
+        return; // Already unloaded or never loaded
+    }
+
+    llama_model_context *model_ctx = (llama_model_context*)modelHandle;
+    if (model_ctx->id[0] != '\0') {
+        registry_evict_model(model_ctx); // acquired handles are freed by their last release
+        return;
+    }
+    free_model_context(model_ctx);
+}
+
+JNIEXPORT jstring JNICALL Java_com_livecoding_demo_LlamaJNI_getModelInfo(JNIEnv *env, jobject obj, jlong modelHandle) {
+    if (modelHandle == 0) {
+        return (*env)->NewStringUTF(env, "No model loaded");
+    }
+
+    llama_model_context *model_ctx = (llama_model_context*)modelHandle;
+    if (model_ctx->model == NULL || model_ctx->engine == NULL) {
+        return (*env)->NewStringUTF(env, "Invalid model state");
+    }
+
+    char info[1024];
+    snprintf(info, sizeof(info),
+        "Real LLaMA Model - Path: %s, Status: Loaded, "
+        "Vocab Size: %d, Context: %d, Embedding Dim: %d, Sequences in use: %d/%d, Speculative: %s",
+        model_ctx->model_path,
+        llama_vocab_n_tokens(llama_model_get_vocab(model_ctx->model)),
+        llama_engine_n_ctx_per_seq(model_ctx->engine),
+        llama_model_n_embd(model_ctx->model),
+        llama_engine_n_active(model_ctx->engine),
+        llama_engine_n_sequences(model_ctx->engine),
+        model_ctx->draft_model != NULL ? "on" : "off");
+
+    return (*env)->NewStringUTF(env, info);
+}
+
+JNIEXPORT jboolean JNICALL Java_com_livecoding_demo_LlamaJNI_isModelLoaded(JNIEnv *env, jobject obj, jlong modelHandle) {
+    if (modelHandle == 0) {
+        return JNI_FALSE;
+    }
+
+    llama_model_context *model_ctx = (llama_model_context*)modelHandle;
+    return (model_ctx->model != NULL && model_ctx->engine != NULL) ? JNI_TRUE : JNI_FALSE;
 }
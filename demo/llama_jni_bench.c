@@ -0,0 +1,956 @@
+// Standalone benchmark driver for llama_jni.c: calls the JNI entry points directly through a
+// minimal in-process JNIEnv, so the native generation path can be measured without a JVM.
+//
+//   llama_jni_bench <model.gguf> [--contexts N] [--seqs N] [--threads N] [--batch N] [--ubatch N]
+//                   [--ctx N] [--prefill-chunk N] [--gpu-layers N] [--lengths 32,256,1024]
+//                   [--tokens 64] [--concurrency 1,4,16] [--iterations 8]
+//
+// CMakeLists.txt builds it for every CPU variant (llama_jni_bench, llama_jni_bench_avx2, ...),
+// linked against the same objects as that variant's library; only the JDK headers are needed,
+// not the JVM. It is also the training workload for LLAMA_JNI_PGO. By hand:
+//   cc -O2 -I$JAVA_HOME/include -I$JAVA_HOME/include/linux -I<llama>/include
+//      llama_jni_bench.c llama_jni.c llama_engine.c -lllama -lggml -lpthread -lm
+//
+// Each result is printed as "<benchmark> <value> <unit>" on its own line. Prefill and decode
+// figures come from the engine's own metrics (getMetrics), so they exclude the JNI and
+// tokenization time around them; the concurrency, generateBatch, embed and tokenize runs
+// report end-to-end latency.
+
+#include <jni.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <llama.h>
+#include "llama_jni_platform.h"
+#include "com_livecoding_demo_LlamaJNI.h"
+
+#define BENCH_MODEL_ID "bench"
+#define BENCH_MAX_FIELDS 24
+#define BENCH_MAX_LIST 8
+#define BENCH_PROMPT_MAX 4000   // LlamaJNI's prompt limit, in UTF-16 units
+
+// Order of LlamaMetrics' index constants
+enum {
+    M_PREFILLED = 4, M_PREFILL_TIME = 5, M_FIRST_TOKEN_TIME = 6, M_DECODE_TIME = 7,
+    M_PROMPT_TOKENS = 8, M_GENERATED = 10, M_DECODED = 11, M_COUNT = 25
+};
+
+// ---- Minimal JNIEnv ----------------------------------------------------------------------
+// Every jobject points at a bench_object. Objects made through the env (strings, arrays) are
+// freed by DeleteLocalRef; the driver owns its option objects and class handles never die.
+
+typedef enum { OBJ_CLASS, OBJ_STRING, OBJ_ARRAY, OBJ_FIELDS, OBJ_DIRECT } bench_kind;
+
+typedef struct {
+    bench_kind kind;
+    int env_owned;
+} bench_object;
+
+typedef struct {
+    bench_object base;
+    char *utf8;
+    jchar *utf16;       // ASCII strings only: the driver's prompts and option values
+    jsize n_units;
+} bench_string;
+
+typedef struct {
+    bench_object base;
+    jsize length;
+    void *data;
+    int owns_elements;  // object arrays made by NewObjectArray free what was stored in them
+} bench_array;
+
+// A direct java.nio buffer; capacity is in elements, as for the buffer's own type
+typedef struct {
+    bench_object base;
+    void *address;
+    jlong capacity;
+} bench_direct;
+
+typedef struct {
+    const char *name;
+    char type;          // JNI signature letter: I, F, J, Z or L
+    jvalue value;
+} bench_field;
+
+typedef struct {
+    bench_object base;
+    bench_field fields[BENCH_MAX_FIELDS];
+    int n_fields;
+} bench_fields;
+
+// One per thread, like a real JNIEnv; the function table must stay the first member
+typedef struct {
+    const struct JNINativeInterface_ *functions;
+    char exception[256];
+    int pending;
+} bench_env;
+
+static bench_object g_class = { OBJ_CLASS, 0 };
+
+static bench_string* bench_new_string(const char *utf8, size_t len, int env_owned) {
+    bench_string *s = (bench_string*)calloc(1, sizeof(bench_string));
+    s->base.kind = OBJ_STRING;
+    s->base.env_owned = env_owned;
+    s->utf8 = (char*)malloc(len + 1);
+    memcpy(s->utf8, utf8, len);
+    s->utf8[len] = '\0';
+    s->n_units = (jsize)len;
+    s->utf16 = (jchar*)malloc((len + 1) * sizeof(jchar));
+    for (size_t i = 0; i < len; i++) {
+        s->utf16[i] = (unsigned char)utf8[i];
+    }
+    return s;
+}
+
+static void bench_free(jobject obj) {
+    bench_object *o = (bench_object*)obj;
+    if (o == NULL) {
+        return;
+    }
+    if (o->kind == OBJ_STRING) {
+        free(((bench_string*)o)->utf8);
+        free(((bench_string*)o)->utf16);
+    } else if (o->kind == OBJ_ARRAY) {
+        bench_array *a = (bench_array*)o;
+        if (a->owns_elements) {
+            for (jsize i = 0; i < a->length; i++) {
+                bench_free(((jobject*)a->data)[i]);
+            }
+        }
+        free(a->data);
+    }
+    if (o->kind != OBJ_CLASS) {
+        free(o);
+    }
+}
+
+static jint JNICALL b_ThrowNew(JNIEnv *env, jclass cls, const char *message) {
+    bench_env *e = (bench_env*)env;
+    snprintf(e->exception, sizeof(e->exception), "%s", message);
+    e->pending = 1;
+    return 0;
+}
+
+static jboolean JNICALL b_ExceptionCheck(JNIEnv *env) {
+    return ((bench_env*)env)->pending ? JNI_TRUE : JNI_FALSE;
+}
+
+static void JNICALL b_ExceptionClear(JNIEnv *env) {
+    ((bench_env*)env)->pending = 0;
+}
+
+static void JNICALL b_ExceptionDescribe(JNIEnv *env) {
+    fprintf(stderr, "exception: %s\n", ((bench_env*)env)->exception);
+}
+
+static jclass JNICALL b_FindClass(JNIEnv *env, const char *name) {
+    return (jclass)&g_class;
+}
+
+// Option objects act as their own class, so GetFieldID can look the name up in them
+static jclass JNICALL b_GetObjectClass(JNIEnv *env, jobject obj) {
+    return (jclass)obj;
+}
+
+static jfieldID JNICALL b_GetFieldID(JNIEnv *env, jclass cls, const char *name, const char *sig) {
+    bench_fields *f = (bench_fields*)cls;
+    for (int i = 0; i < f->n_fields; i++) {
+        if (strcmp(f->fields[i].name, name) == 0 && f->fields[i].type == sig[0]) {
+            return (jfieldID)&f->fields[i];
+        }
+    }
+    b_ThrowNew(env, NULL, name); // NoSuchFieldError
+    return NULL;
+}
+
+static jint JNICALL b_GetIntField(JNIEnv *env, jobject obj, jfieldID field) {
+    return ((bench_field*)field)->value.i;
+}
+
+static jfloat JNICALL b_GetFloatField(JNIEnv *env, jobject obj, jfieldID field) {
+    return ((bench_field*)field)->value.f;
+}
+
+static jlong JNICALL b_GetLongField(JNIEnv *env, jobject obj, jfieldID field) {
+    return ((bench_field*)field)->value.j;
+}
+
+static jboolean JNICALL b_GetBooleanField(JNIEnv *env, jobject obj, jfieldID field) {
+    return ((bench_field*)field)->value.z;
+}
+
+static jobject JNICALL b_GetObjectField(JNIEnv *env, jobject obj, jfieldID field) {
+    return ((bench_field*)field)->value.l;
+}
+
+static jmethodID JNICALL b_GetMethodID(JNIEnv *env, jclass cls, const char *name, const char *sig) {
+    return (jmethodID)&g_class;
+}
+
+static void JNICALL b_DeleteLocalRef(JNIEnv *env, jobject obj) {
+    if (obj != NULL && ((bench_object*)obj)->env_owned) {
+        bench_free(obj);
+    }
+}
+
+static jobject JNICALL b_NewGlobalRef(JNIEnv *env, jobject obj) {
+    return obj;
+}
+
+static void JNICALL b_DeleteGlobalRef(JNIEnv *env, jobject obj) {
+}
+
+static jstring JNICALL b_NewStringUTF(JNIEnv *env, const char *utf8) {
+    return (jstring)bench_new_string(utf8, strlen(utf8), 1);
+}
+
+static jsize JNICALL b_GetStringLength(JNIEnv *env, jstring str) {
+    return ((bench_string*)str)->n_units;
+}
+
+static const char* JNICALL b_GetStringUTFChars(JNIEnv *env, jstring str, jboolean *is_copy) {
+    return ((bench_string*)str)->utf8;
+}
+
+static void JNICALL b_ReleaseStringUTFChars(JNIEnv *env, jstring str, const char *chars) {
+}
+
+static const jchar* JNICALL b_GetStringCritical(JNIEnv *env, jstring str, jboolean *is_copy) {
+    return ((bench_string*)str)->utf16;
+}
+
+static void JNICALL b_ReleaseStringCritical(JNIEnv *env, jstring str, const jchar *chars) {
+}
+
+static bench_array* bench_new_array(jsize length, size_t element_size) {
+    bench_array *a = (bench_array*)calloc(1, sizeof(bench_array));
+    a->base.kind = OBJ_ARRAY;
+    a->base.env_owned = 1;
+    a->length = length;
+    a->data = calloc((size_t)length + 1, element_size);
+    return a;
+}
+
+static jbyteArray JNICALL b_NewByteArray(JNIEnv *env, jsize length) {
+    return (jbyteArray)bench_new_array(length, 1);
+}
+
+static void JNICALL b_SetByteArrayRegion(JNIEnv *env, jbyteArray array, jsize start, jsize len, const jbyte *buf) {
+    memcpy((jbyte*)((bench_array*)array)->data + start, buf, (size_t)len);
+}
+
+static jlongArray JNICALL b_NewLongArray(JNIEnv *env, jsize length) {
+    return (jlongArray)bench_new_array(length, sizeof(jlong));
+}
+
+static void JNICALL b_SetLongArrayRegion(JNIEnv *env, jlongArray array, jsize start, jsize len, const jlong *buf) {
+    memcpy((jlong*)((bench_array*)array)->data + start, buf, (size_t)len * sizeof(jlong));
+}
+
+static jintArray JNICALL b_NewIntArray(JNIEnv *env, jsize length) {
+    return (jintArray)bench_new_array(length, sizeof(jint));
+}
+
+static void JNICALL b_SetIntArrayRegion(JNIEnv *env, jintArray array, jsize start, jsize len, const jint *buf) {
+    memcpy((jint*)((bench_array*)array)->data + start, buf, (size_t)len * sizeof(jint));
+}
+
+static jsize JNICALL b_GetArrayLength(JNIEnv *env, jarray array) {
+    return ((bench_array*)array)->length;
+}
+
+static jobjectArray JNICALL b_NewObjectArray(JNIEnv *env, jsize length, jclass cls, jobject init) {
+    bench_array *a = bench_new_array(length, sizeof(jobject));
+    a->owns_elements = 1;
+    return (jobjectArray)a;
+}
+
+static jobject JNICALL b_GetObjectArrayElement(JNIEnv *env, jobjectArray array, jsize index) {
+    return ((jobject*)((bench_array*)array)->data)[index];
+}
+
+static void* JNICALL b_GetDirectBufferAddress(JNIEnv *env, jobject buf) {
+    return ((bench_direct*)buf)->address;
+}
+
+static jlong JNICALL b_GetDirectBufferCapacity(JNIEnv *env, jobject buf) {
+    return ((bench_direct*)buf)->capacity;
+}
+
+// The array keeps the element, so a DeleteLocalRef that follows must not free it
+static void JNICALL b_SetObjectArrayElement(JNIEnv *env, jobjectArray array, jsize index, jobject value) {
+    if (value != NULL) {
+        ((bench_object*)value)->env_owned = 0;
+    }
+    ((jobject*)((bench_array*)array)->data)[index] = value;
+}
+
+// Only used as new String(byte[], "UTF-8") for generated text
+static jobject JNICALL b_NewObject(JNIEnv *env, jclass cls, jmethodID ctor, ...) {
+    va_list args;
+    va_start(args, ctor);
+    bench_array *bytes = va_arg(args, bench_array*);
+    va_end(args);
+    bench_string *s = (bench_string*)calloc(1, sizeof(bench_string));
+    s->base.kind = OBJ_STRING;
+    s->base.env_owned = 1;
+    s->utf8 = (char*)malloc((size_t)bytes->length + 1);
+    memcpy(s->utf8, bytes->data, (size_t)bytes->length);
+    s->utf8[bytes->length] = '\0';
+    s->n_units = bytes->length;
+    return (jobject)s;
+}
+
+static struct JNINativeInterface_ g_functions;
+
+static void init_functions(void) {
+    g_functions.ThrowNew = b_ThrowNew;
+    g_functions.ExceptionCheck = b_ExceptionCheck;
+    g_functions.ExceptionClear = b_ExceptionClear;
+    g_functions.ExceptionDescribe = b_ExceptionDescribe;
+    g_functions.FindClass = b_FindClass;
+    g_functions.GetObjectClass = b_GetObjectClass;
+    g_functions.GetFieldID = b_GetFieldID;
+    g_functions.GetIntField = b_GetIntField;
+    g_functions.GetFloatField = b_GetFloatField;
+    g_functions.GetLongField = b_GetLongField;
+    g_functions.GetBooleanField = b_GetBooleanField;
+    g_functions.GetObjectField = b_GetObjectField;
+    g_functions.GetMethodID = b_GetMethodID;
+    g_functions.DeleteLocalRef = b_DeleteLocalRef;
+    g_functions.NewGlobalRef = b_NewGlobalRef;
+    g_functions.DeleteGlobalRef = b_DeleteGlobalRef;
+    g_functions.NewStringUTF = b_NewStringUTF;
+    g_functions.GetStringLength = b_GetStringLength;
+    g_functions.GetStringUTFChars = b_GetStringUTFChars;
+    g_functions.ReleaseStringUTFChars = b_ReleaseStringUTFChars;
+    g_functions.GetStringCritical = b_GetStringCritical;
+    g_functions.ReleaseStringCritical = b_ReleaseStringCritical;
+    g_functions.NewByteArray = b_NewByteArray;
+    g_functions.SetByteArrayRegion = b_SetByteArrayRegion;
+    g_functions.NewLongArray = b_NewLongArray;
+    g_functions.SetLongArrayRegion = b_SetLongArrayRegion;
+    g_functions.NewIntArray = b_NewIntArray;
+    g_functions.SetIntArrayRegion = b_SetIntArrayRegion;
+    g_functions.GetArrayLength = b_GetArrayLength;
+    g_functions.NewObjectArray = b_NewObjectArray;
+    g_functions.GetDirectBufferAddress = b_GetDirectBufferAddress;
+    g_functions.GetDirectBufferCapacity = b_GetDirectBufferCapacity;
+    g_functions.GetObjectArrayElement = b_GetObjectArrayElement;
+    g_functions.SetObjectArrayElement = b_SetObjectArrayElement;
+    g_functions.NewObject = b_NewObject;
+}
+
+static JNIEnv* new_env(void) {
+    bench_env *e = (bench_env*)calloc(1, sizeof(bench_env));
+    e->functions = &g_functions;
+    return (JNIEnv*)e;
+}
+
+// The completion thread attaches once per model; its env lives until the process exits
+static jint JNICALL b_AttachCurrentThread(JavaVM *vm, void **env, void *args) {
+    *env = new_env();
+    return JNI_OK;
+}
+
+static jint JNICALL b_DetachCurrentThread(JavaVM *vm) {
+    return JNI_OK;
+}
+
+static struct JNIInvokeInterface_ g_invoke;
+static const struct JNIInvokeInterface_ *g_vm = &g_invoke;
+
+// ---- Option objects ----------------------------------------------------------------------
+
+static void set_field(bench_fields *f, const char *name, char type, jvalue value) {
+    f->fields[f->n_fields].name = name;
+    f->fields[f->n_fields].type = type;
+    f->fields[f->n_fields].value = value;
+    f->n_fields++;
+}
+
+static void set_int(bench_fields *f, const char *name, jint v) {
+    jvalue value;
+    value.i = v;
+    set_field(f, name, 'I', value);
+}
+
+static void set_float(bench_fields *f, const char *name, jfloat v) {
+    jvalue value;
+    value.f = v;
+    set_field(f, name, 'F', value);
+}
+
+static void set_long(bench_fields *f, const char *name, jlong v) {
+    jvalue value;
+    value.j = v;
+    set_field(f, name, 'J', value);
+}
+
+static void set_bool(bench_fields *f, const char *name, int v) {
+    jvalue value;
+    value.z = v ? JNI_TRUE : JNI_FALSE;
+    set_field(f, name, 'Z', value);
+}
+
+static void set_object(bench_fields *f, const char *name, jobject v) {
+    jvalue value;
+    value.l = v;
+    set_field(f, name, 'L', value);
+}
+
+static bench_fields* new_fields(void) {
+    bench_fields *f = (bench_fields*)calloc(1, sizeof(bench_fields));
+    f->base.kind = OBJ_FIELDS;
+    return f;
+}
+
+// Fields of com.livecoding.demo.LoadOptions
+typedef struct {
+    int contexts, seqs, threads, batch, ubatch, ctx, prefill_chunk, gpu_layers;
+    const char *cpu_sets;   // NULL: unpinned
+    const char *numa;
+} bench_load;
+
+static bench_fields* new_load_options(const bench_load *load) {
+    bench_fields *f = new_fields();
+    set_int(f, "gpuLayers", load->gpu_layers);
+    set_bool(f, "useMmap", 1);
+    set_bool(f, "useMlock", 0);
+    set_object(f, "flashAttention", NULL);
+    set_bool(f, "warmup", 1);
+    set_int(f, "contextLength", load->ctx);
+    set_int(f, "contexts", load->contexts);
+    set_int(f, "sequencesPerContext", load->seqs);
+    set_int(f, "threads", load->threads);
+    set_int(f, "threadsBatch", 0);
+    set_object(f, "cpuSets", load->cpu_sets != NULL
+            ? (jobject)bench_new_string(load->cpu_sets, strlen(load->cpu_sets), 0) : NULL);
+    set_object(f, "numa", load->numa != NULL ? (jobject)bench_new_string(load->numa, strlen(load->numa), 0) : NULL);
+    set_int(f, "batchSize", load->batch);
+    set_int(f, "ubatchSize", load->ubatch);
+    set_int(f, "prefillChunk", load->prefill_chunk);
+    set_int(f, "deadlineMillis", 0);
+    set_int(f, "draftTokens", 0);
+    set_object(f, "draftModelPath", NULL);
+    set_int(f, "sessionMemoryMb", 0);
+    set_int(f, "sessionDiskMb", 0);
+    set_object(f, "sessionDir", NULL);
+    set_bool(f, "contextShift", 0);
+    set_int(f, "keepTokens", 0);
+    return f;
+}
+
+// Fields of com.livecoding.demo.SamplingParams; greedy so runs are repeatable
+static bench_fields* new_sampling(int max_tokens) {
+    bench_fields *f = new_fields();
+    set_int(f, "maxTokens", max_tokens);
+    set_float(f, "temperature", 0.0f);
+    set_int(f, "topK", 40);
+    set_float(f, "topP", 0.9f);
+    set_long(f, "seed", 42);
+    set_object(f, "sessionId", NULL);
+    set_object(f, "grammar", NULL);
+    return f;
+}
+
+// ---- Benchmarks --------------------------------------------------------------------------
+
+typedef struct {
+    const char *model_path;
+    bench_load load;
+    int lengths[BENCH_MAX_LIST];
+    int n_lengths;
+    int concurrency[BENCH_MAX_LIST];
+    int n_concurrency;
+    int tokens;
+    int iterations;
+} bench_config;
+
+static jlong g_handle;
+static jstring g_model_id;
+
+static void report(const char *name, double value, const char *unit) {
+    printf("%-36s %14.3f %s\n", name, value, unit);
+    fflush(stdout);
+}
+
+static int check(JNIEnv *env, const char *what) {
+    if ((*env)->ExceptionCheck(env)) {
+        fprintf(stderr, "%s failed: %s\n", what, ((bench_env*)env)->exception);
+        (*env)->ExceptionClear(env);
+        return -1;
+    }
+    return 0;
+}
+
+static int read_metrics(JNIEnv *env, jlong *values) {
+    jlongArray array = Java_com_livecoding_demo_LlamaJNI_getMetrics(env, NULL, g_model_id);
+    if (array == NULL || (*env)->GetArrayLength(env, array) < M_COUNT) {
+        fprintf(stderr, "getMetrics returned no snapshot\n");
+        return -1;
+    }
+    memcpy(values, ((bench_array*)array)->data, M_COUNT * sizeof(jlong));
+    (*env)->DeleteLocalRef(env, array);
+    return 0;
+}
+
+// A prompt of about n_tokens tokens. The leading tag differs per call, so the prefix cache
+// cannot serve it and the whole prompt is prefilled.
+static jstring make_prompt(const struct llama_vocab *vocab, int n_tokens, int tag) {
+    static const char filler[] = " The quick brown fox jumps over the lazy dog near the river bank.";
+    char text[BENCH_PROMPT_MAX + 1];
+    llama_token *tokens = (llama_token*)malloc(sizeof(llama_token) * (BENCH_PROMPT_MAX + 16));
+    int len = snprintf(text, sizeof(text), "Request %d:", tag);
+    while (len + (int)sizeof(filler) <= BENCH_PROMPT_MAX) {
+        int n = llama_tokenize(vocab, text, len, tokens, BENCH_PROMPT_MAX + 16, true, true);
+        if (n >= n_tokens) {
+            break;
+        }
+        memcpy(text + len, filler, sizeof(filler));
+        len += (int)sizeof(filler) - 1;
+    }
+    free(tokens);
+    return (jstring)bench_new_string(text, (size_t)len, 0);
+}
+
+static jstring generate(JNIEnv *env, jstring prompt, bench_fields *sampling) {
+    return Java_com_livecoding_demo_LlamaJNI_generateText__JLjava_lang_String_2Lcom_livecoding_demo_SamplingParams_2(
+        env, NULL, g_handle, prompt, (jobject)sampling);
+}
+
+static void bench_jni_calls(JNIEnv *env, int iterations) {
+    int n = iterations * 10000;
+    int64_t start = llama_time_us();
+    for (int i = 0; i < n; i++) {
+        Java_com_livecoding_demo_LlamaJNI_isModelLoaded(env, NULL, g_handle);
+    }
+    report("jni.isModelLoaded", (double)(llama_time_us() - start) * 1000.0 / n, "ns/call");
+
+    n = iterations * 1000;
+    start = llama_time_us();
+    for (int i = 0; i < n; i++) {
+        (*env)->DeleteLocalRef(env, Java_com_livecoding_demo_LlamaJNI_getModelInfo(env, NULL, g_handle));
+    }
+    report("jni.getModelInfo", (double)(llama_time_us() - start) * 1000.0 / n, "ns/call");
+}
+
+static void bench_tokenize(const struct llama_vocab *vocab, const bench_config *config) {
+    llama_token *tokens = (llama_token*)malloc(sizeof(llama_token) * (BENCH_PROMPT_MAX + 16));
+    for (int l = 0; l < config->n_lengths; l++) {
+        bench_string *prompt = (bench_string*)make_prompt(vocab, config->lengths[l], 0);
+        int n = config->iterations * 100;
+        int n_tokens = 0;
+        int64_t start = llama_time_us();
+        for (int i = 0; i < n; i++) {
+            n_tokens = llama_tokenize(vocab, prompt->utf8, (int32_t)prompt->n_units, tokens,
+                                      BENCH_PROMPT_MAX + 16, true, true);
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "tokenize.%d", config->lengths[l]);
+        report(name, (double)(llama_time_us() - start) / n, "us/prompt");
+        snprintf(name, sizeof(name), "tokenize.%d.tokens", config->lengths[l]);
+        report(name, n_tokens, "tokens");
+        bench_free((jobject)prompt);
+    }
+    free(tokens);
+}
+
+static void bench_prefill(JNIEnv *env, const struct llama_vocab *vocab, const bench_config *config) {
+    bench_fields *sampling = new_sampling(1);
+    for (int l = 0; l < config->n_lengths; l++) {
+        jlong before[M_COUNT], after[M_COUNT];
+        if (read_metrics(env, before) != 0) {
+            break;
+        }
+        for (int i = 0; i < config->iterations; i++) {
+            jstring prompt = make_prompt(vocab, config->lengths[l], l * config->iterations + i + 1);
+            (*env)->DeleteLocalRef(env, generate(env, prompt, sampling));
+            bench_free(prompt);
+            if (check(env, "prefill") != 0) {
+                break;
+            }
+        }
+        if (read_metrics(env, after) != 0) {
+            break;
+        }
+
+        double jobs = (double)(after[M_PREFILLED] - before[M_PREFILLED]);
+        double tokens = (double)(after[M_PROMPT_TOKENS] - before[M_PROMPT_TOKENS]);
+        double time_us = (double)(after[M_PREFILL_TIME] - before[M_PREFILL_TIME]);
+        char name[64];
+        snprintf(name, sizeof(name), "prefill.%d", config->lengths[l]);
+        report(name, jobs > 0 ? time_us / jobs / 1000.0 : 0.0, "ms/prompt");
+        snprintf(name, sizeof(name), "prefill.%d.throughput", config->lengths[l]);
+        report(name, time_us > 0 ? tokens * 1e6 / time_us : 0.0, "tokens/s");
+    }
+    bench_free((jobject)sampling);
+}
+
+static void bench_decode(JNIEnv *env, const struct llama_vocab *vocab, const bench_config *config) {
+    bench_fields *sampling = new_sampling(config->tokens);
+    jlong before[M_COUNT], after[M_COUNT];
+    if (read_metrics(env, before) == 0) {
+        for (int i = 0; i < config->iterations; i++) {
+            jstring prompt = make_prompt(vocab, 16, 100000 + i);
+            (*env)->DeleteLocalRef(env, generate(env, prompt, sampling));
+            bench_free(prompt);
+            if (check(env, "decode") != 0) {
+                break;
+            }
+        }
+    }
+    if (read_metrics(env, after) == 0) {
+        double tokens = (double)(after[M_DECODED] - before[M_DECODED]);
+        double time_us = (double)(after[M_DECODE_TIME] - before[M_DECODE_TIME]);
+        double jobs = (double)(after[M_PREFILLED] - before[M_PREFILLED]);
+        report("decode.per_token", tokens > 0 ? time_us / tokens / 1000.0 : 0.0, "ms/token");
+        report("decode.throughput", time_us > 0 ? tokens * 1e6 / time_us : 0.0, "tokens/s");
+        report("decode.time_to_first_token",
+               jobs > 0 ? (double)(after[M_FIRST_TOKEN_TIME] - before[M_FIRST_TOKEN_TIME]) / jobs / 1000.0 : 0.0,
+               "ms");
+    }
+    bench_free((jobject)sampling);
+}
+
+typedef struct {
+    const struct llama_vocab *vocab;
+    const bench_config *config;
+    int index;
+    int64_t latency_us;     // summed over the caller's requests
+    int failures;
+} bench_caller;
+
+static JNI_THREAD_PROC(caller_main, arg) {
+    bench_caller *caller = (bench_caller*)arg;
+    JNIEnv *env = new_env();
+    bench_fields *sampling = new_sampling(caller->config->tokens);
+    for (int i = 0; i < caller->config->iterations; i++) {
+        jstring prompt = make_prompt(caller->vocab, 32, 200000 + caller->index * 1000 + i);
+        int64_t start = llama_time_us();
+        (*env)->DeleteLocalRef(env, generate(env, prompt, sampling));
+        caller->latency_us += llama_time_us() - start;
+        bench_free(prompt);
+        if ((*env)->ExceptionCheck(env)) {
+            (*env)->ExceptionClear(env);
+            caller->failures++;
+        }
+    }
+    bench_free((jobject)sampling);
+    free(env);
+    JNI_THREAD_RETURN;
+}
+
+static void bench_concurrency(JNIEnv *env, const struct llama_vocab *vocab, const bench_config *config) {
+    for (int c = 0; c < config->n_concurrency; c++) {
+        int n = config->concurrency[c];
+        bench_caller *callers = (bench_caller*)calloc((size_t)n, sizeof(bench_caller));
+        jni_thread_t *threads = (jni_thread_t*)calloc((size_t)n, sizeof(jni_thread_t));
+        jlong before[M_COUNT], after[M_COUNT];
+        if (callers == NULL || threads == NULL || read_metrics(env, before) != 0) {
+            free(callers);
+            free(threads);
+            break;
+        }
+
+        int64_t start = llama_time_us();
+        int n_started = 0;
+        for (int i = 0; i < n; i++) {
+            callers[i].vocab = vocab;
+            callers[i].config = config;
+            callers[i].index = c * 100 + i;
+            if (jni_thread_create(&threads[i], caller_main, &callers[i]) != 0) {
+                break;
+            }
+            n_started++;
+        }
+        int64_t latency_us = 0;
+        int failures = 0;
+        for (int i = 0; i < n_started; i++) {
+            jni_thread_join(threads[i]);
+            latency_us += callers[i].latency_us;
+            failures += callers[i].failures;
+        }
+        double wall_s = (double)(llama_time_us() - start) / 1e6;
+
+        if (read_metrics(env, after) == 0) {
+            double requests = (double)n_started * config->iterations;
+            double generated = (double)(after[M_GENERATED] - before[M_GENERATED]);
+            char name[64];
+            snprintf(name, sizeof(name), "generate.c%d.latency", n);
+            report(name, requests > 0 ? (double)latency_us / requests / 1000.0 : 0.0, "ms/request");
+            snprintf(name, sizeof(name), "generate.c%d.requests", n);
+            report(name, requests / wall_s, "requests/s");
+            snprintf(name, sizeof(name), "generate.c%d.throughput", n);
+            report(name, generated / wall_s, "tokens/s");
+            snprintf(name, sizeof(name), "generate.c%d.failures", n);
+            report(name, failures, "requests");
+        }
+        free(callers);
+        free(threads);
+    }
+}
+
+// One generateBatch call of n prompts per iteration, against the c<n> runs above
+static void bench_batch(JNIEnv *env, const struct llama_vocab *vocab, const bench_config *config) {
+    bench_fields *sampling = new_sampling(config->tokens);
+    for (int c = 0; c < config->n_concurrency; c++) {
+        int n = config->concurrency[c];
+        bench_array *prompts = bench_new_array(n, sizeof(jobject));
+        prompts->base.env_owned = 0;
+        jlong before[M_COUNT], after[M_COUNT];
+        if (read_metrics(env, before) != 0) {
+            bench_free((jobject)prompts);
+            break;
+        }
+
+        int failures = 0;
+        int64_t latency_us = 0;
+        int64_t start = llama_time_us();
+        for (int i = 0; i < config->iterations; i++) {
+            for (int p = 0; p < n; p++) {
+                ((jobject*)prompts->data)[p] = make_prompt(vocab, 32, 300000 + (c * 100 + i) * 1000 + p);
+            }
+            int64_t call_start = llama_time_us();
+            jobjectArray results = Java_com_livecoding_demo_LlamaJNI_generateBatch(env, NULL, g_handle,
+                                                                                   (jobjectArray)prompts, (jobject)sampling);
+            latency_us += llama_time_us() - call_start;
+            if (check(env, "batch") != 0) {
+                failures += n;
+            } else {
+                for (int p = 0; p < n; p++) {
+                    failures += ((jobject*)((bench_array*)results)->data)[p] == NULL;
+                }
+            }
+            bench_free(results);
+            for (int p = 0; p < n; p++) {
+                bench_free(((jobject*)prompts->data)[p]);
+            }
+        }
+        double wall_s = (double)(llama_time_us() - start) / 1e6;
+
+        if (read_metrics(env, after) == 0) {
+            double requests = (double)n * config->iterations;
+            double generated = (double)(after[M_GENERATED] - before[M_GENERATED]);
+            char name[64];
+            snprintf(name, sizeof(name), "batch.%d.latency", n);
+            report(name, (double)latency_us / config->iterations / 1000.0, "ms/batch");
+            snprintf(name, sizeof(name), "batch.%d.requests", n);
+            report(name, requests / wall_s, "requests/s");
+            snprintf(name, sizeof(name), "batch.%d.throughput", n);
+            report(name, generated / wall_s, "tokens/s");
+            snprintf(name, sizeof(name), "batch.%d.failures", n);
+            report(name, failures, "requests");
+        }
+        bench_free((jobject)prompts);
+    }
+    bench_free((jobject)sampling);
+}
+
+// embed() of n inputs per call into one FloatBuffer
+static void bench_embed(JNIEnv *env, const struct llama_vocab *vocab, const bench_config *config) {
+    jint n_embd = Java_com_livecoding_demo_LlamaJNI_getEmbeddingSize(env, NULL, g_handle);
+    for (int c = 0; c < config->n_concurrency && n_embd > 0; c++) {
+        int n = config->concurrency[c];
+        bench_array *inputs = bench_new_array(n, sizeof(jobject));
+        inputs->base.env_owned = 0;
+        bench_direct output = { { OBJ_DIRECT, 0 }, malloc(sizeof(float) * (size_t)n * (size_t)n_embd),
+                                (jlong)n * n_embd };
+        for (int p = 0; p < n; p++) {
+            ((jobject*)inputs->data)[p] = make_prompt(vocab, 32, 400000 + c * 1000 + p);
+        }
+
+        int failures = 0;
+        int64_t start = llama_time_us();
+        for (int i = 0; i < config->iterations; i++) {
+            Java_com_livecoding_demo_LlamaJNI_embed(env, NULL, g_handle, (jobjectArray)inputs,
+                                                    (jobject)&output, JNI_TRUE);
+            if (check(env, "embed") != 0) {
+                failures++;
+            }
+        }
+        double elapsed_us = (double)(llama_time_us() - start);
+
+        char name[64];
+        snprintf(name, sizeof(name), "embed.%d.latency", n);
+        report(name, elapsed_us / config->iterations / 1000.0, "ms/call");
+        snprintf(name, sizeof(name), "embed.%d.throughput", n);
+        report(name, elapsed_us > 0 ? (double)n * config->iterations * 1e6 / elapsed_us : 0.0, "inputs/s");
+        snprintf(name, sizeof(name), "embed.%d.failures", n);
+        report(name, failures, "calls");
+
+        for (int p = 0; p < n; p++) {
+            bench_free(((jobject*)inputs->data)[p]);
+        }
+        bench_free((jobject)inputs);
+        free(output.address);
+    }
+}
+
+// countTokens and tokenize through JNI per prompt length, the checks run before generation
+static void bench_count_tokens(JNIEnv *env, const struct llama_vocab *vocab, const bench_config *config) {
+    for (int l = 0; l < config->n_lengths; l++) {
+        int length = config->lengths[l];
+        jstring prompt = make_prompt(vocab, length, 500000 + l);
+
+        int64_t count_us = 0, tokenize_us = 0;
+        int failures = 0;
+        for (int i = 0; i < config->iterations; i++) {
+            int64_t start = llama_time_us();
+            Java_com_livecoding_demo_LlamaJNI_countTokens(env, NULL, g_handle, prompt);
+            count_us += llama_time_us() - start;
+            failures += check(env, "countTokens") != 0;
+
+            start = llama_time_us();
+            (*env)->DeleteLocalRef(env, Java_com_livecoding_demo_LlamaJNI_tokenize(env, NULL, g_handle, prompt));
+            tokenize_us += llama_time_us() - start;
+            failures += check(env, "tokenize") != 0;
+        }
+        bench_free(prompt);
+
+        char name[64];
+        snprintf(name, sizeof(name), "jni.countTokens.%d", length);
+        report(name, (double)count_us / config->iterations, "us/call");
+        snprintf(name, sizeof(name), "jni.tokenize.%d", length);
+        report(name, (double)tokenize_us / config->iterations, "us/call");
+        snprintf(name, sizeof(name), "jni.tokenize.%d.failures", length);
+        report(name, failures, "calls");
+    }
+}
+
+// ---- Command line ------------------------------------------------------------------------
+
+static int parse_list(const char *arg, int *values, int max) {
+    int n = 0;
+    while (*arg != '\0' && n < max) {
+        char *end;
+        long v = strtol(arg, &end, 10);
+        if (end == arg || v <= 0) {
+            return -1;
+        }
+        values[n++] = (int)v;
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return n;
+}
+
+static int parse_args(int argc, char **argv, bench_config *config) {
+    memset(config, 0, sizeof(*config));
+    config->lengths[0] = 32;
+    config->lengths[1] = 256;
+    config->lengths[2] = 1024;
+    config->n_lengths = 3;
+    config->concurrency[0] = 1;
+    config->concurrency[1] = 4;
+    config->concurrency[2] = 16;
+    config->n_concurrency = 3;
+    config->tokens = 64;
+    config->iterations = 8;
+    config->load.ctx = 2048;
+
+    if (argc < 2 || argv[1][0] == '-') {
+        return -1;
+    }
+    config->model_path = argv[1];
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const char *key = argv[i];
+        const char *value = argv[i + 1];
+        int *target = NULL;
+        if (strcmp(key, "--lengths") == 0) {
+            config->n_lengths = parse_list(value, config->lengths, BENCH_MAX_LIST);
+            if (config->n_lengths <= 0) {
+                return -1;
+            }
+            continue;
+        }
+        if (strcmp(key, "--concurrency") == 0) {
+            config->n_concurrency = parse_list(value, config->concurrency, BENCH_MAX_LIST);
+            if (config->n_concurrency <= 0) {
+                return -1;
+            }
+            continue;
+        }
+        if (strcmp(key, "--cpu-sets") == 0) {
+            config->load.cpu_sets = value;
+            continue;
+        }
+        if (strcmp(key, "--numa") == 0) {
+            config->load.numa = value;
+            continue;
+        }
+        if (strcmp(key, "--contexts") == 0) target = &config->load.contexts;
+        else if (strcmp(key, "--seqs") == 0) target = &config->load.seqs;
+        else if (strcmp(key, "--threads") == 0) target = &config->load.threads;
+        else if (strcmp(key, "--batch") == 0) target = &config->load.batch;
+        else if (strcmp(key, "--ubatch") == 0) target = &config->load.ubatch;
+        else if (strcmp(key, "--ctx") == 0) target = &config->load.ctx;
+        else if (strcmp(key, "--prefill-chunk") == 0) target = &config->load.prefill_chunk;
+        else if (strcmp(key, "--gpu-layers") == 0) target = &config->load.gpu_layers;
+        else if (strcmp(key, "--tokens") == 0) target = &config->tokens;
+        else if (strcmp(key, "--iterations") == 0) target = &config->iterations;
+        if (target == NULL) {
+            return -1;
+        }
+        *target = atoi(value);
+    }
+    return config->tokens > 0 && config->iterations > 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    bench_config config;
+    if (parse_args(argc, argv, &config) != 0) {
+        fprintf(stderr, "usage: %s <model.gguf> [--contexts N] [--seqs N] [--threads N] [--batch N]"
+                        " [--ubatch N] [--ctx N] [--prefill-chunk N] [--gpu-layers N] [--lengths 32,256,1024]"
+                        " [--tokens 64] [--concurrency 1,4,16] [--iterations 8] [--cpu-sets auto|0-7;8-15]"
+                        " [--numa distribute|isolate|numactl|interleave]\n", argv[0]);
+        return 2;
+    }
+
+    init_functions();
+    g_invoke.AttachCurrentThread = b_AttachCurrentThread;
+    g_invoke.AttachCurrentThreadAsDaemon = b_AttachCurrentThread;
+    g_invoke.DetachCurrentThread = b_DetachCurrentThread;
+    JNIEnv *env = new_env();
+    JNI_OnLoad((JavaVM*)&g_vm, NULL);
+
+    // Prompts are sized with a vocabulary-only copy of the model
+    struct llama_model_params vocab_params = llama_model_default_params();
+    vocab_params.vocab_only = true;
+    struct llama_model *vocab_model = llama_model_load_from_file(config.model_path, vocab_params);
+    if (vocab_model == NULL) {
+        fprintf(stderr, "failed to read the vocabulary of %s\n", config.model_path);
+        return 1;
+    }
+    const struct llama_vocab *vocab = llama_model_get_vocab(vocab_model);
+
+    jstring path = (jstring)bench_new_string(config.model_path, strlen(config.model_path), 0);
+    g_model_id = (jstring)bench_new_string(BENCH_MODEL_ID, strlen(BENCH_MODEL_ID), 0);
+    bench_fields *options = new_load_options(&config.load);
+    int64_t start = llama_time_us();
+    g_handle = Java_com_livecoding_demo_LlamaJNI_acquireModel(env, NULL, g_model_id, path, (jobject)options);
+    if (check(env, "acquireModel") != 0 || g_handle == 0) {
+        return 1;
+    }
+    report("load", (double)(llama_time_us() - start) / 1000.0, "ms");
+
+    bench_jni_calls(env, config.iterations);
+    bench_tokenize(vocab, &config);
+    bench_prefill(env, vocab, &config);
+    bench_decode(env, vocab, &config);
+    bench_concurrency(env, vocab, &config);
+    bench_batch(env, vocab, &config);
+    bench_embed(env, vocab, &config);
+    bench_count_tokens(env, vocab, &config);
+
+    Java_com_livecoding_demo_LlamaJNI_releaseModel(env, NULL, g_handle);
+    Java_com_livecoding_demo_LlamaJNI_evictModel(env, NULL, g_model_id);
+    bench_free((jobject)options);
+    bench_free(g_model_id);
+    bench_free(path);
+    llama_model_free(vocab_model);
+    free(env);
+    return 0;
+}
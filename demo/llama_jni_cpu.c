@@ -0,0 +1,9 @@
+// CPU probe loaded by NativeLibraryLoader before the engine: reports which llama_jni variant
+// the host can run. Built without any ISA flags and without llama.cpp, so it loads anywhere.
+#include <jni.h>
+#include "llama_jni_platform.h"
+#include "com_livecoding_demo_NativeLibraryLoader.h"
+
+JNIEXPORT jint JNICALL Java_com_livecoding_demo_NativeLibraryLoader_isaLevel(JNIEnv *env, jclass cls) {
+    return jni_cpu_isa_level();
+}
@@ -0,0 +1,321 @@
+// Minimal threading, file-mapping, CPU topology and ISA primitives for the JNI wrapper (Win32 and POSIX)
+#ifndef LLAMA_JNI_PLATFORM_H
+#define LLAMA_JNI_PLATFORM_H
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef CRITICAL_SECTION jni_mutex_t;
+typedef CONDITION_VARIABLE jni_cond_t;
+
+#define jni_mutex_init(m)      InitializeCriticalSection(m)
+#define jni_mutex_destroy(m)   DeleteCriticalSection(m)
+#define jni_mutex_lock(m)      EnterCriticalSection(m)
+#define jni_mutex_unlock(m)    LeaveCriticalSection(m)
+
+#define jni_cond_init(c)       InitializeConditionVariable(c)
+#define jni_cond_destroy(c)    ((void)(c))
+#define jni_cond_wait(c, m)    SleepConditionVariableCS((c), (m), INFINITE)
+#define jni_cond_signal(c)     WakeConditionVariable(c)
+#define jni_cond_broadcast(c)  WakeAllConditionVariable(c)
+
+typedef HANDLE jni_thread_t;
+typedef LPTHREAD_START_ROUTINE jni_thread_fn;
+#define JNI_THREAD_PROC(name, arg) DWORD WINAPI name(LPVOID arg)
+#define JNI_THREAD_RETURN          return 0
+
+static inline int jni_thread_create(jni_thread_t *thread, jni_thread_fn fn, void *arg) {
+    *thread = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    return *thread != NULL ? 0 : -1;
+}
+
+static inline void jni_thread_join(jni_thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+// Read-only view of a whole file; NULL on failure
+static inline void* jni_map_file(const char *path, size_t *size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    LARGE_INTEGER file_size;
+    HANDLE mapping = NULL;
+    void *addr = NULL;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping != NULL) {
+        addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    *size = addr != NULL ? (size_t)file_size.QuadPart : 0;
+    return addr;
+}
+
+static inline void jni_unmap_file(void *addr, size_t size) {
+    (void)size;
+    UnmapViewOfFile(addr);
+}
+
+// Size of a file in bytes, -1 if it can't be read
+static inline long long jni_file_size(const char *path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+        return -1;
+    }
+    return ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+}
+
+static inline int jni_cpu_count(void) {
+    return (int)GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+}
+
+// sysfs topology and memory policies are Linux-only; callers fall back to plain CPU numbers
+static inline int jni_read_sysfs(const char *path, char *buf, size_t size) {
+    (void)path;
+    (void)buf;
+    (void)size;
+    return -1;
+}
+
+static inline int jni_interleave_memory(int enable) {
+    (void)enable;
+    return -1;
+}
+
+#else
+#include <pthread.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+long syscall(long number, ...); // unistd.h hides it in strict ISO C modes
+#endif
+
+typedef pthread_mutex_t jni_mutex_t;
+typedef pthread_cond_t jni_cond_t;
+
+#define jni_mutex_init(m)      pthread_mutex_init((m), NULL)
+#define jni_mutex_destroy(m)   pthread_mutex_destroy(m)
+#define jni_mutex_lock(m)      pthread_mutex_lock(m)
+#define jni_mutex_unlock(m)    pthread_mutex_unlock(m)
+
+#define jni_cond_init(c)       pthread_cond_init((c), NULL)
+#define jni_cond_destroy(c)    pthread_cond_destroy(c)
+#define jni_cond_wait(c, m)    pthread_cond_wait((c), (m))
+#define jni_cond_signal(c)     pthread_cond_signal(c)
+#define jni_cond_broadcast(c)  pthread_cond_broadcast(c)
+
+typedef pthread_t jni_thread_t;
+typedef void *(*jni_thread_fn)(void *);
+#define JNI_THREAD_PROC(name, arg) void *name(void *arg)
+#define JNI_THREAD_RETURN          return NULL
+
+static inline int jni_thread_create(jni_thread_t *thread, jni_thread_fn fn, void *arg) {
+    return pthread_create(thread, NULL, fn, arg);
+}
+
+static inline void jni_thread_join(jni_thread_t thread) {
+    pthread_join(thread, NULL);
+}
+
+static inline void* jni_map_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    void *addr = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            addr = NULL;
+        }
+    }
+    close(fd);
+    *size = addr != NULL ? (size_t)st.st_size : 0;
+    return addr;
+}
+
+static inline void jni_unmap_file(void *addr, size_t size) {
+    munmap(addr, size);
+}
+
+static inline long long jni_file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_size : -1;
+}
+
+static inline int jni_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+// First line of a small sysfs file, e.g. a NUMA node's cpulist; -1 if it can't be read
+static inline int jni_read_sysfs(const char *path, char *buf, size_t size) {
+#ifdef __linux__
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    for (ssize_t i = 0; i < n; i++) {
+        if (buf[i] == '\n') {
+            buf[i] = '\0';
+            break;
+        }
+    }
+    return 0;
+#else
+    (void)path;
+    (void)buf;
+    (void)size;
+    return -1;
+#endif
+}
+
+// Spread the calling thread's new pages (anonymous memory and page cache alike) round-robin
+// over every NUMA node, or go back to the default node-local policy. -1 where unsupported or
+// with fewer than two nodes.
+static inline int jni_interleave_memory(int enable) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    if (!enable) {
+        return syscall(SYS_set_mempolicy, 0 /* MPOL_DEFAULT */, NULL, 0UL) == 0 ? 0 : -1;
+    }
+    unsigned long nodes = 0;
+    for (int node = 0; node < (int)(8 * sizeof(nodes)); node++) {
+        char path[64];
+        struct stat st;
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+        if (stat(path, &st) == 0) {
+            nodes |= 1UL << node;
+        }
+    }
+    if ((nodes & (nodes - 1)) == 0) {
+        return -1;
+    }
+    // maxnode counts one bit more than the mask holds, as libnuma passes it
+    return syscall(SYS_set_mempolicy, 3 /* MPOL_INTERLEAVE */, &nodes, 8 * sizeof(nodes) + 1) == 0 ? 0 : -1;
+#else
+    (void)enable;
+    return -1;
+#endif
+}
+
+#endif
+
+// Read a file once through a temporary mapping so its pages sit in the OS page cache; later
+// mappings of the same file (llama.cpp's mmap of the weights) then fault without disk I/O
+static inline int jni_prefetch_file(const char *path) {
+    size_t size;
+    unsigned char *addr = (unsigned char*)jni_map_file(path, &size);
+    if (addr == NULL) {
+        return -1;
+    }
+#ifdef POSIX_MADV_WILLNEED
+    posix_madvise(addr, size, POSIX_MADV_WILLNEED); // start readahead for the whole file
+#endif
+    volatile unsigned char sink = 0;
+    for (size_t offset = 0; offset < size; offset += 4096) {
+        sink ^= addr[offset];
+    }
+    (void)sink;
+    jni_unmap_file(addr, size);
+    return 0;
+}
+
+// Widest x86 vector ISA that both the CPU and the OS (saved register state) support, checked
+// feature for feature against the -march level each variant is built with: JNI_ISA_AVX2 is
+// x86-64-v3 (AVX2, FMA, F16C, BMI1/2, LZCNT, MOVBE), JNI_ISA_AVX512 is x86-64-v4 (AVX-512
+// F/CD/BW/DQ/VL). JNI_ISA_GENERIC on other architectures, and also on an x86-64 CPU short of
+// the v2 baseline (SSE4.2, POPCNT, CX16) that the generic build targets, since there is no
+// lower variant to fall back to; loading it there fails on the first v2 instruction.
+#define JNI_ISA_GENERIC 0
+#define JNI_ISA_AVX2    1
+#define JNI_ISA_AVX512  2
+
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+
+static inline void jni_cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; i++) {
+        regs[i] = (unsigned)r[i];
+    }
+}
+
+static inline unsigned long long jni_xgetbv0(void) {
+    return _xgetbv(0);
+}
+#else
+#include <cpuid.h>
+
+static inline void jni_cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static inline unsigned long long jni_xgetbv0(void) {
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+}
+#endif
+
+static inline int jni_cpu_isa_level(void) {
+    unsigned regs[4];
+    jni_cpuid(0, 0, regs);
+    if (regs[0] < 7) {
+        return JNI_ISA_GENERIC;
+    }
+    jni_cpuid(1, 0, regs);
+    const unsigned ecx1 = regs[2];
+    jni_cpuid(0x80000000u, 0, regs);
+    unsigned ecx_ext = 0;
+    if (regs[0] >= 0x80000001u) {
+        jni_cpuid(0x80000001u, 0, regs);
+        ecx_ext = regs[2];
+    }
+    // SSE3 SSSE3 CX16 SSE4.1 SSE4.2 POPCNT, and LAHF/SAHF in the extended leaf
+    const unsigned v2_ecx = (1u << 0) | (1u << 9) | (1u << 13) | (1u << 19) | (1u << 20) | (1u << 23);
+    if ((ecx1 & v2_ecx) != v2_ecx || !(ecx_ext & 1u)) {
+        return JNI_ISA_GENERIC;
+    }
+    // FMA MOVBE OSXSAVE AVX F16C, and LZCNT in the extended leaf
+    const unsigned v3_ecx = (1u << 12) | (1u << 22) | (1u << 27) | (1u << 28) | (1u << 29);
+    if ((ecx1 & v3_ecx) != v3_ecx || !(ecx_ext & (1u << 5))) {
+        return JNI_ISA_GENERIC;
+    }
+    const unsigned long long xcr0 = jni_xgetbv0();
+    jni_cpuid(7, 0, regs);
+    const unsigned ebx7 = regs[1];
+    const unsigned v3_ebx = (1u << 3) | (1u << 5) | (1u << 8);                  // BMI1 AVX2 BMI2
+    if ((ebx7 & v3_ebx) != v3_ebx || (xcr0 & 0x6) != 0x6) {                      // XMM and YMM state
+        return JNI_ISA_GENERIC;
+    }
+    const unsigned v4_ebx = (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31); // F DQ CD BW VL
+    if ((ebx7 & v4_ebx) != v4_ebx || (xcr0 & 0xE0) != 0xE0) {                   // opmask and ZMM state
+        return JNI_ISA_AVX2;
+    }
+    return JNI_ISA_AVX512;
+}
+#else
+static inline int jni_cpu_isa_level(void) {
+    return JNI_ISA_GENERIC;
+}
+#endif
+
+#endif // LLAMA_JNI_PLATFORM_H
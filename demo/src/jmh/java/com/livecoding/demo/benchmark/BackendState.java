@@ -0,0 +1,57 @@
+package com.livecoding.demo.benchmark;
+
+import com.livecoding.demo.LlamaJNI;
+import com.livecoding.demo.LlamaJNIInterface;
+import com.livecoding.demo.LoadOptions;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.State;
+
+/**
+ * Backend and load settings shared by the benchmarks, set with JMH's -p option:
+ * backend=mock measures the Java side only, backend=native runs modelPath through LlamaJNI.
+ * The load settings keep their native default at 0, so runs can compare thread and batch sizes.
+ */
+@State(Scope.Benchmark)
+public class BackendState {
+    @Param({"mock"})
+    public String backend;
+
+    @Param({""})
+    public String modelPath;
+
+    @Param({"0"})
+    public int threads;
+
+    @Param({"0"})
+    public int batchSize;
+
+    @Param({"0"})
+    public int contexts;
+
+    @Param({"0"})
+    public int sequencesPerContext;
+
+    LlamaJNIInterface newJni() {
+        if (!"native".equals(backend)) {
+            return new MockLlamaJNI();
+        }
+        if (modelPath.isEmpty()) {
+            throw new IllegalStateException("backend=native needs -p modelPath=<model.gguf>");
+        }
+        return new LlamaJNI();
+    }
+
+    String modelPath() {
+        return modelPath.isEmpty() ? "mock.gguf" : modelPath;
+    }
+
+    LoadOptions loadOptions() {
+        LoadOptions options = new LoadOptions();
+        options.setThreads(threads);
+        options.setBatchSize(batchSize);
+        options.setContexts(contexts);
+        options.setSequencesPerContext(sequencesPerContext);
+        return options;
+    }
+}
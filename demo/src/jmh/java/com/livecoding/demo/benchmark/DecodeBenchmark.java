@@ -0,0 +1,48 @@
+package com.livecoding.demo.benchmark;
+
+import com.livecoding.demo.SamplingParams;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OperationsPerInvocation;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.Warmup;
+
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Time per generated token: a short prompt followed by TOKENS greedy tokens. A response that
+ * hits end-of-generation early makes the figure look better than it is; llama_jni_bench
+ * counts the tokens actually decoded.
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MILLISECONDS)
+@Warmup(iterations = 2, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class DecodeBenchmark {
+    static final int TOKENS = 64;
+
+    private String body;
+    private SamplingParams params;
+
+    @Setup
+    public void setUp() {
+        body = Prompts.body(64);
+        params = new SamplingParams();
+        params.setMaxTokens(TOKENS);
+        params.setTemperature(0);
+    }
+
+    @Benchmark
+    @OperationsPerInvocation(TOKENS)
+    public String decode(ModelState model) {
+        return model.jni.generateText(model.handle, Prompts.tagged(body), params);
+    }
+}
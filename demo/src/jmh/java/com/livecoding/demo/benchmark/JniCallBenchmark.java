@@ -0,0 +1,30 @@
+package com.livecoding.demo.benchmark;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Warmup;
+
+import java.util.concurrent.TimeUnit;
+
+/** Cost of a JNI round trip that does no generation work. */
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class JniCallBenchmark {
+
+    @Benchmark
+    public boolean isModelLoaded(ModelState model) {
+        return model.jni.isModelLoaded(model.handle);
+    }
+
+    @Benchmark
+    public String getModelInfo(ModelState model) {
+        return model.jni.getModelInfo(model.handle);
+    }
+}
@@ -0,0 +1,416 @@
+package com.livecoding.demo.benchmark;
+
+import com.fasterxml.jackson.databind.JsonNode;
+import com.fasterxml.jackson.databind.ObjectMapper;
+import com.fasterxml.jackson.databind.node.ObjectNode;
+import org.HdrHistogram.ConcurrentHistogram;
+import org.HdrHistogram.Histogram;
+
+import java.io.IOException;
+import java.net.URI;
+import java.net.URLEncoder;
+import java.net.http.HttpClient;
+import java.net.http.HttpRequest;
+import java.net.http.HttpResponse;
+import java.net.http.HttpTimeoutException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.time.Duration;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Semaphore;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.stream.Stream;
+
+/**
+ * Replays a prompt corpus against a running server's /llama/generate and writes latency
+ * histograms as JSON. Whichever backend LlamaController picks (llama-server or JNI) is
+ * recorded from the mode of /llama/status ("real_llama" or "jni"), so running it once
+ * against each gives the comparison.
+ *
+ * <pre>
+ * LoadGenerator [--url http://localhost:8080] [--prompts corpus.txt] [--method post|get|both]
+ *               [--concurrency 4 | --rps 2.5] [--duration 60] [--requests N] [--max-tokens N]
+ *               [--stream] [--timeout 120] [--output results.json]
+ * </pre>
+ *
+ * With --concurrency each caller sends its next request when the previous one finishes. With
+ * --rps requests start on a fixed schedule, and latency is measured from the scheduled start,
+ * so a stalled server is not hidden by coordinated omission. --stream asks for Server-Sent
+ * Events, which is the only way to observe time to first token; without it TTFT equals total
+ * latency. Tokens are counted as streamed token events, and the server's own count is read
+ * from /actuator/prometheus when that endpoint is exposed.
+ */
+public class LoadGenerator {
+    private static final long HIGHEST_TRACKABLE_MICROS = TimeUnit.MINUTES.toMicros(30);
+    private static final List<String> DEFAULT_PROMPTS = List.of(
+            "Explain the difference between a process and a thread.",
+            "Write a haiku about autumn rain.",
+            "Summarize the plot of Romeo and Juliet in three sentences.",
+            "What are the main causes of inflation?",
+            "Give me a recipe for a simple tomato soup.");
+
+    private final Config config;
+    private final HttpClient client;
+    private final ObjectMapper objectMapper = new ObjectMapper();
+    private final Histogram latency = new ConcurrentHistogram(HIGHEST_TRACKABLE_MICROS, 3);
+    private final Histogram firstToken = new ConcurrentHistogram(HIGHEST_TRACKABLE_MICROS, 3);
+    private final LongAdder succeeded = new LongAdder();
+    private final LongAdder tokenEvents = new LongAdder();
+    private final Map<String, LongAdder> errors = new ConcurrentHashMap<>();
+    private final AtomicLong sequence = new AtomicLong();
+
+    static final class Config {
+        String url = "http://localhost:8080";
+        Path prompts;
+        String method = "post";
+        int concurrency = 1;
+        double rps;
+        long durationSeconds = 60;
+        long requests;
+        Integer maxTokens;
+        boolean stream;
+        long timeoutSeconds = 120;
+        Path output;
+    }
+
+    LoadGenerator(Config config) {
+        this.config = config;
+        this.client = HttpClient.newBuilder().connectTimeout(Duration.ofSeconds(10)).build();
+    }
+
+    public static void main(String[] args) throws Exception {
+        Config config;
+        try {
+            config = parseArgs(args);
+        } catch (IllegalArgumentException e) {
+            System.err.println(e.getMessage());
+            System.err.println("usage: LoadGenerator [--url URL] [--prompts FILE] [--method post|get|both]"
+                    + " [--concurrency N | --rps R] [--duration SECONDS] [--requests N] [--max-tokens N]"
+                    + " [--stream] [--timeout SECONDS] [--output FILE]");
+            System.exit(2);
+            return;
+        }
+
+        ObjectNode results = new LoadGenerator(config).run();
+        String json = new ObjectMapper().writerWithDefaultPrettyPrinter().writeValueAsString(results);
+        if (config.output != null) {
+            Files.writeString(config.output, json);
+            System.err.println("Results written to " + config.output);
+        } else {
+            System.out.println(json);
+        }
+    }
+
+    static Config parseArgs(String[] args) {
+        Config config = new Config();
+        for (int i = 0; i < args.length; i++) {
+            String arg = args[i];
+            if (arg.equals("--stream")) {
+                config.stream = true;
+                continue;
+            }
+            if (i + 1 >= args.length) {
+                throw new IllegalArgumentException("Missing value for " + arg);
+            }
+            String value = args[++i];
+            try {
+                switch (arg) {
+                    case "--url" -> config.url = value.replaceAll("/+$", "");
+                    case "--prompts" -> config.prompts = Path.of(value);
+                    case "--method" -> config.method = value.toLowerCase();
+                    case "--concurrency" -> config.concurrency = Integer.parseInt(value);
+                    case "--rps" -> config.rps = Double.parseDouble(value);
+                    case "--duration" -> config.durationSeconds = Long.parseLong(value);
+                    case "--requests" -> config.requests = Long.parseLong(value);
+                    case "--max-tokens" -> config.maxTokens = Integer.parseInt(value);
+                    case "--timeout" -> config.timeoutSeconds = Long.parseLong(value);
+                    case "--output" -> config.output = Path.of(value);
+                    default -> throw new IllegalArgumentException("Unknown option " + arg);
+                }
+            } catch (NumberFormatException e) {
+                throw new IllegalArgumentException("Invalid value for " + arg + ": " + value);
+            }
+        }
+        if (!List.of("post", "get", "both").contains(config.method)) {
+            throw new IllegalArgumentException("--method must be post, get or both");
+        }
+        if (config.concurrency < 1 || config.rps < 0 || config.durationSeconds < 1 || config.requests < 0
+                || config.timeoutSeconds < 1 || (config.maxTokens != null && config.maxTokens < 1)) {
+            throw new IllegalArgumentException("Numeric options must be positive");
+        }
+        return config;
+    }
+
+    ObjectNode run() throws IOException, InterruptedException {
+        List<String> prompts = loadPrompts();
+        String mode = backendMode();
+        Double tokensBefore = serverGeneratedTokens();
+
+        long start = System.nanoTime();
+        long deadline = start + TimeUnit.SECONDS.toNanos(config.durationSeconds);
+        if (config.rps > 0) {
+            runOpenLoop(prompts, start, deadline);
+        } else {
+            runClosedLoop(prompts, deadline);
+        }
+        double elapsedSeconds = (System.nanoTime() - start) / 1e9;
+
+        Double tokensAfter = serverGeneratedTokens();
+        return results(mode, elapsedSeconds,
+                tokensBefore != null && tokensAfter != null ? tokensAfter - tokensBefore : null);
+    }
+
+    private List<String> loadPrompts() throws IOException {
+        if (config.prompts == null) {
+            return DEFAULT_PROMPTS;
+        }
+        List<String> prompts;
+        try (Stream<String> lines = Files.lines(config.prompts)) {
+            prompts = lines.map(String::strip).filter(line -> !line.isEmpty()).toList();
+        }
+        if (prompts.isEmpty()) {
+            throw new IOException("No prompts in " + config.prompts);
+        }
+        return prompts;
+    }
+
+    // Next request number, or -1 once --requests have been handed out
+    private long nextRequest() {
+        long n = sequence.getAndIncrement();
+        return config.requests > 0 && n >= config.requests ? -1 : n;
+    }
+
+    private void runClosedLoop(List<String> prompts, long deadline) throws InterruptedException {
+        ExecutorService callers = Executors.newFixedThreadPool(config.concurrency);
+        for (int i = 0; i < config.concurrency; i++) {
+            callers.execute(() -> {
+                long n;
+                while (System.nanoTime() < deadline && (n = nextRequest()) >= 0) {
+                    send(prompts.get((int) (n % prompts.size())), n, System.nanoTime());
+                }
+            });
+        }
+        callers.shutdown();
+        callers.awaitTermination(config.durationSeconds + config.timeoutSeconds, TimeUnit.SECONDS);
+    }
+
+    private void runOpenLoop(List<String> prompts, long start, long deadline) throws InterruptedException {
+        long periodNanos = (long) (1e9 / config.rps);
+        ExecutorService callers = Executors.newCachedThreadPool();
+        // Bounds the requests in flight so an overloaded server cannot exhaust threads
+        Semaphore inFlight = new Semaphore(Math.max(config.concurrency, (int) Math.ceil(config.rps * 60)));
+        long n;
+        while ((n = nextRequest()) >= 0) {
+            long scheduled = start + n * periodNanos;
+            if (scheduled >= deadline) {
+                break;
+            }
+            long wait = scheduled - System.nanoTime();
+            if (wait > 0) {
+                TimeUnit.NANOSECONDS.sleep(wait);
+            }
+            inFlight.acquire();
+            long request = n;
+            callers.execute(() -> {
+                try {
+                    send(prompts.get((int) (request % prompts.size())), request, scheduled);
+                } finally {
+                    inFlight.release();
+                }
+            });
+        }
+        callers.shutdown();
+        callers.awaitTermination(config.timeoutSeconds, TimeUnit.SECONDS);
+    }
+
+    // One request; latency counts from startNanos, the intended start under --rps
+    private void send(String prompt, long n, long startNanos) {
+        boolean get = config.method.equals("get") || (config.method.equals("both") && n % 2 == 1);
+        HttpRequest.Builder request = HttpRequest.newBuilder().timeout(Duration.ofSeconds(config.timeoutSeconds));
+        if (get) {
+            request.uri(URI.create(config.url + "/llama/generate?prompt="
+                    + URLEncoder.encode(prompt, StandardCharsets.UTF_8))).GET();
+        } else {
+            ObjectNode body = objectMapper.createObjectNode().put("prompt", prompt);
+            if (config.maxTokens != null) {
+                body.put("maxTokens", config.maxTokens);
+            }
+            request.uri(URI.create(config.url + "/llama/generate"))
+                    .header("Content-Type", "application/json")
+                    .POST(HttpRequest.BodyPublishers.ofString(body.toString()));
+        }
+        request.header("Accept", config.stream ? "text/event-stream" : "application/json");
+
+        try {
+            String error = config.stream
+                    ? sendStreaming(request.build(), startNanos)
+                    : sendPlain(request.build(), startNanos);
+            if (error != null) {
+                errors.computeIfAbsent(error, key -> new LongAdder()).increment();
+                return;
+            }
+            latency.recordValue(micros(startNanos));
+            succeeded.increment();
+        } catch (HttpTimeoutException e) {
+            errors.computeIfAbsent("timeout", key -> new LongAdder()).increment();
+        } catch (IOException e) {
+            errors.computeIfAbsent("io", key -> new LongAdder()).increment();
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+    }
+
+    private String sendPlain(HttpRequest request, long startNanos) throws IOException, InterruptedException {
+        HttpResponse<String> response = client.send(request, HttpResponse.BodyHandlers.ofString());
+        if (response.statusCode() != 200) {
+            return "http_" + response.statusCode();
+        }
+        firstToken.recordValue(micros(startNanos));
+        return null;
+    }
+
+    // Spring's SseEmitter frames: "event:<name>" and "data:<line>" lines, a blank line ends an event
+    private String sendStreaming(HttpRequest request, long startNanos) throws IOException, InterruptedException {
+        HttpResponse<Stream<String>> response = client.send(request, HttpResponse.BodyHandlers.ofLines());
+        try (Stream<String> lines = response.body()) {
+            if (response.statusCode() != 200) {
+                return "http_" + response.statusCode();
+            }
+            String event = null;
+            boolean first = true;
+            for (String line : (Iterable<String>) lines::iterator) {
+                if (line.startsWith("event:")) {
+                    event = line.substring("event:".length()).strip();
+                } else if (line.isEmpty() && event != null) {
+                    switch (event) {
+                        case "token" -> {
+                            if (first) {
+                                firstToken.recordValue(micros(startNanos));
+                                first = false;
+                            }
+                            tokenEvents.increment();
+                        }
+                        case "done" -> {
+                            return first ? "empty_response" : null;
+                        }
+                        case "error" -> {
+                            return "stream_error";
+                        }
+                        default -> {
+                        }
+                    }
+                    event = null;
+                }
+            }
+        }
+        return "stream_truncated";
+    }
+
+    private static long micros(long startNanos) {
+        return Math.min(TimeUnit.NANOSECONDS.toMicros(System.nanoTime() - startNanos), HIGHEST_TRACKABLE_MICROS);
+    }
+
+    // "real_llama" or "jni" as reported by the server, "unknown" if it does not say
+    private String backendMode() {
+        try {
+            HttpResponse<String> response = client.send(
+                    HttpRequest.newBuilder(URI.create(config.url + "/llama/status")).GET().build(),
+                    HttpResponse.BodyHandlers.ofString());
+            JsonNode mode = objectMapper.readTree(response.body()).get("mode");
+            return mode != null ? mode.asText() : "unknown";
+        } catch (IOException e) {
+            return "unknown";
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            return "unknown";
+        }
+    }
+
+    // Sum of llama_generated_tokens_total over all models, or null without a Prometheus endpoint
+    private Double serverGeneratedTokens() {
+        try {
+            HttpResponse<String> response = client.send(
+                    HttpRequest.newBuilder(URI.create(config.url + "/actuator/prometheus")).GET().build(),
+                    HttpResponse.BodyHandlers.ofString());
+            if (response.statusCode() != 200) {
+                return null;
+            }
+            double total = 0;
+            for (String line : response.body().split("\n")) {
+                if (line.startsWith("llama_generated_tokens_total")) {
+                    total += Double.parseDouble(line.substring(line.lastIndexOf(' ') + 1));
+                }
+            }
+            return total;
+        } catch (IOException | NumberFormatException e) {
+            return null;
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            return null;
+        }
+    }
+
+    private ObjectNode results(String mode, double elapsedSeconds, Double serverTokens) {
+        long ok = succeeded.sum();
+        long failed = errors.values().stream().mapToLong(LongAdder::sum).sum();
+
+        ObjectNode results = objectMapper.createObjectNode();
+        ObjectNode run = results.putObject("config");
+        run.put("url", config.url);
+        run.put("method", config.method);
+        run.put("stream", config.stream);
+        if (config.rps > 0) {
+            run.put("target_rps", config.rps);
+        } else {
+            run.put("concurrency", config.concurrency);
+        }
+        run.put("duration_seconds", config.durationSeconds);
+        if (config.maxTokens != null) {
+            run.put("max_tokens", config.maxTokens);
+        }
+        results.put("backend", mode);
+        results.put("elapsed_seconds", elapsedSeconds);
+        results.put("requests", ok + failed);
+        results.put("succeeded", ok);
+        results.put("failed", failed);
+        results.put("error_rate", ok + failed > 0 ? (double) failed / (ok + failed) : 0.0);
+        results.put("throughput_rps", ok / elapsedSeconds);
+        ObjectNode errorCounts = results.putObject("errors");
+        errors.forEach((kind, count) -> errorCounts.put(kind, count.sum()));
+
+        results.set("latency_ms", summary(latency));
+        results.set("ttft_ms", summary(firstToken));
+        if (config.stream) {
+            results.put("token_events", tokenEvents.sum());
+            results.put("token_events_per_second", tokenEvents.sum() / elapsedSeconds);
+        }
+        if (serverTokens != null) {
+            results.put("server_generated_tokens", serverTokens.longValue());
+            results.put("server_tokens_per_second", serverTokens / elapsedSeconds);
+        }
+        return results;
+    }
+
+    private ObjectNode summary(Histogram histogram) {
+        ObjectNode summary = objectMapper.createObjectNode();
+        summary.put("count", histogram.getTotalCount());
+        if (histogram.getTotalCount() == 0) {
+            return summary;
+        }
+        summary.put("mean", histogram.getMean() / 1000.0);
+        summary.put("min", histogram.getMinValue() / 1000.0);
+        summary.put("p50", histogram.getValueAtPercentile(50) / 1000.0);
+        summary.put("p90", histogram.getValueAtPercentile(90) / 1000.0);
+        summary.put("p99", histogram.getValueAtPercentile(99) / 1000.0);
+        summary.put("p999", histogram.getValueAtPercentile(99.9) / 1000.0);
+        summary.put("max", histogram.getMaxValue() / 1000.0);
+        return summary;
+    }
+}
@@ -0,0 +1,165 @@
+package com.livecoding.demo.benchmark;
+
+import com.livecoding.demo.CompletionListener;
+import com.livecoding.demo.LlamaJNIInterface;
+import com.livecoding.demo.LoadOptions;
+import com.livecoding.demo.SamplingParams;
+import com.livecoding.demo.TokenCallback;
+
+import java.nio.ByteBuffer;
+import java.nio.FloatBuffer;
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * Answers every call at once with canned text, so a benchmark against it measures only the
+ * Java side: validation, sanitization, admission and the service's own bookkeeping.
+ */
+public class MockLlamaJNI implements LlamaJNIInterface {
+    static final String RESPONSE = "The quick brown fox jumps over the lazy dog.";
+    private static final byte[] RESPONSE_BYTES = RESPONSE.getBytes(StandardCharsets.UTF_8);
+
+    private final AtomicLong jobIds = new AtomicLong();
+
+    @Override
+    public long loadModel(String path) {
+        return 1;
+    }
+
+    @Override
+    public long loadModel(String path, LoadOptions options) {
+        return 1;
+    }
+
+    @Override
+    public long acquireModel(String id, String path, LoadOptions options) {
+        return 1;
+    }
+
+    @Override
+    public boolean reloadModel(String id, String path, LoadOptions options) {
+        return true;
+    }
+
+    @Override
+    public void releaseModel(long modelHandle) {
+    }
+
+    @Override
+    public boolean evictModel(String id) {
+        return true;
+    }
+
+    @Override
+    public void setModelMemoryBudget(long bytes) {
+    }
+
+    @Override
+    public String[] residentModels() {
+        return new String[0];
+    }
+
+    @Override
+    public long[] getMetrics(String id) {
+        return null;
+    }
+
+    @Override
+    public String generateText(long modelHandle, String prompt) {
+        return RESPONSE;
+    }
+
+    @Override
+    public String generateText(long modelHandle, String prompt, SamplingParams params) {
+        return RESPONSE;
+    }
+
+    @Override
+    public int generateText(long modelHandle, ByteBuffer prompt, int promptLength, SamplingParams params,
+            ByteBuffer output) {
+        int n = Math.min(RESPONSE_BYTES.length, output.capacity());
+        output.duplicate().put(RESPONSE_BYTES, 0, n);
+        return n;
+    }
+
+    @Override
+    public String generateTextStreaming(long modelHandle, String prompt, TokenCallback callback) {
+        callback.onToken(RESPONSE);
+        return RESPONSE;
+    }
+
+    @Override
+    public String generateTextStreaming(long modelHandle, String prompt, SamplingParams params,
+            TokenCallback callback) {
+        callback.onToken(RESPONSE);
+        return RESPONSE;
+    }
+
+    // Like the native completion thread, the listener never runs on the submitting thread
+    @Override
+    public String[] generateBatch(long modelHandle, String[] prompts, SamplingParams params) {
+        String[] results = new String[prompts.length];
+        Arrays.fill(results, RESPONSE);
+        return results;
+    }
+
+    @Override
+    public String generateChat(long modelHandle, String[] roles, String[] contents, SamplingParams params) {
+        return RESPONSE;
+    }
+
+    @Override
+    public int getEmbeddingSize(long modelHandle) {
+        return 16;
+    }
+
+    @Override
+    public int embed(long modelHandle, String[] inputs, FloatBuffer output, boolean normalize) {
+        for (int i = 0; i < inputs.length * 16; i++) {
+            output.put(i, 0.25f);
+        }
+        return 16;
+    }
+
+    @Override
+    public int countTokens(long modelHandle, String text) {
+        return text.length() / 4 + 1;
+    }
+
+    @Override
+    public int[] tokenize(long modelHandle, String text) {
+        return new int[countTokens(modelHandle, text)];
+    }
+
+    @Override
+    public int getContextSize(long modelHandle) {
+        return 4096;
+    }
+
+    @Override
+    public long submitText(long modelHandle, String prompt, SamplingParams params, CompletionListener listener) {
+        CompletableFuture.runAsync(() -> listener.onComplete(RESPONSE));
+        return jobIds.incrementAndGet();
+    }
+
+    @Override
+    public boolean cancel(long modelHandle, long jobId) {
+        return false;
+    }
+
+    @Override
+    public void unloadModel(long modelHandle) {
+    }
+
+    @Override
+    public String getModelInfo(long modelHandle) {
+        return "Mock model";
+    }
+
+    @Override
+    public boolean isModelLoaded(long modelHandle) {
+        return true;
+    }
+}
@@ -0,0 +1,28 @@
+package com.livecoding.demo.benchmark;
+
+import com.livecoding.demo.LlamaJNIInterface;
+import com.livecoding.demo.LoadOptions;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.TearDown;
+
+/** A model held through the JNI registry for the whole trial, for benchmarks below LlamaService. */
+public class ModelState extends BackendState {
+    static final String MODEL_ID = "benchmark";
+
+    LlamaJNIInterface jni;
+    long handle;
+
+    @Setup(Level.Trial)
+    public void load() {
+        jni = newJni();
+        LoadOptions options = loadOptions();
+        handle = jni.acquireModel(MODEL_ID, modelPath(), options.isDefault() ? null : options);
+    }
+
+    @TearDown(Level.Trial)
+    public void unload() {
+        jni.releaseModel(handle);
+        jni.evictModel(MODEL_ID);
+    }
+}
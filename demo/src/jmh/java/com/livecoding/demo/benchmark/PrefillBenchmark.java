@@ -0,0 +1,47 @@
+package com.livecoding.demo.benchmark;
+
+import com.livecoding.demo.SamplingParams;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.Warmup;
+
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Tokenization plus prefill of a whole prompt, generating a single token. Lengths are in
+ * characters (the API takes at most 4000); llama_jni_bench reports the same in tokens.
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MILLISECONDS)
+@Warmup(iterations = 2, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class PrefillBenchmark {
+    @Param({"256", "1024", "3800"})
+    public int promptChars;
+
+    private String body;
+    private SamplingParams params;
+
+    @Setup
+    public void setUp() {
+        body = Prompts.body(promptChars);
+        params = new SamplingParams();
+        params.setMaxTokens(1);
+        params.setTemperature(0);
+    }
+
+    @Benchmark
+    public String prefill(ModelState model) {
+        return model.jni.generateText(model.handle, Prompts.tagged(body), params);
+    }
+}
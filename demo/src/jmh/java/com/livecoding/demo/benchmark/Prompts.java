@@ -0,0 +1,25 @@
+package com.livecoding.demo.benchmark;
+
+import java.util.concurrent.atomic.AtomicLong;
+
+/** Benchmark prompts; each one starts with a fresh tag so the native prefix cache cannot serve it. */
+final class Prompts {
+    private static final String FILLER = " The quick brown fox jumps over the lazy dog near the river bank.";
+    private static final AtomicLong TAGS = new AtomicLong();
+
+    private Prompts() {
+    }
+
+    /** A body of about chars characters, to be passed to {@link #tagged}. */
+    static String body(int chars) {
+        StringBuilder body = new StringBuilder(chars + FILLER.length());
+        while (body.length() + FILLER.length() <= chars) {
+            body.append(FILLER);
+        }
+        return body.toString();
+    }
+
+    static String tagged(String body) {
+        return "Request " + TAGS.incrementAndGet() + ":" + body;
+    }
+}
@@ -0,0 +1,85 @@
+package com.livecoding.demo.benchmark;
+
+import com.livecoding.demo.LlamaException;
+import com.livecoding.demo.LlamaService;
+import com.livecoding.demo.SamplingParams;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Threads;
+import org.openjdk.jmh.annotations.Warmup;
+import org.springframework.test.util.ReflectionTestUtils;
+
+import java.util.concurrent.TimeUnit;
+
+/**
+ * End-to-end LlamaService.generateText under 1, 4 and 16 concurrent callers, including
+ * validation and the service's concurrency limit.
+ */
+@BenchmarkMode({Mode.Throughput, Mode.SampleTime})
+@OutputTimeUnit(TimeUnit.SECONDS)
+@Warmup(iterations = 2, time = 5)
+@Measurement(iterations = 5, time = 5)
+@Fork(1)
+public class ServiceBenchmark {
+    static final int TOKENS = 32;
+
+    @State(Scope.Benchmark)
+    public static class ServiceState extends BackendState {
+        LlamaService service;
+        String body;
+        SamplingParams params;
+
+        // Configured the way Spring would from application.properties
+        @Setup(Level.Trial)
+        public void start() {
+            service = new LlamaService(newJni());
+            ReflectionTestUtils.setField(service, "modelPath", modelPath());
+            ReflectionTestUtils.setField(service, "maxPromptLength", 4000);
+            ReflectionTestUtils.setField(service, "generationTimeoutSeconds", 300);
+            ReflectionTestUtils.setField(service, "threads", threads);
+            ReflectionTestUtils.setField(service, "batchSize", batchSize);
+            ReflectionTestUtils.setField(service, "contexts", contexts);
+            ReflectionTestUtils.setField(service, "sequencesPerContext", sequencesPerContext);
+
+            body = Prompts.body(256);
+            params = new SamplingParams();
+            params.setMaxTokens(TOKENS);
+        }
+
+        @TearDown(Level.Trial)
+        public void stop() {
+            service.cleanup();
+        }
+
+        String generate() throws LlamaException {
+            return service.generateText(Prompts.tagged(body), params);
+        }
+    }
+
+    @Benchmark
+    @Threads(1)
+    public String callers1(ServiceState state) throws LlamaException {
+        return state.generate();
+    }
+
+    @Benchmark
+    @Threads(4)
+    public String callers4(ServiceState state) throws LlamaException {
+        return state.generate();
+    }
+
+    @Benchmark
+    @Threads(16)
+    public String callers16(ServiceState state) throws LlamaException {
+        return state.generate();
+    }
+}
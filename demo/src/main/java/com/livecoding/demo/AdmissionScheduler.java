@@ -0,0 +1,215 @@
+package com.livecoding.demo;
+
+import com.fasterxml.jackson.annotation.JsonCreator;
+
+import java.util.HashMap;
+import java.util.Locale;
+import java.util.Map;
+import java.util.PriorityQueue;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.LongAdder;
+
+/**
+ * Admission in front of the native engine. Capacity is counted in native sequences, so
+ * requests that run start decoding at once instead of queueing natively in FIFO order.
+ * Interactive requests go first; batch requests only run while no interactive one waits and
+ * never hold more than their share of the sequences. Within a class, tenants get equal shares
+ * of the estimated work (start-time fair queueing over prompt plus maxTokens tokens), so one
+ * tenant's burst waits behind everyone else's earlier work instead of in front of it. A full
+ * queue rejects at once with LlamaOverloadedException.
+ */
+public final class AdmissionScheduler {
+
+    public enum Priority {
+        INTERACTIVE, BATCH;
+
+        // Request bodies spell it "interactive" or "batch"
+        @JsonCreator
+        public static Priority fromString(String value) {
+            return valueOf(value.toUpperCase(Locale.ROOT));
+        }
+    }
+
+    /** Tenant of requests that do not name one. */
+    public static final String DEFAULT_TENANT = "default";
+
+    // Finish tags of tenants that went idle are dropped once the map grows past this
+    private static final int MAX_IDLE_TENANTS = 1024;
+
+    private final int capacity;
+    private final int maxQueued;
+    private final ClassQueue interactive;
+    private final ClassQueue batch;
+    private int inUse;                          // guarded by this, like everything below
+    private long sequence;
+
+    private final LongAdder rejected = new LongAdder();
+
+    private static final class Waiter {
+        final int sequences;
+        final long startTag;
+        final long order;
+        boolean granted;
+
+        Waiter(int sequences, long startTag, long order) {
+            this.sequences = sequences;
+            this.startTag = startTag;
+            this.order = order;
+        }
+    }
+
+    private static final class ClassQueue {
+        final int limit;
+        final PriorityQueue<Waiter> waiters = new PriorityQueue<>((a, b) -> a.startTag != b.startTag
+                ? Long.compare(a.startTag, b.startTag) : Long.compare(a.order, b.order));
+        final Map<String, Long> finishTags = new HashMap<>();
+        long virtualTime;
+        int inUse;
+
+        ClassQueue(int limit) {
+            this.limit = limit;
+        }
+
+        long startTag(String tenant, long cost) {
+            long start = Math.max(virtualTime, finishTags.getOrDefault(tenant, 0L));
+            if (finishTags.size() >= MAX_IDLE_TENANTS) {
+                finishTags.values().removeIf(finish -> finish <= virtualTime);
+            }
+            finishTags.put(tenant, start + Math.max(cost, 1));
+            return start;
+        }
+    }
+
+    /** Sequences held by an admitted request; close it exactly once when the request ends. */
+    public final class Permit implements AutoCloseable {
+        private final ClassQueue queue;
+        private final int sequences;
+        private boolean closed;
+
+        private Permit(ClassQueue queue, int sequences) {
+            this.queue = queue;
+            this.sequences = sequences;
+        }
+
+        @Override
+        public void close() {
+            synchronized (AdmissionScheduler.this) {
+                if (closed) {
+                    return;
+                }
+                closed = true;
+                inUse -= sequences;
+                queue.inUse -= sequences;
+                dispatch();
+            }
+        }
+    }
+
+    /**
+     * @param capacity native sequences shared by all requests
+     * @param batchCapacity sequences batch requests may hold at once, at most capacity
+     * @param maxQueued waiting requests per priority class before new ones are rejected
+     */
+    public AdmissionScheduler(int capacity, int batchCapacity, int maxQueued) {
+        this.capacity = Math.max(capacity, 1);
+        this.maxQueued = Math.max(maxQueued, 0);
+        this.interactive = new ClassQueue(this.capacity);
+        this.batch = new ClassQueue(Math.max(Math.min(batchCapacity, this.capacity), 1));
+    }
+
+    /**
+     * Waits until the request may run. sequences is how many native sequences it decodes at
+     * once (more than one for a batch); cost is its estimated prompt plus generated tokens.
+     */
+    public Permit acquire(String tenant, Priority priority, int sequences, long cost, long timeout, TimeUnit unit)
+            throws LlamaException, InterruptedException {
+        ClassQueue queue = priority == Priority.BATCH ? batch : interactive;
+        int needed = Math.max(Math.min(sequences, queue.limit), 1);
+        long deadline = System.nanoTime() + unit.toNanos(timeout);
+
+        synchronized (this) {
+            if (queue.waiters.size() >= maxQueued && !runnable(queue, needed)) {
+                rejected.increment();
+                throw new LlamaOverloadedException("Server overloaded: " + queue.waiters.size() + " "
+                        + priority.name().toLowerCase() + " requests already queued");
+            }
+
+            Waiter waiter = new Waiter(needed, queue.startTag(tenant != null ? tenant : DEFAULT_TENANT, cost),
+                    sequence++);
+            queue.waiters.add(waiter);
+            dispatch();
+
+            try {
+                while (!waiter.granted) {
+                    long left = deadline - System.nanoTime();
+                    if (left <= 0) {
+                        queue.waiters.remove(waiter);
+                        dispatch(); // a large waiter at the head may have held back smaller ones
+                        throw new LlamaException("Generation timeout: too many concurrent requests");
+                    }
+                    TimeUnit.NANOSECONDS.timedWait(this, left);
+                }
+            } catch (InterruptedException e) {
+                if (waiter.granted) {
+                    inUse -= needed;
+                    queue.inUse -= needed;
+                } else {
+                    queue.waiters.remove(waiter);
+                }
+                dispatch();
+                throw e;
+            }
+            return new Permit(queue, needed);
+        }
+    }
+
+    // Whether a new request would be granted right away instead of joining the queue
+    private boolean runnable(ClassQueue queue, int sequences) {
+        return queue.waiters.isEmpty() && fits(queue, sequences)
+                && (queue == interactive || interactive.waiters.isEmpty());
+    }
+
+    private boolean fits(ClassQueue queue, int sequences) {
+        return inUse + sequences <= capacity && queue.inUse + sequences <= queue.limit;
+    }
+
+    // Grants waiters in order while they fit. The interactive head blocks everything behind it,
+    // batch included, so a large request is not starved by a stream of small ones.
+    private void dispatch() {
+        boolean granted = false;
+        for (ClassQueue queue : new ClassQueue[] { interactive, batch }) {
+            Waiter head;
+            while ((head = queue.waiters.peek()) != null && fits(queue, head.sequences)) {
+                queue.waiters.poll();
+                queue.virtualTime = Math.max(queue.virtualTime, head.startTag);
+                inUse += head.sequences;
+                queue.inUse += head.sequences;
+                head.granted = true;
+                granted = true;
+            }
+            if (head != null) {
+                break;
+            }
+        }
+        if (granted) {
+            notifyAll();
+        }
+    }
+
+    public int getCapacity() {
+        return capacity;
+    }
+
+    public synchronized int getInUse() {
+        return inUse;
+    }
+
+    public synchronized int getQueued(Priority priority) {
+        return (priority == Priority.BATCH ? batch : interactive).waiters.size();
+    }
+
+    /** Requests turned away because their class's queue was full. */
+    public long getRejected() {
+        return rejected.sum();
+    }
+}
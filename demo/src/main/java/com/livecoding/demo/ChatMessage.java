@@ -0,0 +1,12 @@
+package com.livecoding.demo;
+
+import java.util.Set;
+
+/**
+ * One turn of a conversation passed to LlamaService.generateChat. The model's own chat
+ * template formats the turns natively, so content is plain text without any markup.
+ */
+public record ChatMessage(String role, String content) {
+    public static final Set<String> ROLES = Set.of("system", "user", "assistant");
+    public static final int MAX_MESSAGES = 256;
+}
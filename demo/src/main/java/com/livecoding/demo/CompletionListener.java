@@ -0,0 +1,11 @@
+package com.livecoding.demo;
+
+/**
+ * Receives the outcome of LlamaJNI.submitText. Exactly one method is called, once,
+ * on the native completion thread, so implementations should hand work off quickly.
+ */
+public interface CompletionListener {
+    void onComplete(String text);
+
+    void onError(String message);
+}
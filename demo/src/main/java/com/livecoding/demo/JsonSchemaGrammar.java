@@ -0,0 +1,340 @@
+package com.livecoding.demo;
+
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+/**
+ * Converts a parsed JSON schema into a GBNF grammar for the native sampler, emitting the same
+ * rules as llama.cpp's json-schema-to-grammar (which lives in llama.cpp's C++ common library,
+ * not in libllama). Supported: type (a name or a list), properties with required, items with
+ * minItems/maxItems, minLength/maxLength, enum, const, anyOf and oneOf; a schema without a
+ * type accepts any JSON value. Properties are generated in schema order and an object with
+ * properties takes no others. Other validation keywords are rejected rather than ignored.
+ */
+final class JsonSchemaGrammar {
+    private static final int MAX_DEPTH = 32;
+
+    private static final Set<String> ANNOTATIONS = Set.of(
+            "$schema", "$id", "$comment", "title", "description", "default", "examples");
+    private static final Set<String> KEYWORDS = Set.of(
+            "type", "properties", "required", "additionalProperties", "items", "minItems", "maxItems",
+            "minLength", "maxLength", "enum", "const", "anyOf", "oneOf");
+
+    private record Primitive(String body, List<String> deps) {
+    }
+
+    private static final Map<String, Primitive> PRIMITIVES = Map.ofEntries(
+            Map.entry("boolean", new Primitive("(\"true\" | \"false\") space", List.of())),
+            Map.entry("null", new Primitive("\"null\" space", List.of())),
+            Map.entry("integral-part", new Primitive("[0] | [1-9] [0-9]{0,15}", List.of())),
+            Map.entry("decimal-part", new Primitive("[0-9]{1,16}", List.of())),
+            Map.entry("number", new Primitive("(\"-\"? integral-part) (\".\" decimal-part)? ([eE] [-+]? integral-part)? space",
+                    List.of("integral-part", "decimal-part"))),
+            Map.entry("integer", new Primitive("(\"-\"? integral-part) space", List.of("integral-part"))),
+            Map.entry("char", new Primitive("[^\"\\\\\\x7F\\x00-\\x1F] | [\\\\] ([\"\\\\bfnrt] | \"u\" [0-9a-fA-F]{4})", List.of())),
+            Map.entry("string", new Primitive("\"\\\"\" char* \"\\\"\" space", List.of("char"))),
+            Map.entry("value", new Primitive("object | array | string | number | boolean | null",
+                    List.of("object", "array", "string", "number", "boolean", "null"))),
+            Map.entry("object", new Primitive("\"{\" space ( string \":\" space value (\",\" space string \":\" space value)* )? \"}\" space",
+                    List.of("string", "value"))),
+            Map.entry("array", new Primitive("\"[\" space ( value (\",\" space value)* )? \"]\" space", List.of("value"))));
+
+    private final Map<String, String> rules = new LinkedHashMap<>();
+
+    private JsonSchemaGrammar() {
+    }
+
+    /** GBNF text whose "root" rule matches exactly the JSON documents the schema allows. */
+    static String toGrammar(Map<String, Object> schema) throws LlamaException {
+        JsonSchemaGrammar converter = new JsonSchemaGrammar();
+        converter.rules.put("space", "| \" \" | \"\\n\" [ \\t]{0,20}");
+        String root = converter.visit(schema, "root", 0);
+
+        StringBuilder grammar = new StringBuilder("root ::= ").append(root).append('\n');
+        for (Map.Entry<String, String> rule : converter.rules.entrySet()) {
+            grammar.append(rule.getKey()).append(" ::= ").append(rule.getValue()).append('\n');
+        }
+        if (grammar.length() > SamplingParams.MAX_GRAMMAR_LENGTH) {
+            throw new LlamaException("JSON schema too large");
+        }
+        return grammar.toString();
+    }
+
+    // Rule body for the schema; nested schemas get rules named after their path from the root
+    private String visit(Object node, String name, int depth) throws LlamaException {
+        if (depth > MAX_DEPTH) {
+            throw new LlamaException("JSON schema nested too deeply");
+        }
+        if (Boolean.TRUE.equals(node)) {
+            return primitive("value");
+        }
+        Map<String, Object> schema = asSchema(node);
+        for (String key : schema.keySet()) {
+            if (!KEYWORDS.contains(key) && !ANNOTATIONS.contains(key)) {
+                throw new LlamaException("Unsupported JSON schema keyword: " + key);
+            }
+        }
+
+        if (schema.containsKey("const")) {
+            return gbnfLiteral(jsonLiteral(schema.get("const"))) + " space";
+        }
+        if (schema.containsKey("enum")) {
+            List<String> values = new ArrayList<>();
+            for (Object value : asList(schema.get("enum"), "enum")) {
+                values.add(gbnfLiteral(jsonLiteral(value)));
+            }
+            return "(" + String.join(" | ", values) + ") space";
+        }
+        for (String union : new String[] { "anyOf", "oneOf" }) {
+            if (schema.containsKey(union)) {
+                List<String> alternatives = new ArrayList<>();
+                List<?> schemas = asList(schema.get(union), union);
+                for (int i = 0; i < schemas.size(); i++) {
+                    alternatives.add(ref(schemas.get(i), name + "-" + i, depth + 1));
+                }
+                return String.join(" | ", alternatives);
+            }
+        }
+
+        Object type = schema.get("type");
+        if (type instanceof List<?> types) {
+            List<String> alternatives = new ArrayList<>();
+            for (Object t : types) {
+                alternatives.add(typeBody(schema, asTypeName(t), name, depth));
+            }
+            return String.join(" | ", alternatives);
+        }
+        if (type != null) {
+            return typeBody(schema, asTypeName(type), name, depth);
+        }
+        if (schema.containsKey("properties")) {
+            return typeBody(schema, "object", name, depth);
+        }
+        if (schema.containsKey("items")) {
+            return typeBody(schema, "array", name, depth);
+        }
+        return primitive("value");
+    }
+
+    private String typeBody(Map<String, Object> schema, String type, String name, int depth) throws LlamaException {
+        switch (type) {
+            case "string" -> {
+                if (!schema.containsKey("minLength") && !schema.containsKey("maxLength")) {
+                    return primitive("string");
+                }
+                primitive("char");
+                return "\"\\\"\" " + repeat("char", count(schema, "minLength", 0), bound(schema, "maxLength"))
+                        + " \"\\\"\" space";
+            }
+            case "number", "integer", "boolean", "null" -> {
+                return primitive(type);
+            }
+            case "object" -> {
+                return schema.containsKey("properties") ? objectBody(schema, name, depth) : primitive("object");
+            }
+            case "array" -> {
+                return arrayBody(schema, name, depth);
+            }
+            default -> throw new LlamaException("Unsupported JSON schema type: " + type);
+        }
+    }
+
+    // Required properties in schema order, then the optional ones, each at most once and in
+    // order, with commas only between the properties present
+    private String objectBody(Map<String, Object> schema, String name, int depth) throws LlamaException {
+        Object additional = schema.get("additionalProperties");
+        if (additional != null && !Boolean.FALSE.equals(additional)) {
+            throw new LlamaException("Unsupported JSON schema keyword: additionalProperties");
+        }
+        Map<String, Object> properties = asSchema(schema.get("properties"));
+        List<String> required = new ArrayList<>();
+        if (schema.containsKey("required")) {
+            for (Object key : asList(schema.get("required"), "required")) {
+                if (!(key instanceof String) || !properties.containsKey(key)) {
+                    throw new LlamaException("JSON schema requires an undefined property: " + key);
+                }
+                required.add((String) key);
+            }
+        }
+
+        List<String> requiredRules = new ArrayList<>();
+        List<String> optionalRules = new ArrayList<>();
+        for (Map.Entry<String, Object> property : properties.entrySet()) {
+            String propertyName = name + "-" + property.getKey();
+            String kv = addRule(propertyName + "-kv", gbnfLiteral(jsonLiteral(property.getKey())) + " space \":\" space "
+                    + ref(property.getValue(), propertyName, depth + 1));
+            (required.contains(property.getKey()) ? requiredRules : optionalRules).add(kv);
+        }
+
+        StringBuilder body = new StringBuilder("\"{\" space ");
+        body.append(String.join(" \",\" space ", requiredRules));
+        if (!optionalRules.isEmpty()) {
+            body.append(" (");
+            if (!requiredRules.isEmpty()) {
+                body.append(" \",\" space ( ");
+            }
+            List<String> alternatives = new ArrayList<>();
+            for (int i = 0; i < optionalRules.size(); i++) {
+                alternatives.add(optionalChain(optionalRules.subList(i, optionalRules.size()), false));
+            }
+            body.append(String.join(" | ", alternatives));
+            if (!requiredRules.isEmpty()) {
+                body.append(" )");
+            }
+            body.append(" )?");
+        }
+        return body.append(" \"}\" space").toString();
+    }
+
+    // The first property of the chain (present unless firstOptional), then the rest, each optional
+    private String optionalChain(List<String> kvs, boolean firstOptional) {
+        String first = firstOptional ? "( \",\" space " + kvs.get(0) + " )?" : kvs.get(0);
+        if (kvs.size() == 1) {
+            return first;
+        }
+        return first + " " + addRule(kvs.get(0) + "-rest", optionalChain(kvs.subList(1, kvs.size()), true));
+    }
+
+    private String arrayBody(Map<String, Object> schema, String name, int depth) throws LlamaException {
+        String item = schema.containsKey("items") ? ref(schema.get("items"), name + "-item", depth + 1) : primitive("value");
+        int min = count(schema, "minItems", 0);
+        Integer max = bound(schema, "maxItems");
+        if (max != null && max < min) {
+            throw new LlamaException("JSON schema maxItems is below minItems");
+        }
+        if (max != null && max == 0) {
+            return "\"[\" space \"]\" space";
+        }
+        String items = item + " " + repeat("(\",\" space " + item + ")", Math.max(min - 1, 0), max != null ? max - 1 : null);
+        return "\"[\" space " + (min == 0 ? "( " + items + " )?" : items) + " \"]\" space";
+    }
+
+    private static String repeat(String item, int min, Integer max) {
+        if (max == null) {
+            return min == 0 ? item + "*" : item + "{" + min + ",}";
+        }
+        if (max == 0) {
+            return "";
+        }
+        return min == max ? item + "{" + min + "}" : item + "{" + min + "," + max + "}";
+    }
+
+    private String ref(Object node, String name, int depth) throws LlamaException {
+        return addRule(name, visit(node, name, depth));
+    }
+
+    // Rule names may only hold letters, digits and dashes; a taken name with a different body
+    // gets a numeric suffix
+    private String addRule(String name, String body) {
+        String base = name.replaceAll("[^a-zA-Z0-9-]+", "-");
+        String key = base;
+        for (int i = 0; rules.containsKey(key) && !rules.get(key).equals(body); i++) {
+            key = base + i;
+        }
+        rules.put(key, body);
+        return key;
+    }
+
+    private String primitive(String name) {
+        Primitive primitive = PRIMITIVES.get(name);
+        if (rules.putIfAbsent(name, primitive.body()) == null) {
+            for (String dep : primitive.deps()) {
+                primitive(dep);
+            }
+        }
+        return name;
+    }
+
+    @SuppressWarnings("unchecked")
+    private static Map<String, Object> asSchema(Object node) throws LlamaException {
+        if (!(node instanceof Map)) {
+            throw new LlamaException("JSON schema must be an object");
+        }
+        return (Map<String, Object>) node;
+    }
+
+    private static List<?> asList(Object node, String keyword) throws LlamaException {
+        if (!(node instanceof List<?> list) || list.isEmpty() && !keyword.equals("required")) {
+            throw new LlamaException("JSON schema " + keyword + " must be a non-empty array");
+        }
+        return list;
+    }
+
+    private static String asTypeName(Object type) throws LlamaException {
+        if (!(type instanceof String name)) {
+            throw new LlamaException("JSON schema type must be a string");
+        }
+        return name;
+    }
+
+    private static int count(Map<String, Object> schema, String keyword, int defaultValue) throws LlamaException {
+        Integer value = bound(schema, keyword);
+        return value != null ? value : defaultValue;
+    }
+
+    private static Integer bound(Map<String, Object> schema, String keyword) throws LlamaException {
+        Object value = schema.get(keyword);
+        if (value == null) {
+            return null;
+        }
+        if (!(value instanceof Integer || value instanceof Long) || ((Number) value).longValue() < 0
+                || ((Number) value).longValue() > 100_000) {
+            throw new LlamaException("JSON schema " + keyword + " must be a non-negative integer");
+        }
+        return ((Number) value).intValue();
+    }
+
+    // The JSON text of an enum or const value
+    private static String jsonLiteral(Object value) throws LlamaException {
+        if (value == null) {
+            return "null";
+        }
+        if (value instanceof Boolean || value instanceof Number) {
+            return value.toString();
+        }
+        if (!(value instanceof String text)) {
+            throw new LlamaException("JSON schema enum and const values must be scalars");
+        }
+        StringBuilder json = new StringBuilder("\"");
+        for (int i = 0; i < text.length(); i++) {
+            char c = text.charAt(i);
+            switch (c) {
+                case '"' -> json.append("\\\"");
+                case '\\' -> json.append("\\\\");
+                case '\n' -> json.append("\\n");
+                case '\r' -> json.append("\\r");
+                case '\t' -> json.append("\\t");
+                case '\b' -> json.append("\\b");
+                case '\f' -> json.append("\\f");
+                default -> {
+                    if (c < 0x20) {
+                        json.append(String.format("\\u%04x", (int) c));
+                    } else {
+                        json.append(c);
+                    }
+                }
+            }
+        }
+        return json.append('"').toString();
+    }
+
+    // A GBNF string literal matching text exactly
+    private static String gbnfLiteral(String text) {
+        StringBuilder literal = new StringBuilder("\"");
+        for (int i = 0; i < text.length(); i++) {
+            char c = text.charAt(i);
+            switch (c) {
+                case '"' -> literal.append("\\\"");
+                case '\\' -> literal.append("\\\\");
+                case '\n' -> literal.append("\\n");
+                case '\r' -> literal.append("\\r");
+                case '\t' -> literal.append("\\t");
+                default -> literal.append(c);
+            }
+        }
+        return literal.append('"').toString();
+    }
+}
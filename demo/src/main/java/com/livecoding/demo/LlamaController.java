@@ -4,10 +4,23 @@ import org.springframework.web.bind.annotation.*;
 import org.springframework.beans.factory.annotation.Autowired;
 import org.springframework.http.ResponseEntity;
 import org.springframework.http.HttpStatus;
+import org.springframework.http.MediaType;
 import org.springframework.validation.annotation.Validated;
+import org.springframework.web.context.request.async.DeferredResult;
+import org.springframework.web.servlet.mvc.method.annotation.SseEmitter;
+import jakarta.annotation.PreDestroy;
 
+import java.io.IOException;
+import java.io.UncheckedIOException;
+import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
 import java.util.Map;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.CompletionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
 
 @RestController
 @RequestMapping("/llama")
@@ -20,16 +33,25 @@ public class LlamaController {
     @Autowired
     private RealLlamaService realLlamaService;
 
+    // Streaming and async responses are produced off the servlet thread
+    private static final long STREAM_TIMEOUT_MS = 120_000;
+    private final ExecutorService streamExecutor = Executors.newCachedThreadPool();
+
     @PostMapping("/generate")
     public ResponseEntity<Map<String, Object>> generate(@RequestBody GenerateRequest request) {
         try {
             String result;
+            SamplingParams params = toSamplingParams(request);
 
-            // Try real LLaMA first, fall back to JNI mock if server not available
+            // Cached circuit state from the background health check; no probe per request
             if (realLlamaService.isServerRunning()) {
-                result = realLlamaService.generateText(request.getPrompt());
+                result = params != null
+                        ? realLlamaService.generateText(request.getPrompt(), params)
+                        : realLlamaService.generateText(request.getPrompt());
             } else {
-                result = llamaService.generateText(request.getPrompt());
+                result = params != null
+                        ? llamaService.generateText(request.getPrompt(), params)
+                        : llamaService.generateText(request.getPrompt());
             }
 
             Map<String, Object> response = new HashMap<>();
@@ -38,6 +60,8 @@ public class LlamaController {
             response.put("prompt_length", request.getPrompt().length());
 
             return ResponseEntity.ok(response);
+        } catch (LlamaOverloadedException e) {
+            return createOverloadedResponse(e);
         } catch (LlamaException e) {
             return createErrorResponse(HttpStatus.BAD_REQUEST, "Generation failed", e.getMessage());
         } catch (Exception e) {
@@ -55,7 +79,7 @@ public class LlamaController {
 
             String result;
 
-            // Try real LLaMA first, fall back to JNI mock if server not available
+            // Cached circuit state from the background health check; no probe per request
             if (realLlamaService.isServerRunning()) {
                 result = realLlamaService.generateText(prompt);
             } else {
@@ -68,6 +92,8 @@ public class LlamaController {
             response.put("prompt_length", prompt.length());
 
             return ResponseEntity.ok(response);
+        } catch (LlamaOverloadedException e) {
+            return createOverloadedResponse(e);
         } catch (LlamaException e) {
             return createErrorResponse(HttpStatus.BAD_REQUEST, "Generation failed", e.getMessage());
         } catch (Exception e) {
@@ -76,23 +102,351 @@ public class LlamaController {
         }
     }
 
+    // Same contract as POST /generate, but the servlet thread is released while the
+    // request waits in the native scheduler
+    @PostMapping("/generate/async")
+    public DeferredResult<ResponseEntity<Map<String, Object>>> generateAsync(@RequestBody GenerateRequest request) {
+        DeferredResult<ResponseEntity<Map<String, Object>>> result = new DeferredResult<>(STREAM_TIMEOUT_MS);
+
+        String prompt = request.getPrompt();
+        SamplingParams params = toSamplingParams(request);
+        CompletableFuture<String> future;
+        if (realLlamaService.isServerRunning()) {
+            future = CompletableFuture.supplyAsync(() -> {
+                try {
+                    return params != null
+                            ? realLlamaService.generateText(prompt, params)
+                            : realLlamaService.generateText(prompt);
+                } catch (Exception e) {
+                    throw new CompletionException(e);
+                }
+            }, streamExecutor);
+        } else {
+            future = llamaService.generateTextAsync(prompt, params);
+        }
+
+        // A request nobody waits for any more should not keep its sequence busy
+        result.onTimeout(() -> {
+            result.setResult(createErrorResponse(HttpStatus.SERVICE_UNAVAILABLE,
+                    "Generation timeout", "Generation did not finish in time"));
+            future.cancel(false);
+        });
+        result.onError(error -> future.cancel(false));
+
+        future.whenComplete((text, error) -> {
+            if (error == null) {
+                Map<String, Object> response = new HashMap<>();
+                response.put("text", text);
+                response.put("status", "success");
+                response.put("prompt_length", prompt.length());
+                result.setResult(ResponseEntity.ok(response));
+                return;
+            }
+            Throwable cause = error instanceof CompletionException && error.getCause() != null
+                    ? error.getCause() : error;
+            if (cause instanceof LlamaException) {
+                result.setResult(createErrorResponse(HttpStatus.BAD_REQUEST, "Generation failed", cause.getMessage()));
+            } else {
+                result.setResult(createErrorResponse(HttpStatus.INTERNAL_SERVER_ERROR, "Internal error",
+                        "An unexpected error occurred"));
+            }
+        });
+
+        return result;
+    }
+
+    // Independent prompts in one call for offline jobs. On the JNI backend they are decoded
+    // side by side in one native call; llama-server gets them as parallel requests instead.
+    @PostMapping("/generate/batch")
+    public ResponseEntity<Map<String, Object>> generateBatch(@RequestBody BatchRequest request) {
+        try {
+            List<String> prompts = request.getPrompts();
+            if (prompts == null || prompts.isEmpty()) {
+                return createErrorResponse(HttpStatus.BAD_REQUEST, "Invalid input", "Prompts cannot be empty");
+            }
+            if (prompts.size() > llamaService.getMaxBatchPrompts()) {
+                return createErrorResponse(HttpStatus.BAD_REQUEST, "Invalid input",
+                        "Too many prompts. Maximum per batch: " + llamaService.getMaxBatchPrompts());
+            }
+
+            GenerateRequest options = new GenerateRequest();
+            options.setMaxTokens(request.getMaxTokens());
+            options.setTemperature(request.getTemperature());
+            options.setModel(request.getModel());
+            options.setTenant(request.getTenant());
+            options.setPriority(request.getPriority());
+            options.setGrammar(request.getGrammar());
+            options.setJsonSchema(request.getJsonSchema());
+            SamplingParams params = toSamplingParams(options);
+
+            List<String> texts;
+            if (realLlamaService.isServerRunning()) {
+                texts = generateBatchOnServer(prompts, params);
+            } else {
+                texts = llamaService.generateBatch(prompts, params);
+            }
+
+            List<Map<String, Object>> results = new ArrayList<>();
+            for (String text : texts) {
+                Map<String, Object> result = new HashMap<>();
+                if (text != null) {
+                    result.put("status", "success");
+                    result.put("text", text);
+                } else {
+                    result.put("status", "error");
+                    result.put("error", "Generation failed");
+                }
+                results.add(result);
+            }
+
+            Map<String, Object> response = new HashMap<>();
+            response.put("status", "success");
+            response.put("results", results);
+            response.put("count", results.size());
+
+            return ResponseEntity.ok(response);
+        } catch (LlamaOverloadedException e) {
+            return createOverloadedResponse(e);
+        } catch (LlamaException e) {
+            return createErrorResponse(HttpStatus.BAD_REQUEST, "Generation failed", e.getMessage());
+        } catch (Exception e) {
+            return createErrorResponse(HttpStatus.INTERNAL_SERVER_ERROR, "Internal error",
+                    "An unexpected error occurred");
+        }
+    }
+
+    // Always served by the JNI backend, which formats the messages with the model's own chat
+    // template; earlier turns of a growing conversation come from the prefix cache
+    @PostMapping("/chat")
+    public ResponseEntity<Map<String, Object>> chat(@RequestBody ChatRequest request) {
+        try {
+            List<ChatMessage> messages = request.getMessages();
+            if (messages == null || messages.isEmpty()) {
+                return createErrorResponse(HttpStatus.BAD_REQUEST, "Invalid input", "Messages cannot be empty");
+            }
+
+            GenerateRequest options = new GenerateRequest();
+            options.setMaxTokens(request.getMaxTokens());
+            options.setTemperature(request.getTemperature());
+            options.setSessionId(request.getSessionId());
+            options.setModel(request.getModel());
+            options.setTenant(request.getTenant());
+            options.setPriority(request.getPriority());
+            options.setGrammar(request.getGrammar());
+            options.setJsonSchema(request.getJsonSchema());
+
+            String text = llamaService.generateChat(messages, toSamplingParams(options));
+
+            Map<String, Object> response = new HashMap<>();
+            response.put("text", text);
+            response.put("status", "success");
+            response.put("messages", messages.size());
+
+            return ResponseEntity.ok(response);
+        } catch (LlamaOverloadedException e) {
+            return createOverloadedResponse(e);
+        } catch (LlamaException e) {
+            return createErrorResponse(HttpStatus.BAD_REQUEST, "Generation failed", e.getMessage());
+        } catch (Exception e) {
+            return createErrorResponse(HttpStatus.INTERNAL_SERVER_ERROR, "Internal error",
+                    "An unexpected error occurred");
+        }
+    }
+
+    private List<String> generateBatchOnServer(List<String> prompts, SamplingParams params) {
+        List<CompletableFuture<String>> futures = new ArrayList<>();
+        for (String prompt : prompts) {
+            futures.add(CompletableFuture.supplyAsync(() -> {
+                try {
+                    return params != null
+                            ? realLlamaService.generateText(prompt, params)
+                            : realLlamaService.generateText(prompt);
+                } catch (Exception e) {
+                    return null;
+                }
+            }, streamExecutor));
+        }
+        List<String> texts = new ArrayList<>();
+        for (CompletableFuture<String> future : futures) {
+            texts.add(future.join());
+        }
+        return texts;
+    }
+
+    // Pooled embeddings from the JNI backend, one vector per input in input order
+    @PostMapping("/embed")
+    public ResponseEntity<Map<String, Object>> embed(@RequestBody EmbedRequest request) {
+        try {
+            List<float[]> vectors = llamaService.embed(request.getInputs(), request.getModel(),
+                    request.getNormalize() == null || request.getNormalize());
+
+            Map<String, Object> response = new HashMap<>();
+            response.put("status", "success");
+            response.put("embeddings", vectors);
+            response.put("count", vectors.size());
+            response.put("dimensions", vectors.isEmpty() ? 0 : vectors.get(0).length);
+            response.put("model", request.getModel() != null ? request.getModel() : LlamaService.DEFAULT_MODEL_ID);
+
+            return ResponseEntity.ok(response);
+        } catch (LlamaOverloadedException e) {
+            return createOverloadedResponse(e);
+        } catch (LlamaException e) {
+            return createErrorResponse(HttpStatus.BAD_REQUEST, "Embedding failed", e.getMessage());
+        } catch (Exception e) {
+            return createErrorResponse(HttpStatus.INTERNAL_SERVER_ERROR, "Internal error",
+                    "An unexpected error occurred");
+        }
+    }
+
+    // Token ids of the text as the JNI backend would tokenize it as a prompt, e.g. to budget
+    // or truncate prompts in tokens before generating
+    @PostMapping("/tokenize")
+    public ResponseEntity<Map<String, Object>> tokenize(@RequestBody TokenizeRequest request) {
+        try {
+            int[] tokens = llamaService.tokenize(request.getText(), request.getModel());
+
+            Map<String, Object> response = new HashMap<>();
+            response.put("status", "success");
+            response.put("tokens", tokens);
+            response.put("count", tokens.length);
+            response.put("context_size", llamaService.getContextSize(request.getModel()));
+            response.put("model", request.getModel() != null ? request.getModel() : LlamaService.DEFAULT_MODEL_ID);
+
+            return ResponseEntity.ok(response);
+        } catch (LlamaException e) {
+            return createErrorResponse(HttpStatus.BAD_REQUEST, "Tokenization failed", e.getMessage());
+        } catch (Exception e) {
+            return createErrorResponse(HttpStatus.INTERNAL_SERVER_ERROR, "Internal error",
+                    "An unexpected error occurred");
+        }
+    }
+
+    // Server-Sent Events variants of /generate, selected with "Accept: text/event-stream".
+    // Emits one "token" event per chunk of text, then a "done" or "error" event.
+    @PostMapping(value = "/generate", produces = MediaType.TEXT_EVENT_STREAM_VALUE)
+    public SseEmitter generateStream(@RequestBody GenerateRequest request) {
+        return streamGeneration(request.getPrompt(), toSamplingParams(request));
+    }
+
+    @GetMapping(value = "/generate", produces = MediaType.TEXT_EVENT_STREAM_VALUE)
+    public SseEmitter generateGetStream(@RequestParam String prompt) {
+        return streamGeneration(prompt, null);
+    }
+
+    // Only requests that override a sampling setting or name a session or model take the per-request path
+    private SamplingParams toSamplingParams(GenerateRequest request) {
+        if (request.getMaxTokens() == null && request.getTemperature() == null && request.getSessionId() == null
+                && request.getModel() == null && request.getTenant() == null && request.getPriority() == null
+                && request.getGrammar() == null && request.getJsonSchema() == null) {
+            return null;
+        }
+        SamplingParams params = new SamplingParams();
+        if (request.getMaxTokens() != null) {
+            params.setMaxTokens(request.getMaxTokens());
+        }
+        if (request.getTemperature() != null) {
+            params.setTemperature(request.getTemperature());
+        }
+        params.setSessionId(request.getSessionId());
+        params.setModel(request.getModel());
+        params.setTenant(request.getTenant());
+        params.setPriority(request.getPriority());
+        params.setGrammar(request.getGrammar());
+        params.setJsonSchema(request.getJsonSchema());
+        return params;
+    }
+
+    private SseEmitter streamGeneration(String prompt, SamplingParams params) {
+        SseEmitter emitter = new SseEmitter(STREAM_TIMEOUT_MS);
+
+        if (prompt == null || prompt.trim().isEmpty()) {
+            sendError(emitter, "Invalid input", "Prompt cannot be null or empty");
+            return emitter;
+        }
+
+        streamExecutor.execute(() -> {
+            try {
+                if (realLlamaService.isServerRunning()) {
+                    realLlamaService.generateTextStreaming(prompt, params, piece -> sendToken(emitter, piece));
+                } else {
+                    llamaService.generateTextStreaming(prompt, params, piece -> sendToken(emitter, piece));
+                }
+
+                Map<String, Object> done = new HashMap<>();
+                done.put("status", "success");
+                done.put("prompt_length", prompt.length());
+                emitter.send(SseEmitter.event().name("done").data(done, MediaType.APPLICATION_JSON));
+                emitter.complete();
+            } catch (LlamaOverloadedException e) {
+                sendError(emitter, "Server overloaded", e.getMessage());
+            } catch (LlamaException e) {
+                sendError(emitter, "Generation failed", e.getMessage());
+            } catch (Exception e) {
+                sendError(emitter, "Internal error", "An unexpected error occurred");
+            }
+        });
+
+        return emitter;
+    }
+
+    private void sendToken(SseEmitter emitter, String piece) {
+        try {
+            emitter.send(SseEmitter.event().name("token").data(piece));
+        } catch (IOException e) {
+            // Client went away; the native side cancels the job and rethrows this once it has stopped
+            throw new UncheckedIOException(e);
+        }
+    }
+
+    private void sendError(SseEmitter emitter, String error, String message) {
+        Map<String, Object> errorEvent = new HashMap<>();
+        errorEvent.put("status", "error");
+        errorEvent.put("error", error);
+        errorEvent.put("message", message);
+        errorEvent.put("timestamp", System.currentTimeMillis());
+        try {
+            emitter.send(SseEmitter.event().name("error").data(errorEvent, MediaType.APPLICATION_JSON));
+            emitter.complete();
+        } catch (IOException | IllegalStateException e) {
+            emitter.completeWithError(e);
+        }
+    }
+
+    @PreDestroy
+    public void shutdown() {
+        streamExecutor.shutdownNow();
+    }
+
     @GetMapping("/status")
     public ResponseEntity<Map<String, Object>> getStatus() {
         try {
             Map<String, Object> status = new HashMap<>();
 
             boolean realLlamaAvailable = realLlamaService.isServerRunning();
-            status.put("model_loaded", true);
             status.put("real_llama_available", realLlamaAvailable);
+            status.put("real_llama_circuit", String.valueOf(realLlamaService.getCircuitState()).toLowerCase());
 
             if (realLlamaAvailable) {
-                status.put("model_status", "Real LLaMA-3.2-3B server running on http://127.0.0.1:8081");
+                status.put("model_status", "Real LLaMA-3.2-3B server running");
+                Map<String, String> upstreams = new LinkedHashMap<>();
+                realLlamaService.getUpstreamStates().forEach((url, state) ->
+                        upstreams.put(url, state.name().toLowerCase()));
+                status.put("real_llama_upstreams", upstreams);
+                status.put("model_loaded", true);
                 status.put("mode", "real_llama");
             } else {
+                status.put("model_loaded", llamaService.isModelLoaded());
                 status.put("model_status", llamaService.getModelStatus());
-                status.put("mode", "enhanced_mock");
+                status.put("resident_models", llamaService.getResidentModels());
+                status.put("warmup", llamaService.getWarmupState().name().toLowerCase());
+                status.put("admission", llamaService.getAdmissionStatus());
+                if (llamaService.getWarmupError() != null) {
+                    status.put("warmup_error", llamaService.getWarmupError());
+                }
+                status.put("mode", "jni");
             }
 
+            status.put("ready", realLlamaAvailable || llamaService.isReady());
             status.put("status", "healthy");
 
             return ResponseEntity.ok(status);
@@ -101,22 +455,32 @@ public class LlamaController {
         }
     }
 
+    // Blue/green: returns once the new copy serves; requests in flight finish on the old one
     @PostMapping("/reload")
-    public ResponseEntity<Map<String, Object>> reloadModel() {
+    public ResponseEntity<Map<String, Object>> reloadModel(@RequestParam(required = false) String model) {
         try {
-            // This would trigger cleanup and reload
-            llamaService.cleanup();
+            llamaService.reloadModel(model);
 
             Map<String, Object> response = new HashMap<>();
             response.put("status", "success");
-            response.put("message", "Model reload initiated");
+            response.put("message", "Model reloaded");
+            response.put("model", model != null ? model : LlamaService.DEFAULT_MODEL_ID);
 
             return ResponseEntity.ok(response);
+        } catch (LlamaException e) {
+            return createErrorResponse(HttpStatus.INTERNAL_SERVER_ERROR, "Reload failed", e.getMessage());
         } catch (Exception e) {
             return createErrorResponse(HttpStatus.INTERNAL_SERVER_ERROR, "Reload failed", e.getMessage());
         }
     }
 
+    // Shed before queueing, so clients can back off and retry right away instead of timing out
+    private ResponseEntity<Map<String, Object>> createOverloadedResponse(LlamaOverloadedException e) {
+        ResponseEntity<Map<String, Object>> response = createErrorResponse(HttpStatus.TOO_MANY_REQUESTS,
+                "Server overloaded", e.getMessage());
+        return ResponseEntity.status(response.getStatusCode()).header("Retry-After", "1").body(response.getBody());
+    }
+
     private ResponseEntity<Map<String, Object>> createErrorResponse(HttpStatus status, String error, String message) {
         Map<String, Object> errorResponse = new HashMap<>();
         errorResponse.put("status", "error");
@@ -132,6 +496,12 @@ public class LlamaController {
         private String prompt;
         private Integer maxTokens;
         private Float temperature;
+        private String sessionId;
+        private String model;
+        private String tenant;                          // fair-share key for admission
+        private AdmissionScheduler.Priority priority;   // "interactive" or "batch"
+        private String grammar;                         // GBNF the output must match
+        private Map<String, Object> jsonSchema;         // or a JSON schema, converted to GBNF
 
         public String getPrompt() {
             return prompt;
@@ -156,5 +526,267 @@ public class LlamaController {
         public void setTemperature(Float temperature) {
             this.temperature = temperature;
         }
+
+        public String getSessionId() {
+            return sessionId;
+        }
+
+        public void setSessionId(String sessionId) {
+            this.sessionId = sessionId;
+        }
+
+        public String getModel() {
+            return model;
+        }
+
+        public void setModel(String model) {
+            this.model = model;
+        }
+
+        public String getTenant() {
+            return tenant;
+        }
+
+        public void setTenant(String tenant) {
+            this.tenant = tenant;
+        }
+
+        public AdmissionScheduler.Priority getPriority() {
+            return priority;
+        }
+
+        public void setPriority(AdmissionScheduler.Priority priority) {
+            this.priority = priority;
+        }
+
+        public String getGrammar() {
+            return grammar;
+        }
+
+        public void setGrammar(String grammar) {
+            this.grammar = grammar;
+        }
+
+        public Map<String, Object> getJsonSchema() {
+            return jsonSchema;
+        }
+
+        public void setJsonSchema(Map<String, Object> jsonSchema) {
+            this.jsonSchema = jsonSchema;
+        }
+    }
+
+    // Request DTO for the batch endpoint; the sampling settings apply to every prompt
+    public static class BatchRequest {
+        private List<String> prompts;
+        private Integer maxTokens;
+        private Float temperature;
+        private String model;
+        private String tenant;                          // fair-share key for admission
+        private AdmissionScheduler.Priority priority;   // "interactive" or "batch"
+        private String grammar;                         // GBNF the output must match
+        private Map<String, Object> jsonSchema;         // or a JSON schema, converted to GBNF
+
+        public List<String> getPrompts() {
+            return prompts;
+        }
+
+        public void setPrompts(List<String> prompts) {
+            this.prompts = prompts;
+        }
+
+        public Integer getMaxTokens() {
+            return maxTokens;
+        }
+
+        public void setMaxTokens(Integer maxTokens) {
+            this.maxTokens = maxTokens;
+        }
+
+        public Float getTemperature() {
+            return temperature;
+        }
+
+        public void setTemperature(Float temperature) {
+            this.temperature = temperature;
+        }
+
+        public String getModel() {
+            return model;
+        }
+
+        public void setModel(String model) {
+            this.model = model;
+        }
+
+        public String getTenant() {
+            return tenant;
+        }
+
+        public void setTenant(String tenant) {
+            this.tenant = tenant;
+        }
+
+        public AdmissionScheduler.Priority getPriority() {
+            return priority;
+        }
+
+        public void setPriority(AdmissionScheduler.Priority priority) {
+            this.priority = priority;
+        }
+
+        public String getGrammar() {
+            return grammar;
+        }
+
+        public void setGrammar(String grammar) {
+            this.grammar = grammar;
+        }
+
+        public Map<String, Object> getJsonSchema() {
+            return jsonSchema;
+        }
+
+        public void setJsonSchema(Map<String, Object> jsonSchema) {
+            this.jsonSchema = jsonSchema;
+        }
+    }
+
+    // Request DTO for the chat endpoint; the sampling settings apply to the reply
+    public static class ChatRequest {
+        private List<ChatMessage> messages;
+        private Integer maxTokens;
+        private Float temperature;
+        private String sessionId;
+        private String model;
+        private String tenant;                          // fair-share key for admission
+        private AdmissionScheduler.Priority priority;   // "interactive" or "batch"
+        private String grammar;                         // GBNF the output must match
+        private Map<String, Object> jsonSchema;         // or a JSON schema, converted to GBNF
+
+        public List<ChatMessage> getMessages() {
+            return messages;
+        }
+
+        public void setMessages(List<ChatMessage> messages) {
+            this.messages = messages;
+        }
+
+        public Integer getMaxTokens() {
+            return maxTokens;
+        }
+
+        public void setMaxTokens(Integer maxTokens) {
+            this.maxTokens = maxTokens;
+        }
+
+        public Float getTemperature() {
+            return temperature;
+        }
+
+        public void setTemperature(Float temperature) {
+            this.temperature = temperature;
+        }
+
+        public String getSessionId() {
+            return sessionId;
+        }
+
+        public void setSessionId(String sessionId) {
+            this.sessionId = sessionId;
+        }
+
+        public String getModel() {
+            return model;
+        }
+
+        public void setModel(String model) {
+            this.model = model;
+        }
+
+        public String getTenant() {
+            return tenant;
+        }
+
+        public void setTenant(String tenant) {
+            this.tenant = tenant;
+        }
+
+        public AdmissionScheduler.Priority getPriority() {
+            return priority;
+        }
+
+        public void setPriority(AdmissionScheduler.Priority priority) {
+            this.priority = priority;
+        }
+
+        public String getGrammar() {
+            return grammar;
+        }
+
+        public void setGrammar(String grammar) {
+            this.grammar = grammar;
+        }
+
+        public Map<String, Object> getJsonSchema() {
+            return jsonSchema;
+        }
+
+        public void setJsonSchema(Map<String, Object> jsonSchema) {
+            this.jsonSchema = jsonSchema;
+        }
+    }
+
+    // Request DTO for the tokenize endpoint
+    public static class TokenizeRequest {
+        private String text;
+        private String model;
+
+        public String getText() {
+            return text;
+        }
+
+        public void setText(String text) {
+            this.text = text;
+        }
+
+        public String getModel() {
+            return model;
+        }
+
+        public void setModel(String model) {
+            this.model = model;
+        }
+    }
+
+    // Request DTO for the embed endpoint; vectors are L2-normalized unless normalize is false
+    public static class EmbedRequest {
+        private List<String> inputs;
+        private String model;
+        private Boolean normalize;
+
+        public List<String> getInputs() {
+            return inputs;
+        }
+
+        public void setInputs(List<String> inputs) {
+            this.inputs = inputs;
+        }
+
+        public String getModel() {
+            return model;
+        }
+
+        public void setModel(String model) {
+            this.model = model;
+        }
+
+        public Boolean getNormalize() {
+            return normalize;
+        }
+
+        public void setNormalize(Boolean normalize) {
+            this.normalize = normalize;
+        }
     }
 }
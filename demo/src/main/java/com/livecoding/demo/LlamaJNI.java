@@ -1,5 +1,8 @@
 package com.livecoding.demo;
 
+import java.nio.ByteBuffer;
+import java.nio.FloatBuffer;
+
 public class LlamaJNI implements LlamaJNIInterface {
     static {
         try {
@@ -24,8 +27,53 @@ public class LlamaJNI implements LlamaJNIInterface {
     // Native method declarations
     public native long loadModel(String path);
 
+    public native long loadModel(String path, LoadOptions options);
+
+    public native long acquireModel(String id, String path, LoadOptions options);
+
+    public native boolean reloadModel(String id, String path, LoadOptions options);
+
+    public native void releaseModel(long modelHandle);
+
+    public native boolean evictModel(String id);
+
+    public native void setModelMemoryBudget(long bytes);
+
+    public native String[] residentModels();
+
+    public native long[] getMetrics(String id);
+
     public native String generateText(long modelHandle, String prompt);
 
+    public native String generateText(long modelHandle, String prompt, SamplingParams params);
+
+    public native int generateText(long modelHandle, ByteBuffer prompt, int promptLength, SamplingParams params,
+            ByteBuffer output);
+
+    public native String generateTextStreaming(long modelHandle, String prompt, TokenCallback callback);
+
+    public native String generateTextStreaming(long modelHandle, String prompt, SamplingParams params,
+            TokenCallback callback);
+
+    public native String[] generateBatch(long modelHandle, String[] prompts, SamplingParams params);
+
+    public native String generateChat(long modelHandle, String[] roles, String[] contents, SamplingParams params);
+
+    public native int getEmbeddingSize(long modelHandle);
+
+    public native int embed(long modelHandle, String[] inputs, FloatBuffer output, boolean normalize);
+
+    public native int countTokens(long modelHandle, String text);
+
+    public native int[] tokenize(long modelHandle, String text);
+
+    public native int getContextSize(long modelHandle);
+
+    public native long submitText(long modelHandle, String prompt, SamplingParams params,
+            CompletionListener listener);
+
+    public native boolean cancel(long modelHandle, long jobId);
+
     public native void unloadModel(long modelHandle);
 
     // Additional methods for configuration (to be implemented later)
@@ -1,13 +1,109 @@
 package com.livecoding.demo;
 
+import java.nio.ByteBuffer;
+import java.nio.FloatBuffer;
+
 /**
  * Interface for the JNI implementation to allow for testing
  */
 public interface LlamaJNIInterface {
     long loadModel(String path);
 
+    long loadModel(String path, LoadOptions options);
+
+    /**
+     * Returns the resident model registered under id, loading it from path if needed, and
+     * holds a reference on it until releaseModel. Idle models are evicted least recently used
+     * first to stay within setModelMemoryBudget; a model in use is never freed. path and
+     * options only apply when id is not resident and has to be loaded: a resident id is
+     * returned as is, whatever path is passed. Use reloadModel to switch an id to a new file.
+     */
+    long acquireModel(String id, String path, LoadOptions options);
+
+    /**
+     * Loads path next to the model currently registered under id and then routes new
+     * acquireModel calls to it; holders of the old handle keep using it until they release
+     * it. Returns false (with the old model still registered) if the load fails.
+     */
+    boolean reloadModel(String id, String path, LoadOptions options);
+
+    void releaseModel(long modelHandle);
+
+    /** Drops the model from the registry; it is freed once its last reference is released. */
+    boolean evictModel(String id);
+
+    /** Bytes of model weights kept resident across the registry, 0 for no limit. */
+    void setModelMemoryBudget(long bytes);
+
+    /** Ids of the registered models, most recently used first. */
+    String[] residentModels();
+
+    /**
+     * Snapshot of the scheduler metrics of the model registered under id (see LlamaMetrics
+     * for the layout), or null when none is. Counters start from zero on every load.
+     */
+    long[] getMetrics(String id);
+
     String generateText(long modelHandle, String prompt);
 
+    String generateText(long modelHandle, String prompt, SamplingParams params);
+
+    /**
+     * Generates from the first promptLength bytes of a direct buffer of UTF-8 and writes the
+     * UTF-8 response to the start of the direct output buffer, stopping once it is full.
+     * params may be null. Returns the number of bytes written.
+     */
+    int generateText(long modelHandle, ByteBuffer prompt, int promptLength, SamplingParams params, ByteBuffer output);
+
+    String generateTextStreaming(long modelHandle, String prompt, TokenCallback callback);
+
+    /**
+     * Generates for all prompts at once: they are prefilled and decoded as parallel sequences
+     * sharing the scheduler's batches. Results are in prompt order, null where that prompt's
+     * generation failed. params may be null and apply to every prompt.
+     */
+    String[] generateBatch(long modelHandle, String[] prompts, SamplingParams params);
+
+    /**
+     * Formats the conversation with the model's own chat template, ending with the opening of
+     * the assistant's turn, and generates the reply. roles[i] ("system", "user" or "assistant")
+     * goes with contents[i]. params may be null.
+     */
+    String generateChat(long modelHandle, String[] roles, String[] contents, SamplingParams params);
+
+    /** Floats per vector returned by embed. */
+    int getEmbeddingSize(long modelHandle);
+
+    /**
+     * Pooled embeddings of all inputs, computed in shared batches on a dedicated embedding
+     * context. Vector i is written to output[i * size, (i + 1) * size) from index 0, where
+     * size is the return value; output must be a direct buffer in native byte order. With
+     * normalize, every vector has unit L2 length.
+     */
+    int embed(long modelHandle, String[] inputs, FloatBuffer output, boolean normalize);
+
+    /** Tokens of text as a generation prompt would be tokenized, special tokens included. */
+    int countTokens(long modelHandle, String text);
+
+    int[] tokenize(long modelHandle, String text);
+
+    /** Tokens one sequence holds, prompt and generated text together. */
+    int getContextSize(long modelHandle);
+
+    String generateTextStreaming(long modelHandle, String prompt, SamplingParams params, TokenCallback callback);
+
+    /**
+     * Queues a generation and returns its job id immediately; the listener is notified from
+     * the native completion thread. params may be null.
+     */
+    long submitText(long modelHandle, String prompt, SamplingParams params, CompletionListener listener);
+
+    /**
+     * Fails the submitted job with "Cancelled" and frees its sequence before the next decode
+     * step. Returns false when the job has already finished.
+     */
+    boolean cancel(long modelHandle, long jobId);
+
     void unloadModel(long modelHandle);
 
     String getModelInfo(long modelHandle);
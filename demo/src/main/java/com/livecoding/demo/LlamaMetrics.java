@@ -0,0 +1,216 @@
+package com.livecoding.demo;
+
+import io.micrometer.core.instrument.FunctionCounter;
+import io.micrometer.core.instrument.FunctionTimer;
+import io.micrometer.core.instrument.Gauge;
+import io.micrometer.core.instrument.MeterRegistry;
+import io.micrometer.core.instrument.binder.MeterBinder;
+import org.springframework.stereotype.Component;
+
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Publishes the native scheduler metrics of every configured model, tagged model=id, so they
+ * show up on /actuator/prometheus. All meters of a model read one snapshot that is refreshed
+ * at most once per second, so a scrape costs a single JNI call per model. A model that is not
+ * resident reads as zero and never gets loaded by a scrape; its counters restart from zero
+ * after a reload or eviction.
+ */
+@Component
+public class LlamaMetrics implements MeterBinder {
+
+    // Layout of LlamaJNI.getMetrics; times are in microseconds
+    static final int JOBS = 0;
+    static final int JOBS_FAILED = 1;
+    static final int STARTED = 2;
+    static final int QUEUE_TIME = 3;           // summed over STARTED jobs
+    static final int PREFILLED = 4;
+    static final int PREFILL_TIME = 5;         // summed over PREFILLED jobs, like the next two
+    static final int FIRST_TOKEN_TIME = 6;
+    static final int DECODE_TIME = 7;
+    static final int PROMPT_TOKENS = 8;
+    static final int PROMPT_TOKENS_REUSED = 9;
+    static final int GENERATED_TOKENS = 10;
+    static final int DECODED_TOKENS = 11;      // generated after the first token, in DECODE_TIME
+    static final int DRAFT_PROPOSED = 12;
+    static final int DRAFT_ACCEPTED = 13;
+    static final int CONTEXT_SHIFTS = 14;
+    static final int TOKENS_DISCARDED = 15;    // by context shifts and prompt truncation
+    static final int PERF_PROMPT_EVAL_TIME = 16;
+    static final int PERF_EVAL_TIME = 17;
+    static final int PERF_PROMPT_EVAL_TOKENS = 18;
+    static final int PERF_EVAL_TOKENS = 19;
+    static final int QUEUED = 20;
+    static final int ACTIVE_SEQUENCES = 21;
+    static final int SEQUENCES = 22;
+    static final int KV_CELLS_USED = 23;
+    static final int KV_CELLS = 24;
+    static final int SIZE = 25;
+
+    private static final long SNAPSHOT_TTL_NANOS = TimeUnit.SECONDS.toNanos(1);
+    private static final long[] NOT_RESIDENT = new long[SIZE];
+
+    private final LlamaService llamaService;
+    private final Map<String, Snapshot> snapshots = new ConcurrentHashMap<>();
+
+    private record Snapshot(long[] values, long takenAt) {
+    }
+
+    public LlamaMetrics(LlamaService llamaService) {
+        this.llamaService = llamaService;
+    }
+
+    @Override
+    public void bindTo(MeterRegistry registry) {
+        // Models added later through reloadModel(id, path) are not published
+        Set<String> ids;
+        try {
+            ids = llamaService.getModelIds();
+        } catch (LlamaException e) {
+            ids = Set.of(LlamaService.DEFAULT_MODEL_ID);
+        }
+        for (String id : ids) {
+            bindModel(registry, id);
+        }
+
+        bindAdmission(registry, llamaService.admission());
+
+        ResponseCache cache = llamaService.getResponseCache();
+        if (cache != null) {
+            bindResponseCache(registry, cache);
+        }
+    }
+
+    private void bindAdmission(MeterRegistry registry, AdmissionScheduler admission) {
+        Gauge.builder("llama.admission.sequences.in.use", admission, AdmissionScheduler::getInUse)
+                .description("Native sequences held by admitted requests")
+                .register(registry);
+        Gauge.builder("llama.admission.sequences", admission, AdmissionScheduler::getCapacity)
+                .description("Native sequences admission hands out")
+                .register(registry);
+        for (AdmissionScheduler.Priority priority : AdmissionScheduler.Priority.values()) {
+            Gauge.builder("llama.admission.queued", admission, scheduler -> scheduler.getQueued(priority))
+                    .tag("priority", priority.name().toLowerCase())
+                    .description("Requests waiting for admission")
+                    .register(registry);
+        }
+        FunctionCounter.builder("llama.admission.rejected", admission, AdmissionScheduler::getRejected)
+                .description("Requests answered 429 because the queue of their class was full")
+                .register(registry);
+    }
+
+    private void bindResponseCache(MeterRegistry registry, ResponseCache cache) {
+        FunctionCounter.builder("llama.response.cache.gets", cache, ResponseCache::hits)
+                .tag("result", "hit")
+                .description("Generation requests answered from the response cache")
+                .register(registry);
+        FunctionCounter.builder("llama.response.cache.gets", cache, ResponseCache::misses)
+                .tag("result", "miss")
+                .description("Cacheable generation requests that had to run")
+                .register(registry);
+        FunctionCounter.builder("llama.response.cache.evictions", cache, ResponseCache::evictions)
+                .description("Responses dropped to stay within llama.response.cache.mb")
+                .register(registry);
+        Gauge.builder("llama.response.cache.size", cache, ResponseCache::size)
+                .description("Responses held by the cache")
+                .register(registry);
+        Gauge.builder("llama.response.cache.bytes", cache, ResponseCache::bytes)
+                .baseUnit("bytes")
+                .description("Estimated memory held by cached responses")
+                .register(registry);
+    }
+
+    private void bindModel(MeterRegistry registry, String id) {
+        counter(registry, id, "llama.jobs", JOBS, "Generation jobs completed, including failed ones");
+        counter(registry, id, "llama.jobs.failed", JOBS_FAILED, "Generation jobs that completed with an error");
+
+        timer(registry, id, "llama.queue.wait", STARTED, QUEUE_TIME,
+                "Time from submission until a sequence picked the job up");
+        timer(registry, id, "llama.prefill", PREFILLED, PREFILL_TIME,
+                "Time from sequence start until the first token");
+        timer(registry, id, "llama.time.to.first.token", PREFILLED, FIRST_TOKEN_TIME,
+                "Time from submission until the first token");
+        timer(registry, id, "llama.decode", PREFILLED, DECODE_TIME,
+                "Time from the first token until the job completed");
+
+        counter(registry, id, "llama.prompt.tokens", PROMPT_TOKENS, "Prompt tokens evaluated");
+        counter(registry, id, "llama.prompt.tokens.reused", PROMPT_TOKENS_REUSED,
+                "Prompt tokens served from the prefix cache or a session instead");
+        counter(registry, id, "llama.generated.tokens", GENERATED_TOKENS, "Tokens generated");
+        counter(registry, id, "llama.decode.tokens", DECODED_TOKENS,
+                "Tokens generated after the first; rate over llama.decode time gives tokens/s");
+        counter(registry, id, "llama.draft.proposed", DRAFT_PROPOSED, "Draft tokens checked by the main model");
+        counter(registry, id, "llama.draft.accepted", DRAFT_ACCEPTED, "Draft tokens the main model kept");
+        counter(registry, id, "llama.context.shifts", CONTEXT_SHIFTS,
+                "Times a full window dropped the middle of its KV cache instead of stopping");
+        counter(registry, id, "llama.context.discarded.tokens", TOKENS_DISCARDED,
+                "Tokens dropped by context shifts and prompt truncation");
+
+        // llama_perf_context totals over the model's contexts
+        seconds(registry, id, "llama.context.prompt.eval.time", PERF_PROMPT_EVAL_TIME,
+                "Time the contexts spent evaluating prompt batches");
+        seconds(registry, id, "llama.context.eval.time", PERF_EVAL_TIME,
+                "Time the contexts spent evaluating generated tokens");
+        counter(registry, id, "llama.context.prompt.eval.tokens", PERF_PROMPT_EVAL_TOKENS,
+                "Prompt tokens the contexts evaluated");
+        counter(registry, id, "llama.context.eval.tokens", PERF_EVAL_TOKENS,
+                "Generated tokens the contexts evaluated");
+
+        gauge(registry, id, "llama.queue.depth", QUEUED, "Jobs waiting for a sequence");
+        gauge(registry, id, "llama.sequences.active", ACTIVE_SEQUENCES, "Sequences holding a job");
+        gauge(registry, id, "llama.sequences", SEQUENCES, "Sequences across the context pool");
+        gauge(registry, id, "llama.kv.cells.used", KV_CELLS_USED,
+                "KV cache cells held by sequences, including cached prefixes");
+        gauge(registry, id, "llama.kv.cells", KV_CELLS, "KV cache cells across the context pool");
+    }
+
+    private void counter(MeterRegistry registry, String id, String name, int index, String description) {
+        FunctionCounter.builder(name, this, metrics -> metrics.value(id, index))
+                .tag("model", id)
+                .description(description)
+                .register(registry);
+    }
+
+    private void seconds(MeterRegistry registry, String id, String name, int index, String description) {
+        FunctionCounter.builder(name, this, metrics -> metrics.value(id, index) / 1_000_000.0)
+                .tag("model", id)
+                .baseUnit("seconds")
+                .description(description)
+                .register(registry);
+    }
+
+    private void timer(MeterRegistry registry, String id, String name, int countIndex, int timeIndex,
+            String description) {
+        FunctionTimer.builder(name, this, metrics -> metrics.value(id, countIndex),
+                        metrics -> metrics.value(id, timeIndex), TimeUnit.MICROSECONDS)
+                .tag("model", id)
+                .description(description)
+                .register(registry);
+    }
+
+    private void gauge(MeterRegistry registry, String id, String name, int index, String description) {
+        Gauge.builder(name, this, metrics -> metrics.value(id, index))
+                .tag("model", id)
+                .description(description)
+                .register(registry);
+    }
+
+    long value(String id, int index) {
+        long now = System.nanoTime();
+        Snapshot snapshot = snapshots.get(id);
+        if (snapshot == null || now - snapshot.takenAt() > SNAPSHOT_TTL_NANOS) {
+            long[] values;
+            try {
+                values = llamaService.getMetrics(id);
+            } catch (RuntimeException e) {
+                values = null;
+            }
+            snapshot = new Snapshot(values != null && values.length >= SIZE ? values : NOT_RESIDENT, now);
+            snapshots.put(id, snapshot);
+        }
+        return snapshot.values()[index];
+    }
+}
@@ -0,0 +1,12 @@
+package com.livecoding.demo;
+
+/**
+ * Thrown when admission turns a request away because too many are already queued. Callers
+ * should retry later; the controller answers 429.
+ */
+public class LlamaOverloadedException extends LlamaException {
+
+    public LlamaOverloadedException(String message) {
+        super(message);
+    }
+}
@@ -5,29 +5,193 @@ import org.springframework.stereotype.Service;
 import jakarta.annotation.PreDestroy;
 import jakarta.annotation.PostConstruct;
 
-import java.util.concurrent.locks.ReentrantReadWriteLock;
-import java.util.concurrent.Semaphore;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ForkJoinPool;
 import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
 import java.util.regex.Pattern;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
 
 @Service
 public class LlamaService {
+    /** Model id of llama.model.path, used when a request does not name one. */
+    public static final String DEFAULT_MODEL_ID = "default";
+
     private final LlamaJNIInterface llamaJNI;
-    private volatile long modelHandle = 0;
-    private final ReentrantReadWriteLock modelLock = new ReentrantReadWriteLock();
-    private final Semaphore generateSemaphore = new Semaphore(5); // Limit concurrent generations
+    private volatile Map<String, String> modelPaths;
+    private volatile boolean registryConfigured;
+    private final Object reloadLock = new Object();
+    private volatile AdmissionScheduler admission;
+    private final AtomicInteger pendingAsync = new AtomicInteger();
 
     @Value("${llama.model.path:Llama-3.2-3B-Instruct-Q3_K_L.gguf}")
     private String modelPath;
 
+    // Further models requests can pick by id: "code=/models/code.gguf,chat=/models/chat.gguf"
+    @Value("${llama.models:}")
+    private String models;
+
+    // Weights kept resident across all models; idle ones are evicted least recently used first
+    @Value("${llama.model.memory.budget.mb:0}")
+    private long modelMemoryBudgetMb;
+
     @Value("${llama.max.prompt.length:4000}")
     private int maxPromptLength;
 
+    // Checked by tokenizing before admission; 0 leaves the limit to the native context size,
+    // which is enforced either way
+    @Value("${llama.max.prompt.tokens:0}")
+    private int maxPromptTokens;
+
+    // How long a request may wait for admission; batch requests yield to interactive ones and
+    // get the longer timeout
     @Value("${llama.generation.timeout.seconds:30}")
     private int generationTimeoutSeconds;
 
+    @Value("${llama.admission.batch.timeout.seconds:300}")
+    private int batchTimeoutSeconds = 300;
+
+    // Sequences admitted at once; 0 = every sequence of the context pool
+    @Value("${llama.admission.sequences:0}")
+    private int admissionSequences;
+
+    // Fraction of those batch requests may hold, so interactive ones never wait for all of them
+    @Value("${llama.admission.batch.share:0.5}")
+    private double batchShare = 0.5;
+
+    // Waiting requests per priority class; more are answered 429 at once
+    @Value("${llama.admission.max.queued:32}")
+    private int admissionMaxQueued = 32;
+
+    // Enforced by the native scheduler once a request runs, unlike the admission timeouts above
+    @Value("${llama.generation.deadline.seconds:0}")
+    private int generationDeadlineSeconds;
+
+    // Async jobs are queued natively without holding a thread or permit; this bounds the queue
+    @Value("${llama.async.max.pending:256}")
+    private int maxPendingAsync = 256;
+
+    // Prompts per generateBatch call, admitted as one batch request holding a sequence per prompt
+    @Value("${llama.batch.max.prompts:64}")
+    private int maxBatchPrompts = 64;
+
+    @Value("${llama.embed.max.inputs:256}")
+    private int maxEmbedInputs = 256;
+
+    // Text of repeated deterministic requests; 0 MB disables the cache
+    @Value("${llama.response.cache.mb:0}")
+    private long responseCacheMb;
+
+    @Value("${llama.response.cache.ttl.seconds:3600}")
+    private long responseCacheTtlSeconds = 3600;
+
+    // Native sampling rewinds its seeded RNG per job, so seeded requests replay exactly too;
+    // this limits caching to temperature 0
+    @Value("${llama.response.cache.greedy.only:false}")
+    private boolean responseCacheGreedyOnly;
+
+    private volatile ResponseCache responseCache;
+
+    // Native load settings; 0 keeps the native default
+    @Value("${llama.context.length:0}")
+    private int contextLength;
+
+    @Value("${llama.context.pool.size:0}")
+    private int contexts;
+
+    @Value("${llama.sequences.per.context:0}")
+    private int sequencesPerContext;
+
+    @Value("${llama.threads:0}")
+    private int threads;
+
+    @Value("${llama.threads.batch:0}")
+    private int threadsBatch;
+
+    // Core set per pooled context ("auto" splits the NUMA nodes' cores); empty leaves threads unpinned
+    @Value("${llama.cpu.sets:}")
+    private String cpuSets;
+
+    @Value("${llama.numa:}")
+    private String numa;
+
+    @Value("${llama.batch.size:0}")
+    private int batchSize;
+
+    @Value("${llama.ubatch.size:0}")
+    private int ubatchSize;
+
+    @Value("${llama.prefill.chunk:0}")
+    private int prefillChunk;
+
+    @Value("${llama.gpu.layers:0}")
+    private int gpuLayers;
+
+    @Value("${llama.flash.attention:auto}")
+    private String flashAttention;
+
+    @Value("${llama.use.mmap:true}")
+    private boolean useMmap = true;
+
+    @Value("${llama.use.mlock:false}")
+    private boolean useMlock;
+
+    // Speculative decoding: empty path disables it
+    @Value("${llama.draft.model.path:}")
+    private String draftModelPath;
+
+    @Value("${llama.draft.tokens:0}")
+    private int draftTokens;
+
+    // KV state of conversations between turns (requests with a sessionId)
+    @Value("${llama.session.memory.mb:0}")
+    private int sessionMemoryMb;
+
+    @Value("${llama.session.disk.mb:0}")
+    private int sessionDiskMb;
+
+    @Value("${llama.session.dir:}")
+    private String sessionDir;
+
+    // Context overflow: shift the KV cache of a full window (and cut the middle of prompts
+    // that do not fit) instead of stopping or rejecting
+    @Value("${llama.context.shift:false}")
+    private boolean contextShift;
+
+    @Value("${llama.context.keep.tokens:0}")
+    private int keepTokens;
+
+    // Load the default model in the background at startup instead of on the first request
+    @Value("${llama.warmup.enabled:false}")
+    private boolean warmupEnabled;
+
+    /** Progress of the startup warmup, reported on /llama/status. */
+    public enum WarmupState { DISABLED, WARMING, READY, FAILED }
+
+    private volatile WarmupState warmupState = WarmupState.DISABLED;
+    private volatile String warmupError;
+
     // Pattern to remove potentially harmful content
     private static final Pattern SANITIZE_PATTERN = Pattern.compile("[\\x00-\\x08\\x0B\\x0C\\x0E-\\x1F\\x7F]");
+    private static final Pattern BLANK_LINES_PATTERN = Pattern.compile("\\n{3,}");
+
+    // Obvious injection attempts, matched in one pass without lowercasing a copy of the prompt.
+    // The markers are ASCII, so ASCII case folding finds exactly what toLowerCase would.
+    private static final Pattern SUSPICIOUS_PATTERN = Pattern.compile(Stream.of(
+            "system(", "exec(", "eval(", "\\x", "\\.dll", "\\.exe", "cmd.exe", "powershell")
+            .map(Pattern::quote).collect(Collectors.joining("|")), Pattern.CASE_INSENSITIVE);
 
     // Constructor for dependency injection (allows for testing)
     public LlamaService(LlamaJNIInterface llamaJNI) {
@@ -41,39 +205,533 @@ public class LlamaService {
 
     @PostConstruct
     public void initialize() {
-        // Don't load model at startup - load on first request instead
-        // This prevents startup failures if model file is not available
+        if (responseCacheMb > 0) {
+            responseCache = new ResponseCache(responseCacheMb * 1024 * 1024, responseCacheTtlSeconds);
+        }
+
+        // Without warmup the model is loaded on the first request. Either way a missing model
+        // file does not fail startup.
+        if (warmupEnabled) {
+            warmupState = WarmupState.WARMING;
+            Thread thread = new Thread(this::warmup, "llama-warmup");
+            thread.setDaemon(true);
+            thread.start();
+        }
+    }
+
+    // The load options carry the warmup flag, so acquiring the model also pre-faults it and
+    // runs a first decode in every context
+    void warmup() {
+        try {
+            long handle = acquireModel(null);
+            llamaJNI.releaseModel(handle);
+            warmupState = WarmupState.READY;
+        } catch (LlamaException e) {
+            warmupError = e.getMessage();
+            warmupState = WarmupState.FAILED;
+        }
+    }
+
+    public WarmupState getWarmupState() {
+        return warmupState;
+    }
+
+    public String getWarmupError() {
+        return warmupError;
+    }
+
+    /** False while the startup warmup runs or after it failed; lazy loading counts as ready. */
+    public boolean isReady() {
+        WarmupState state = warmupState;
+        return state == WarmupState.DISABLED || state == WarmupState.READY;
     }
 
     public String generateText(String prompt) throws LlamaException {
-        // Input validation
-        validatePrompt(prompt);
+        return generate(prompt, null, null, llamaJNI::generateText);
+    }
 
-        // Sanitize input
-        String sanitizedPrompt = sanitizePrompt(prompt);
+    public String generateText(String prompt, SamplingParams requested) throws LlamaException {
+        if (requested == null) {
+            return generateText(prompt);
+        }
+        SamplingParams params = prepareSamplingParams(requested);
+        return generate(prompt, params, null, (handle, sanitizedPrompt) ->
+                llamaJNI.generateText(handle, sanitizedPrompt, params));
+    }
+
+    public String generateTextStreaming(String prompt, TokenCallback callback) throws LlamaException {
+        return generateTextStreaming(prompt, null, callback);
+    }
+
+    public String generateTextStreaming(String prompt, SamplingParams requested, TokenCallback callback)
+            throws LlamaException {
+        if (callback == null) {
+            throw new LlamaException("Callback cannot be null");
+        }
+        if (requested == null) {
+            return generate(prompt, null, callback, (handle, sanitizedPrompt) ->
+                    llamaJNI.generateTextStreaming(handle, sanitizedPrompt, callback));
+        }
+        SamplingParams params = prepareSamplingParams(requested);
+        return generate(prompt, params, callback, (handle, sanitizedPrompt) ->
+                llamaJNI.generateTextStreaming(handle, sanitizedPrompt, params, callback));
+    }
 
+    /**
+     * Generates the assistant's reply to the conversation. Messages are validated and sanitized
+     * one by one and formatted natively with the model's chat template, so a conversation that
+     * grows turn by turn keeps hitting the prefix cache. llama.max.prompt.length bounds the
+     * contents together; llama.max.prompt.tokens is not checked, as only the native side sees
+     * the formatted prompt, but the context size still is.
+     */
+    public String generateChat(List<ChatMessage> messages, SamplingParams requested) throws LlamaException {
+        if (messages == null || messages.isEmpty()) {
+            throw new LlamaException("Messages cannot be empty");
+        }
+
+        if (messages.size() > ChatMessage.MAX_MESSAGES) {
+            throw new LlamaException("Too many messages. Maximum: " + ChatMessage.MAX_MESSAGES);
+        }
+
+        SamplingParams params = prepareSamplingParams(requested);
+        String[] roles = new String[messages.size()];
+        String[] contents = new String[messages.size()];
+        int length = 0;
+        boolean empty = true;
+        for (int i = 0; i < roles.length; i++) {
+            ChatMessage message = messages.get(i);
+            if (message == null || message.role() == null || !ChatMessage.ROLES.contains(message.role())) {
+                throw new LlamaException("Message role must be one of " + ChatMessage.ROLES);
+            }
+            if (message.content() == null) {
+                throw new LlamaException("Message content cannot be null");
+            }
+            length += message.content().length();
+            if (length > maxPromptLength) {
+                throw new LlamaException("Conversation too long. Maximum length: " + maxPromptLength + " characters");
+            }
+            if (containsSuspiciousContent(message.content())) {
+                throw new LlamaException("Prompt contains potentially harmful content");
+            }
+            roles[i] = message.role();
+            contents[i] = sanitizePrompt(message.content());
+            empty &= contents[i].isEmpty();
+        }
+        if (empty) {
+            throw new LlamaException("Messages cannot be empty");
+        }
+
+        // Sanitized text holds no NUL, so joining on it keeps distinct conversations apart
+        ResponseCache.Key key = responseCache != null ? cacheKey(chatCacheText(roles, contents), params) : null;
+        if (key != null) {
+            String cached = responseCache.get(key);
+            if (cached != null) {
+                return cached;
+            }
+        }
+
+        String text = withModel(params, AdmissionScheduler.Priority.INTERACTIVE, 1, estimateCost(length, -1, params),
+                handle -> llamaJNI.generateChat(handle, roles, contents, params));
+        if (key != null && text != null) {
+            responseCache.put(key, text);
+        }
+        return text;
+    }
+
+    private static String chatCacheText(String[] roles, String[] contents) {
+        StringBuilder text = new StringBuilder("\0chat");
+        for (int i = 0; i < roles.length; i++) {
+            text.append('\0').append(roles[i]).append('\0').append(contents[i]);
+        }
+        return text.toString();
+    }
+
+    /**
+     * Generates for independent prompts in one native call, decoded side by side. Results are
+     * in prompt order, null where that prompt's generation failed; an invalid prompt fails the
+     * whole batch before anything runs. Sessions are not supported here.
+     */
+    public List<String> generateBatch(List<String> prompts, SamplingParams requested) throws LlamaException {
+        if (prompts == null || prompts.isEmpty()) {
+            throw new LlamaException("Prompts cannot be empty");
+        }
+
+        if (prompts.size() > maxBatchPrompts) {
+            throw new LlamaException("Too many prompts. Maximum per batch: " + maxBatchPrompts);
+        }
+
+        SamplingParams params = prepareSamplingParams(requested);
+        if (params != null && params.getSessionId() != null) {
+            throw new LlamaException("sessionId is not supported for batches");
+        }
+
+        String[] sanitizedPrompts = new String[prompts.size()];
+        long cost = 0;
+        for (int i = 0; i < sanitizedPrompts.length; i++) {
+            validatePrompt(prompts.get(i));
+            sanitizedPrompts[i] = sanitizePrompt(prompts.get(i));
+            int promptTokens = checkPromptTokens(sanitizedPrompts[i], params);
+            cost += estimateCost(sanitizedPrompts[i].length(), promptTokens, params);
+        }
+
+        String[] results = withModel(params, AdmissionScheduler.Priority.BATCH, sanitizedPrompts.length, cost,
+                handle -> llamaJNI.generateBatch(handle, sanitizedPrompts, params));
+        if (results == null || results.length != sanitizedPrompts.length) {
+            throw new LlamaException("Generation failed: incomplete batch result");
+        }
+        return Arrays.asList(results);
+    }
+
+    /**
+     * Tokens the prompt takes once sanitized, as generation would tokenize it. Only the
+     * tokenizer runs, so it does not wait for admission.
+     */
+    public int countTokens(String text, String modelId) throws LlamaException {
+        String sanitizedText = prepareTokenizerInput(text);
+        return withTokenizer(modelId, handle -> llamaJNI.countTokens(handle, sanitizedText));
+    }
+
+    /** Token ids of the sanitized prompt, e.g. for truncating it to a token budget. */
+    public int[] tokenize(String text, String modelId) throws LlamaException {
+        String sanitizedText = prepareTokenizerInput(text);
+        return withTokenizer(modelId, handle -> llamaJNI.tokenize(handle, sanitizedText));
+    }
+
+    /** Tokens one sequence of the model holds, prompt and response together. */
+    public int getContextSize(String modelId) throws LlamaException {
+        return withTokenizer(modelId, llamaJNI::getContextSize);
+    }
+
+    private String prepareTokenizerInput(String text) throws LlamaException {
+        if (text == null) {
+            throw new LlamaException("Text cannot be null");
+        }
+        if (text.length() > maxPromptLength) {
+            throw new LlamaException("Text too long. Maximum length: " + maxPromptLength + " characters");
+        }
+        return sanitizePrompt(text);
+    }
+
+    // Returns the prompt's token count, or -1 when no limit is configured and it was not counted
+    private int checkPromptTokens(String sanitizedPrompt, SamplingParams params) throws LlamaException {
+        if (maxPromptTokens <= 0) {
+            return -1;
+        }
+        String modelId = params != null ? params.getModel() : null;
+        int tokens = withTokenizer(modelId, handle -> llamaJNI.countTokens(handle, sanitizedPrompt));
+        if (tokens > maxPromptTokens) {
+            throw new LlamaException("Prompt too long: " + tokens + " tokens. Maximum: " + maxPromptTokens);
+        }
+        return tokens;
+    }
+
+    // Admission cost in tokens: the prompt (about 4 characters per token unless counted) plus
+    // everything the request may generate
+    private static long estimateCost(int promptLength, int promptTokens, SamplingParams params) {
+        long prompt = promptTokens >= 0 ? promptTokens : promptLength / 4 + 1;
+        return prompt + (params != null ? params.getMaxTokens() : SamplingParams.DEFAULT_MAX_TOKENS);
+    }
+
+    private static long embedCost(String[] inputs) {
+        long cost = 0;
+        for (String input : inputs) {
+            cost += input.length() / 4 + 1;
+        }
+        return cost;
+    }
+
+    private static SamplingParams embedParams(String modelId) {
+        SamplingParams params = new SamplingParams();
+        params.setModel(modelId);
+        return params;
+    }
+
+    /**
+     * Zero-copy embeddings for in-process callers: vector i is written to output from index
+     * i * size, where size (the return value) is the model's embedding width. output must be
+     * a direct buffer in native byte order with room for every vector.
+     */
+    public int embed(List<String> inputs, String modelId, boolean normalize, FloatBuffer output)
+            throws LlamaException {
+        if (output == null || !output.isDirect() || output.order() != ByteOrder.nativeOrder()) {
+            throw new LlamaException("Output must be a direct FloatBuffer in native byte order");
+        }
+        String[] sanitizedInputs = prepareEmbedInputs(inputs, modelId);
+        return withModel(embedParams(modelId), AdmissionScheduler.Priority.INTERACTIVE, 1,
+                embedCost(sanitizedInputs), handle -> llamaJNI.embed(handle, sanitizedInputs, output, normalize));
+    }
+
+    /** Embeddings as arrays, for callers that serialize them anyway. */
+    public List<float[]> embed(List<String> inputs, String modelId, boolean normalize) throws LlamaException {
+        String[] sanitizedInputs = prepareEmbedInputs(inputs, modelId);
+        return withModel(embedParams(modelId), AdmissionScheduler.Priority.INTERACTIVE, 1,
+                embedCost(sanitizedInputs), handle -> {
+            int size = llamaJNI.getEmbeddingSize(handle);
+            FloatBuffer output = ByteBuffer.allocateDirect(sanitizedInputs.length * size * Float.BYTES)
+                    .order(ByteOrder.nativeOrder())
+                    .asFloatBuffer();
+            llamaJNI.embed(handle, sanitizedInputs, output, normalize);
+
+            List<float[]> vectors = new ArrayList<>(sanitizedInputs.length);
+            for (int i = 0; i < sanitizedInputs.length; i++) {
+                float[] vector = new float[size];
+                output.get(i * size, vector);
+                vectors.add(vector);
+            }
+            return vectors;
+        });
+    }
+
+    private String[] prepareEmbedInputs(List<String> inputs, String modelId) throws LlamaException {
+        if (inputs == null || inputs.isEmpty()) {
+            throw new LlamaException("Inputs cannot be empty");
+        }
+
+        if (inputs.size() > maxEmbedInputs) {
+            throw new LlamaException("Too many inputs. Maximum per request: " + maxEmbedInputs);
+        }
+
+        if (modelId != null && !modelPaths().containsKey(modelId)) {
+            throw new LlamaException("Unknown model: " + modelId);
+        }
+
+        String[] sanitizedInputs = new String[inputs.size()];
+        for (int i = 0; i < sanitizedInputs.length; i++) {
+            validatePrompt(inputs.get(i));
+            sanitizedInputs[i] = sanitizePrompt(inputs.get(i));
+        }
+        return sanitizedInputs;
+    }
+
+    /** The response cache, or null when llama.response.cache.mb is 0. */
+    ResponseCache getResponseCache() {
+        return responseCache;
+    }
+
+    /** Sequences admitted and requests waiting per priority class, for the status endpoint. */
+    public Map<String, Object> getAdmissionStatus() {
+        AdmissionScheduler scheduler = admission();
+        Map<String, Object> status = new LinkedHashMap<>();
+        status.put("sequences", scheduler.getCapacity());
+        status.put("in_use", scheduler.getInUse());
+        status.put("queued_interactive", scheduler.getQueued(AdmissionScheduler.Priority.INTERACTIVE));
+        status.put("queued_batch", scheduler.getQueued(AdmissionScheduler.Priority.BATCH));
+        status.put("rejected", scheduler.getRejected());
+        return status;
+    }
+
+    public int getMaxBatchPrompts() {
+        return maxBatchPrompts;
+    }
+
+    public CompletableFuture<String> generateTextAsync(String prompt) {
+        return generateTextAsync(prompt, null);
+    }
+
+    /**
+     * Queues the generation in the native scheduler and returns at once. The future is
+     * completed off the native completion thread; failures complete it with LlamaException.
+     * Cancelling the future cancels the native job as well.
+     */
+    public CompletableFuture<String> generateTextAsync(String prompt, SamplingParams requested) {
+        CompletableFuture<String> future = new CompletableFuture<>();
         try {
-            // Acquire generation permit (limit concurrent generations)
-            if (!generateSemaphore.tryAcquire(generationTimeoutSeconds, TimeUnit.SECONDS)) {
-                throw new LlamaException("Generation timeout: too many concurrent requests");
+            validatePrompt(prompt);
+            SamplingParams params = prepareSamplingParams(requested);
+            String sanitizedPrompt = sanitizePrompt(prompt);
+
+            ResponseCache.Key key = cacheKey(sanitizedPrompt, params);
+            if (key != null) {
+                String cached = responseCache.get(key);
+                if (cached != null) {
+                    future.complete(cached);
+                    return future;
+                }
+                ResponseCache cache = responseCache;
+                future.thenAccept(text -> {
+                    if (text != null) {
+                        cache.put(key, text);
+                    }
+                });
             }
+            checkPromptTokens(sanitizedPrompt, params);
 
-            try {
-                // Ensure model is loaded
-                loadModelIfNeeded();
+            if (pendingAsync.incrementAndGet() > maxPendingAsync) {
+                pendingAsync.decrementAndGet();
+                throw new LlamaException("Too many pending requests");
+            }
 
-                // Use read lock for generation (allows multiple concurrent reads)
-                modelLock.readLock().lock();
+            try {
+                // No admission: submitting only queues the job, the pending cap bounds the queue
+                FutureListener listener = new FutureListener(future,
+                        acquireModel(params != null ? params.getModel() : null));
+                long jobId;
                 try {
-                    if (modelHandle == 0) {
-                        throw new LlamaException("Model not loaded");
+                    jobId = llamaJNI.submitText(listener.handle, sanitizedPrompt, params, listener);
+                } catch (RuntimeException e) {
+                    listener.release();
+                    throw e;
+                }
+                future.whenComplete((text, error) -> {
+                    if (future.isCancelled()) {
+                        listener.cancel(jobId);
                     }
-                    return llamaJNI.generateText(modelHandle, sanitizedPrompt);
-                } finally {
-                    modelLock.readLock().unlock();
+                });
+            } catch (LlamaException e) {
+                pendingAsync.decrementAndGet();
+                throw e;
+            } catch (RuntimeException e) {
+                pendingAsync.decrementAndGet();
+                throw new LlamaException("Generation failed: " + e.getMessage(), e);
+            }
+        } catch (LlamaException e) {
+            future.completeExceptionally(e);
+        }
+        return future;
+    }
+
+    // Moves completion off the native thread so dependent stages never run on it. The model
+    // reference is held until the native job finishes, so a cancel never reaches a freed model.
+    private final class FutureListener implements CompletionListener {
+        private final CompletableFuture<String> future;
+        private final long handle;
+        private boolean released; // guarded by this
+
+        FutureListener(CompletableFuture<String> future, long handle) {
+            this.future = future;
+            this.handle = handle;
+        }
+
+        @Override
+        public void onComplete(String text) {
+            pendingAsync.decrementAndGet();
+            ForkJoinPool.commonPool().execute(() -> {
+                release();
+                future.complete(text);
+            });
+        }
+
+        @Override
+        public void onError(String message) {
+            pendingAsync.decrementAndGet();
+            ForkJoinPool.commonPool().execute(() -> {
+                release();
+                future.completeExceptionally(new LlamaException("Generation failed: " + message));
+            });
+        }
+
+        // Cancelling the future abandons the request, so free its native sequence right away
+        synchronized void cancel(long jobId) {
+            if (!released) {
+                llamaJNI.cancel(handle, jobId);
+            }
+        }
+
+        // Never on the native completion thread: the last release of an evicted model joins it
+        synchronized void release() {
+            if (!released) {
+                released = true;
+                llamaJNI.releaseModel(handle);
+            }
+        }
+    }
+
+    /**
+     * Zero-copy variant for in-process callers holding UTF-8 bytes: the native side tokenizes
+     * straight from the direct prompt buffer and writes the response into the direct output
+     * buffer (from index 0). The bytes are not run through prompt sanitization.
+     * Returns the number of response bytes written.
+     */
+    public int generateText(ByteBuffer prompt, int promptLength, SamplingParams requested, ByteBuffer output)
+            throws LlamaException {
+        if (prompt == null || !prompt.isDirect() || output == null || !output.isDirect()) {
+            throw new LlamaException("Prompt and output must be direct ByteBuffers");
+        }
+
+        if (promptLength <= 0 || promptLength > prompt.capacity()) {
+            throw new LlamaException("Invalid prompt length");
+        }
+
+        if (promptLength > maxPromptLength) {
+            throw new LlamaException("Prompt too long. Maximum length: " + maxPromptLength + " bytes");
+        }
+
+        SamplingParams params = prepareSamplingParams(requested);
+        return withModel(params, AdmissionScheduler.Priority.INTERACTIVE, 1, estimateCost(promptLength, -1, params),
+                handle -> llamaJNI.generateText(handle, prompt, promptLength, params, output));
+    }
+
+    @FunctionalInterface
+    private interface NativeGeneration {
+        String run(long modelHandle, String prompt);
+    }
+
+    @FunctionalInterface
+    private interface NativeCall<T> {
+        T run(long modelHandle);
+    }
+
+    // A cache hit is handed to the streaming callback as a single piece
+    private String generate(String prompt, SamplingParams params, TokenCallback callback,
+            NativeGeneration generation) throws LlamaException {
+        // Input validation
+        validatePrompt(prompt);
+
+        // Sanitize input
+        String sanitizedPrompt = sanitizePrompt(prompt);
+
+        ResponseCache.Key key = cacheKey(sanitizedPrompt, params);
+        if (key != null) {
+            String cached = responseCache.get(key);
+            if (cached != null) {
+                if (callback != null) {
+                    callback.onToken(cached);
                 }
+                return cached;
+            }
+        }
+
+        int promptTokens = checkPromptTokens(sanitizedPrompt, params);
+        String text = withModel(params, AdmissionScheduler.Priority.INTERACTIVE, 1,
+                estimateCost(sanitizedPrompt.length(), promptTokens, params),
+                handle -> generation.run(handle, sanitizedPrompt));
+        if (key != null && text != null) {
+            responseCache.put(key, text);
+        }
+        return text;
+    }
+
+    // Null when the request must run: no cache, a session (its KV state moves on every turn)
+    // or sampling that is not meant to repeat
+    private ResponseCache.Key cacheKey(String sanitizedPrompt, SamplingParams params) {
+        ResponseCache cache = responseCache;
+        if (cache == null || (params != null && params.getSessionId() != null)) {
+            return null;
+        }
+        float temperature = params != null ? params.getTemperature() : SamplingParams.DEFAULT_TEMPERATURE;
+        if (responseCacheGreedyOnly && temperature != 0.0f) {
+            return null;
+        }
+        String modelId = params != null && params.getModel() != null ? params.getModel() : DEFAULT_MODEL_ID;
+        return cache.key(modelId, sanitizedPrompt, params);
+    }
+
+    // Runs call once admitted; sequences and cost size the request for the scheduler, and params
+    // (may be null) names the model, tenant and priority
+    private <T> T withModel(SamplingParams params, AdmissionScheduler.Priority defaultPriority, int sequences,
+            long cost, NativeCall<T> call) throws LlamaException {
+        AdmissionScheduler.Priority priority = params != null && params.getPriority() != null
+                ? params.getPriority() : defaultPriority;
+        int timeoutSeconds = priority == AdmissionScheduler.Priority.BATCH ? batchTimeoutSeconds : generationTimeoutSeconds;
+        try (AdmissionScheduler.Permit permit = admission().acquire(params != null ? params.getTenant() : null,
+                priority, sequences, cost, timeoutSeconds, TimeUnit.SECONDS)) {
+            // Loads the model if it is not resident. The reference keeps this model alive
+            // through a reload or eviction, so no lock is needed around the call.
+            long handle = acquireModel(params != null ? params.getModel() : null);
+            try {
+                return call.run(handle);
             } finally {
-                generateSemaphore.release();
+                llamaJNI.releaseModel(handle);
             }
         } catch (InterruptedException e) {
             Thread.currentThread().interrupt();
@@ -86,27 +744,159 @@ public class LlamaService {
         }
     }
 
-    private void loadModelIfNeeded() throws LlamaException {
-        if (modelHandle == 0) {
-            modelLock.writeLock().lock();
-            try {
-                // Double-check pattern
-                if (modelHandle == 0) {
-                    try {
-                        modelHandle = llamaJNI.loadModel(modelPath);
-                        if (modelHandle == 0) {
-                            throw new LlamaException("Failed to load model from path: " + modelPath);
-                        }
-                    } catch (Exception e) {
-                        throw new LlamaException("Failed to load model: " + e.getMessage(), e);
+    // Like withModel without admission, for calls that do not touch a context
+    private <T> T withTokenizer(String modelId, NativeCall<T> call) throws LlamaException {
+        long handle = acquireModel(modelId);
+        try {
+            return call.run(handle);
+        } catch (RuntimeException e) {
+            throw new LlamaException("Tokenization failed: " + e.getMessage(), e);
+        } finally {
+            llamaJNI.releaseModel(handle);
+        }
+    }
+
+    // Sized from the pool settings on first use: every model's engine has that many sequences
+    AdmissionScheduler admission() {
+        AdmissionScheduler scheduler = admission;
+        if (scheduler == null) {
+            synchronized (this) {
+                scheduler = admission;
+                if (scheduler == null) {
+                    int capacity = admissionSequences > 0 ? admissionSequences
+                            : (contexts > 0 ? contexts : LoadOptions.DEFAULT_CONTEXTS)
+                                    * (sequencesPerContext > 0 ? sequencesPerContext : LoadOptions.DEFAULT_SEQUENCES_PER_CONTEXT);
+                    scheduler = new AdmissionScheduler(capacity, (int) Math.ceil(capacity * batchShare),
+                            admissionMaxQueued);
+                    admission = scheduler;
+                }
+            }
+        }
+        return scheduler;
+    }
+
+    // Caller must release the returned handle; the reference it holds keeps the model alive
+    private long acquireModel(String modelId) throws LlamaException {
+        String id = modelId != null ? modelId : DEFAULT_MODEL_ID;
+        String path = modelPaths().get(id);
+        if (path == null) {
+            throw new LlamaException("Unknown model: " + id);
+        }
+
+        try {
+            configureRegistry();
+            LoadOptions options = buildLoadOptions(id);
+            long handle = llamaJNI.acquireModel(id, path, options.isDefault() ? null : options);
+            if (handle == 0) {
+                throw new LlamaException("Failed to load model from path: " + path);
+            }
+            return handle;
+        } catch (LlamaException e) {
+            throw e;
+        } catch (Exception e) {
+            throw new LlamaException("Failed to load model: " + e.getMessage(), e);
+        }
+    }
+
+    private void configureRegistry() {
+        if (!registryConfigured) {
+            synchronized (this) {
+                if (!registryConfigured) {
+                    if (modelMemoryBudgetMb > 0) {
+                        llamaJNI.setModelMemoryBudget(modelMemoryBudgetMb * 1024 * 1024);
                     }
+                    registryConfigured = true;
                 }
-            } finally {
-                modelLock.writeLock().unlock();
             }
         }
     }
 
+    private Map<String, String> modelPaths() throws LlamaException {
+        Map<String, String> paths = modelPaths;
+        if (paths == null) {
+            // Same lock as reloadModel, so a reload's path is never overwritten by the config
+            synchronized (reloadLock) {
+                paths = modelPaths;
+                if (paths == null) {
+                    paths = parseModelPaths();
+                    modelPaths = paths;
+                }
+            }
+        }
+        return paths;
+    }
+
+    private Map<String, String> parseModelPaths() throws LlamaException {
+        Map<String, String> paths = new LinkedHashMap<>();
+        paths.put(DEFAULT_MODEL_ID, modelPath);
+        if (models != null && !models.isBlank()) {
+            for (String entry : models.split(",")) {
+                int separator = entry.indexOf('=');
+                String id = separator > 0 ? entry.substring(0, separator).trim() : "";
+                String path = separator > 0 ? entry.substring(separator + 1).trim() : "";
+                if (id.isEmpty() || path.isEmpty() || id.length() > SamplingParams.MAX_MODEL_ID_LENGTH) {
+                    throw new LlamaException("Invalid llama.models entry: " + entry.trim());
+                }
+                paths.put(id, path);
+            }
+        }
+        return Collections.unmodifiableMap(paths);
+    }
+
+    /** Model ids requests can pick with SamplingParams.setModel. */
+    public Set<String> getModelIds() throws LlamaException {
+        return modelPaths().keySet();
+    }
+
+    /** Ids of the models currently loaded, most recently used first. */
+    public String[] getResidentModels() {
+        return llamaJNI.residentModels();
+    }
+
+    /** Native metrics snapshot of a resident model, null if it is not loaded; never loads it. */
+    public long[] getMetrics(String modelId) {
+        return llamaJNI.getMetrics(modelId != null ? modelId : DEFAULT_MODEL_ID);
+    }
+
+    private LoadOptions buildLoadOptions(String modelId) {
+        LoadOptions options = new LoadOptions();
+        options.setContextLength(contextLength);
+        options.setContexts(contexts);
+        options.setSequencesPerContext(sequencesPerContext);
+        options.setThreads(threads);
+        options.setThreadsBatch(threadsBatch);
+        if (cpuSets != null && !cpuSets.isBlank()) {
+            options.setCpuSets(cpuSets.trim());
+        }
+        if (numa != null && !numa.isBlank()) {
+            options.setNuma(numa.trim().toLowerCase(Locale.ROOT));
+        }
+        options.setBatchSize(batchSize);
+        options.setUbatchSize(ubatchSize);
+        options.setPrefillChunk(prefillChunk);
+        options.setGpuLayers(gpuLayers);
+        if (flashAttention != null && !flashAttention.isBlank()) {
+            options.setFlashAttention(flashAttention.trim().toLowerCase(Locale.ROOT));
+        }
+        options.setUseMmap(useMmap);
+        options.setUseMlock(useMlock);
+        options.setDeadlineMillis(generationDeadlineSeconds * 1000);
+        // The draft shares the default model's vocabulary, not necessarily the others'
+        if (DEFAULT_MODEL_ID.equals(modelId) && draftModelPath != null && !draftModelPath.isBlank()) {
+            options.setDraftModelPath(draftModelPath);
+        }
+        options.setDraftTokens(draftTokens);
+        options.setSessionMemoryMb(sessionMemoryMb);
+        options.setSessionDiskMb(sessionDiskMb);
+        if (sessionDir != null && !sessionDir.isBlank()) {
+            options.setSessionDir(sessionDir);
+        }
+        options.setWarmup(warmupEnabled);
+        options.setContextShift(contextShift);
+        options.setKeepTokens(keepTokens);
+        return options;
+    }
+
     private void validatePrompt(String prompt) throws LlamaException {
         if (prompt == null) {
             throw new LlamaException("Prompt cannot be null");
@@ -126,6 +916,69 @@ public class LlamaService {
         }
     }
 
+    // Validates the settings and returns what the native side reads: the same object, or a copy
+    // with the JSON schema converted to a grammar. Null stays null.
+    private SamplingParams prepareSamplingParams(SamplingParams params) throws LlamaException {
+        if (params == null) {
+            return null;
+        }
+        validateSamplingParams(params);
+        if (params.getJsonSchema() == null) {
+            return params;
+        }
+        SamplingParams resolved = new SamplingParams(params);
+        resolved.setGrammar(JsonSchemaGrammar.toGrammar(params.getJsonSchema()));
+        resolved.setJsonSchema(null);
+        return resolved;
+    }
+
+    private void validateSamplingParams(SamplingParams params) throws LlamaException {
+        if (params.getMaxTokens() <= 0) {
+            throw new LlamaException("maxTokens must be positive");
+        }
+
+        // Negated comparisons so NaN is rejected too
+        if (!(params.getTemperature() >= 0.0f)) {
+            throw new LlamaException("temperature cannot be negative");
+        }
+
+        if (params.getTopK() < 0) {
+            throw new LlamaException("topK cannot be negative");
+        }
+
+        if (!(params.getTopP() > 0.0f && params.getTopP() <= 1.0f)) {
+            throw new LlamaException("topP must be in (0, 1]");
+        }
+
+        if (params.getSeed() < 0 || params.getSeed() > 0xFFFFFFFFL) {
+            throw new LlamaException("seed must be an unsigned 32-bit value");
+        }
+
+        String sessionId = params.getSessionId();
+        if (sessionId != null && (sessionId.isEmpty() || sessionId.length() > SamplingParams.MAX_SESSION_ID_LENGTH)) {
+            throw new LlamaException("sessionId must be 1-" + SamplingParams.MAX_SESSION_ID_LENGTH + " characters");
+        }
+
+        if (params.getModel() != null && !modelPaths().containsKey(params.getModel())) {
+            throw new LlamaException("Unknown model: " + params.getModel());
+        }
+
+        String tenant = params.getTenant();
+        if (tenant != null && (tenant.isEmpty() || tenant.length() > SamplingParams.MAX_TENANT_LENGTH)) {
+            throw new LlamaException("tenant must be 1-" + SamplingParams.MAX_TENANT_LENGTH + " characters");
+        }
+
+        String grammar = params.getGrammar();
+        if (grammar != null && (grammar.isBlank() || grammar.length() > SamplingParams.MAX_GRAMMAR_LENGTH)) {
+            throw new LlamaException("grammar must be 1-" + SamplingParams.MAX_GRAMMAR_LENGTH + " characters");
+        }
+
+        if (grammar != null && params.getJsonSchema() != null) {
+            throw new LlamaException("Set either grammar or jsonSchema, not both");
+        }
+    }
+
+    // Each step returns its input unchanged, without a copy, when there is nothing to remove
     private String sanitizePrompt(String prompt) {
         if (prompt == null) {
             return "";
@@ -138,59 +991,24 @@ public class LlamaService {
         sanitized = sanitized.trim();
 
         // Limit line breaks
-        sanitized = sanitized.replaceAll("\\n{3,}", "\n\n");
+        sanitized = BLANK_LINES_PATTERN.matcher(sanitized).replaceAll("\n\n");
 
         return sanitized;
     }
 
     private boolean containsSuspiciousContent(String prompt) {
-        // Basic checks for potentially harmful content
-        String lowerPrompt = prompt.toLowerCase();
-
-        // Check for obvious injection attempts
-        String[] suspiciousPatterns = {
-                "system(",
-                "exec(",
-                "eval(",
-                "\\x",
-                "\\.dll",
-                "\\.exe",
-                "cmd.exe",
-                "powershell"
-        };
-
-        for (String pattern : suspiciousPatterns) {
-            if (lowerPrompt.contains(pattern)) {
-                return true;
-            }
-        }
-
-        return false;
+        return SUSPICIOUS_PATTERN.matcher(prompt).find();
     }
 
     public boolean isModelLoaded() {
-        // First check without loading
-        modelLock.readLock().lock();
+        // Loads the default model if it is not resident yet
         try {
-            if (modelHandle != 0) {
-                // Check with JNI layer for accurate status
-                return llamaJNI.isModelLoaded(modelHandle);
-            }
-        } finally {
-            modelLock.readLock().unlock();
-        }
-
-        // Try to load model if not already loaded
-        try {
-            loadModelIfNeeded();
-            modelLock.readLock().lock();
+            long handle = acquireModel(null);
             try {
-                if (modelHandle != 0) {
-                    return llamaJNI.isModelLoaded(modelHandle);
-                }
-                return false;
+                // Check with JNI layer for accurate status
+                return llamaJNI.isModelLoaded(handle);
             } finally {
-                modelLock.readLock().unlock();
+                llamaJNI.releaseModel(handle);
             }
         } catch (LlamaException e) {
             // If loading fails, model is not loaded
@@ -199,51 +1017,90 @@ public class LlamaService {
     }
 
     public String getModelStatus() {
-        // First check without loading
-        modelLock.readLock().lock();
         try {
-            if (modelHandle != 0) {
+            long handle = acquireModel(null);
+            try {
                 // Get detailed status from JNI layer
-                return llamaJNI.getModelInfo(modelHandle);
+                return llamaJNI.getModelInfo(handle);
+            } finally {
+                llamaJNI.releaseModel(handle);
             }
-        } finally {
-            modelLock.readLock().unlock();
+        } catch (LlamaException e) {
+            // If loading fails, return error status
+            return "Model not loaded: " + e.getMessage();
         }
+    }
 
-        // Try to load model if not already loaded
-        try {
-            loadModelIfNeeded();
-            modelLock.readLock().lock();
+    /** Reloads a model from its configured path; see {@link #reloadModel(String, String)}. */
+    public void reloadModel(String modelId) throws LlamaException {
+        reloadModel(modelId, null);
+    }
+
+    /**
+     * Blue/green swap: loads the model (from path, or its configured path when null) next to
+     * the running one, then routes new requests to it. Requests already running finish on the
+     * old model, which is freed after the last of them. If the load fails the old model keeps
+     * serving. Files replaced on disk must be swapped by rename, not rewritten in place, since
+     * the old model still maps them.
+     */
+    public void reloadModel(String modelId, String path) throws LlamaException {
+        String id = modelId != null ? modelId : DEFAULT_MODEL_ID;
+        String previous = modelPaths().get(id);
+        String target = path != null ? path : previous;
+        if (target == null) {
+            throw new LlamaException("Unknown model: " + id);
+        }
+
+        synchronized (reloadLock) {
+            // Cold loads after an eviction use the new path as soon as it is live
+            setModelPath(id, target);
+            boolean swapped = false;
             try {
-                if (modelHandle != 0) {
-                    return llamaJNI.getModelInfo(modelHandle);
+                configureRegistry();
+                LoadOptions options = buildLoadOptions(id);
+                swapped = llamaJNI.reloadModel(id, target, options.isDefault() ? null : options);
+                if (!swapped) {
+                    throw new LlamaException("Failed to load model from path: " + target);
                 }
-                return "Model not loaded";
+                if (responseCache != null) {
+                    responseCache.invalidate(id);
+                }
+            } catch (LlamaException e) {
+                throw e;
+            } catch (Exception e) {
+                throw new LlamaException("Failed to reload model: " + e.getMessage(), e);
             } finally {
-                modelLock.readLock().unlock();
+                if (!swapped) {
+                    setModelPath(id, previous);
+                }
             }
-        } catch (LlamaException e) {
-            // If loading fails, return error status
-            return "Model not loaded: " + e.getMessage();
         }
     }
 
+    private void setModelPath(String id, String path) throws LlamaException {
+        Map<String, String> paths = new LinkedHashMap<>(modelPaths());
+        if (path != null) {
+            paths.put(id, path);
+        } else {
+            paths.remove(id);
+        }
+        modelPaths = Collections.unmodifiableMap(paths);
+    }
+
+    // Evicts every model; requests and async jobs still running keep theirs until they finish
     @PreDestroy
     public void cleanup() {
-        modelLock.writeLock().lock();
         try {
-            if (modelHandle != 0) {
+            for (String id : llamaJNI.residentModels()) {
                 try {
-                    llamaJNI.unloadModel(modelHandle);
+                    llamaJNI.evictModel(id);
                 } catch (Exception e) {
                     // Log error but don't throw during shutdown
-                    System.err.println("Error unloading model: " + e.getMessage());
-                } finally {
-                    modelHandle = 0;
+                    System.err.println("Error unloading model " + id + ": " + e.getMessage());
                 }
             }
-        } finally {
-            modelLock.writeLock().unlock();
+        } catch (Exception e) {
+            System.err.println("Error unloading models: " + e.getMessage());
         }
     }
 }
@@ -0,0 +1,231 @@
+package com.livecoding.demo;
+
+/**
+ * Native model/context settings passed to LlamaJNI.loadModel.
+ * Numeric values of 0 keep the native default; field names are read by llama_jni.c.
+ */
+public class LoadOptions {
+    // Native defaults (llama_engine.h) of the settings left at 0
+    public static final int DEFAULT_CONTEXTS = 2;
+    public static final int DEFAULT_SEQUENCES_PER_CONTEXT = 4;
+
+    private int contextLength;        // KV cache length per sequence (n_ctx of one request)
+    private int contexts;             // llama contexts in the pool
+    private int sequencesPerContext;  // n_seq_max: sequences batched into one context
+    private int threads;
+    private int threadsBatch;
+    private String cpuSets;           // "auto" or cpulists per context, e.g. "0-7;8-15"; null leaves threads unpinned
+    private String numa;              // distribute, isolate, numactl or interleave; null disables NUMA placement
+    private int batchSize;            // n_batch
+    private int ubatchSize;           // n_ubatch
+    private int prefillChunk;
+    private int gpuLayers;
+    private String flashAttention;    // auto, on or off; null leaves llama.cpp's choice (auto)
+    private boolean useMmap = true;
+    private boolean useMlock;
+    private int deadlineMillis;       // time limit per generation inside the native scheduler
+    private String draftModelPath;    // small GGUF with the same vocabulary, enables speculative decoding
+    private int draftTokens;          // tokens the draft proposes per step
+    private int sessionMemoryMb;      // KV state kept in memory for idle conversations
+    private int sessionDiskMb;        // further KV state spilled to sessionDir
+    private String sessionDir;
+    private boolean warmup;           // pre-fault the weights and run one decode per context at load
+    private boolean contextShift;     // full windows drop their middle instead of stopping generation
+    private int keepTokens;           // leading tokens a shift or prompt truncation keeps, after BOS
+
+    public int getContextLength() {
+        return contextLength;
+    }
+
+    public void setContextLength(int contextLength) {
+        this.contextLength = contextLength;
+    }
+
+    public int getContexts() {
+        return contexts;
+    }
+
+    public void setContexts(int contexts) {
+        this.contexts = contexts;
+    }
+
+    public int getSequencesPerContext() {
+        return sequencesPerContext;
+    }
+
+    public void setSequencesPerContext(int sequencesPerContext) {
+        this.sequencesPerContext = sequencesPerContext;
+    }
+
+    public int getThreads() {
+        return threads;
+    }
+
+    public void setThreads(int threads) {
+        this.threads = threads;
+    }
+
+    public int getThreadsBatch() {
+        return threadsBatch;
+    }
+
+    public void setThreadsBatch(int threadsBatch) {
+        this.threadsBatch = threadsBatch;
+    }
+
+    public String getCpuSets() {
+        return cpuSets;
+    }
+
+    public void setCpuSets(String cpuSets) {
+        this.cpuSets = cpuSets;
+    }
+
+    public String getNuma() {
+        return numa;
+    }
+
+    public void setNuma(String numa) {
+        this.numa = numa;
+    }
+
+    public int getBatchSize() {
+        return batchSize;
+    }
+
+    public void setBatchSize(int batchSize) {
+        this.batchSize = batchSize;
+    }
+
+    public int getUbatchSize() {
+        return ubatchSize;
+    }
+
+    public void setUbatchSize(int ubatchSize) {
+        this.ubatchSize = ubatchSize;
+    }
+
+    public int getPrefillChunk() {
+        return prefillChunk;
+    }
+
+    public void setPrefillChunk(int prefillChunk) {
+        this.prefillChunk = prefillChunk;
+    }
+
+    public int getGpuLayers() {
+        return gpuLayers;
+    }
+
+    public void setGpuLayers(int gpuLayers) {
+        this.gpuLayers = gpuLayers;
+    }
+
+    public String getFlashAttention() {
+        return flashAttention;
+    }
+
+    public void setFlashAttention(String flashAttention) {
+        this.flashAttention = flashAttention;
+    }
+
+    public boolean isUseMmap() {
+        return useMmap;
+    }
+
+    public void setUseMmap(boolean useMmap) {
+        this.useMmap = useMmap;
+    }
+
+    public boolean isUseMlock() {
+        return useMlock;
+    }
+
+    public void setUseMlock(boolean useMlock) {
+        this.useMlock = useMlock;
+    }
+
+    public int getDeadlineMillis() {
+        return deadlineMillis;
+    }
+
+    public void setDeadlineMillis(int deadlineMillis) {
+        this.deadlineMillis = deadlineMillis;
+    }
+
+    public String getDraftModelPath() {
+        return draftModelPath;
+    }
+
+    public void setDraftModelPath(String draftModelPath) {
+        this.draftModelPath = draftModelPath;
+    }
+
+    public int getDraftTokens() {
+        return draftTokens;
+    }
+
+    public void setDraftTokens(int draftTokens) {
+        this.draftTokens = draftTokens;
+    }
+
+    public int getSessionMemoryMb() {
+        return sessionMemoryMb;
+    }
+
+    public void setSessionMemoryMb(int sessionMemoryMb) {
+        this.sessionMemoryMb = sessionMemoryMb;
+    }
+
+    public int getSessionDiskMb() {
+        return sessionDiskMb;
+    }
+
+    public void setSessionDiskMb(int sessionDiskMb) {
+        this.sessionDiskMb = sessionDiskMb;
+    }
+
+    public String getSessionDir() {
+        return sessionDir;
+    }
+
+    public void setSessionDir(String sessionDir) {
+        this.sessionDir = sessionDir;
+    }
+
+    public boolean isWarmup() {
+        return warmup;
+    }
+
+    public void setWarmup(boolean warmup) {
+        this.warmup = warmup;
+    }
+
+    public boolean isContextShift() {
+        return contextShift;
+    }
+
+    public void setContextShift(boolean contextShift) {
+        this.contextShift = contextShift;
+    }
+
+    public int getKeepTokens() {
+        return keepTokens;
+    }
+
+    public void setKeepTokens(int keepTokens) {
+        this.keepTokens = keepTokens;
+    }
+
+    /** True when every setting is left at its default, so the plain loadModel(String) is equivalent. */
+    public boolean isDefault() {
+        return contextLength == 0 && contexts == 0 && sequencesPerContext == 0 && threads == 0
+                && threadsBatch == 0 && (cpuSets == null || cpuSets.isEmpty()) && (numa == null || numa.isEmpty())
+                && batchSize == 0 && ubatchSize == 0 && prefillChunk == 0
+                && gpuLayers == 0 && (flashAttention == null || flashAttention.isEmpty() || "auto".equals(flashAttention))
+                && useMmap && !useMlock && deadlineMillis == 0
+                && (draftModelPath == null || draftModelPath.isEmpty()) && draftTokens == 0
+                && sessionMemoryMb == 0 && sessionDiskMb == 0 && (sessionDir == null || sessionDir.isEmpty())
+                && !warmup && !contextShift && keepTokens == 0;
+    }
+}
@@ -3,10 +3,40 @@ package com.livecoding.demo;
 import java.io.*;
 import java.nio.file.Files;
 import java.nio.file.Path;
+import java.nio.file.Paths;
 import java.nio.file.StandardCopyOption;
-
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * Extracts the native libraries bundled in the jar and loads them. Extracted files are cached
+ * across restarts under {@code -Dllama.native.cache.dir} (default: java.io.tmpdir/llama-jni),
+ * in one directory per content hash, so a restart with the same jar loads them in place and a
+ * new build never picks up a stale library. File names are kept because the libraries link
+ * against each other by name.
+ * <p>
+ * The JNI library comes in the CPU variants built by CMakeLists.txt. The llama_jni_cpu probe
+ * reports the widest one the host runs, and the widest variant bundled in the jar is loaded;
+ * {@code -Dllama.native.variant=generic|avx2|avx512} forces one.
+ */
 public class NativeLibraryLoader {
 
+    private static final String CACHE_DIR_PROPERTY = "llama.native.cache.dir";
+    private static final String VARIANT_PROPERTY = "llama.native.variant";
+    private static final String PROBE_LIBRARY = "llama_jni_cpu";
+
+    // Indexed by the ISA level the probe reports (JNI_ISA_* in llama_jni_platform.h)
+    static final String[] VARIANTS = { "generic", "avx2", "avx512" };
+
+    private static int detectedIsaLevel = -1; // guarded by the class lock
+
+    private static native int isaLevel();
+
     private static Path sharedTempDir = null;
 
     private static Path getSharedTempDir() throws IOException {
@@ -17,67 +47,168 @@ public class NativeLibraryLoader {
         return sharedTempDir;
     }
 
-    public static void loadLibraryFromJar(String libraryName) throws IOException {
-        String osName = System.getProperty("os.name").toLowerCase();
+    private static Path getCacheRoot() {
+        String configured = System.getProperty(CACHE_DIR_PROPERTY);
+        return configured != null && !configured.isBlank()
+                ? Paths.get(configured)
+                : Paths.get(System.getProperty("java.io.tmpdir"), "llama-jni");
+    }
+
+    /**
+     * Returns the cached copy of a bundled library, extracting it first if this content has
+     * not been cached yet. Falls back to a per-run temp directory when the cache is not
+     * writable. Returns null when the jar does not contain the library.
+     */
+    static Path extractLibrary(String libraryFile) throws IOException {
+        byte[] bytes;
+        try (InputStream inputStream = NativeLibraryLoader.class.getResourceAsStream("/" + libraryFile)) {
+            if (inputStream == null) {
+                return null;
+            }
+            bytes = inputStream.readAllBytes();
+        }
+
+        try {
+            Path dir = getCacheRoot().resolve(sha256(bytes).substring(0, 16));
+            Path cached = dir.resolve(libraryFile);
+            if (Files.isRegularFile(cached) && Files.size(cached) == bytes.length) {
+                return cached;
+            }
+
+            // Write next to the target and rename, so a concurrent start never loads a partial file
+            Files.createDirectories(dir);
+            Path partial = Files.createTempFile(dir, libraryFile, ".part");
+            try {
+                Files.write(partial, bytes);
+                Files.move(partial, cached, StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE);
+            } finally {
+                Files.deleteIfExists(partial);
+            }
+            return cached;
+        } catch (IOException e) {
+            System.err.println("Warning: Native library cache unavailable (" + e.getMessage() + "), using a temp dir");
+        }
+
+        Path tempFile = getSharedTempDir().resolve(libraryFile);
+        tempFile.toFile().deleteOnExit();
+        Files.write(tempFile, bytes);
+        return tempFile;
+    }
+
+    private static String sha256(byte[] bytes) {
+        try {
+            StringBuilder hex = new StringBuilder();
+            for (byte b : MessageDigest.getInstance("SHA-256").digest(bytes)) {
+                hex.append(String.format("%02x", b));
+            }
+            return hex.toString();
+        } catch (NoSuchAlgorithmException e) {
+            throw new IllegalStateException("SHA-256 not available", e);
+        }
+    }
 
-        String libraryFile;
+    static String libraryFileName(String libraryName) {
+        String osName = System.getProperty("os.name").toLowerCase();
         if (osName.contains("windows")) {
-            libraryFile = libraryName + ".dll";
+            return libraryName + ".dll";
         } else if (osName.contains("linux")) {
-            libraryFile = "lib" + libraryName + ".so";
+            return "lib" + libraryName + ".so";
         } else if (osName.contains("mac")) {
-            libraryFile = "lib" + libraryName + ".dylib";
-        } else {
-            throw new UnsupportedOperationException("Unsupported operating system: " + osName);
+            return "lib" + libraryName + ".dylib";
         }
+        throw new UnsupportedOperationException("Unsupported operating system: " + osName);
+    }
 
-        // Use shared temp directory
-        Path tempDir = getSharedTempDir();
-        Path tempFile = tempDir.resolve(libraryFile);
-        tempFile.toFile().deleteOnExit();
+    static String variantLibraryName(String libraryName, String variant) {
+        return variant.equals("generic") ? libraryName : libraryName + "_" + variant;
+    }
 
-        // Extract library from resources
-        try (InputStream inputStream = NativeLibraryLoader.class.getResourceAsStream("/" + libraryFile)) {
-            if (inputStream == null) {
-                throw new FileNotFoundException("Library file not found in resources: " + libraryFile);
+    /**
+     * Variants to try in order: only the configured one when set, otherwise every variant up to
+     * the host's ISA level, widest first.
+     */
+    static List<String> candidateVariants(String configured, int level) {
+        if (configured != null && !configured.isBlank()) {
+            if (!Arrays.asList(VARIANTS).contains(configured)) {
+                throw new IllegalArgumentException("Unknown " + VARIANT_PROPERTY + " '" + configured
+                        + "', expected one of " + Arrays.toString(VARIANTS));
+            }
+            return List.of(configured);
+        }
+        List<String> candidates = new ArrayList<>();
+        for (int i = Math.min(level, VARIANTS.length - 1); i >= 0; i--) {
+            candidates.add(VARIANTS[i]);
+        }
+        return candidates;
+    }
+
+    // The probe carries no ISA flags, so it loads on any CPU; without it only generic is tried
+    private static synchronized int detectIsaLevel() {
+        if (detectedIsaLevel < 0) {
+            detectedIsaLevel = 0;
+            try {
+                Path probe = extractLibrary(libraryFileName(PROBE_LIBRARY));
+                if (probe != null) {
+                    System.load(probe.toAbsolutePath().toString());
+                    detectedIsaLevel = Math.max(isaLevel(), 0);
+                    System.out.println("Detected CPU variant: "
+                            + VARIANTS[Math.min(detectedIsaLevel, VARIANTS.length - 1)]);
+                }
+            } catch (IOException | UnsatisfiedLinkError e) {
+                System.err.println("Warning: CPU probe unavailable (" + e.getMessage()
+                        + "), using the generic library");
             }
-            Files.copy(inputStream, tempFile, StandardCopyOption.REPLACE_EXISTING);
         }
+        return detectedIsaLevel;
+    }
 
-        // Load the library
-        System.load(tempFile.toAbsolutePath().toString());
-        System.out.println("Loaded main library: " + libraryFile);
+    public static void loadLibraryFromJar(String libraryName) throws IOException {
+        String configured = System.getProperty(VARIANT_PROPERTY);
+        int level = configured != null && !configured.isBlank() ? 0 : detectIsaLevel();
+
+        for (String variant : candidateVariants(configured, level)) {
+            // Extract library from resources (or reuse the cached copy); skip variants not bundled
+            String libraryFile = libraryFileName(variantLibraryName(libraryName, variant));
+            Path libraryPath = extractLibrary(libraryFile);
+            if (libraryPath == null) {
+                continue;
+            }
+
+            // Load the library
+            System.load(libraryPath.toAbsolutePath().toString());
+            System.out.println("Loaded main library: " + libraryFile);
+            return;
+        }
+        throw new FileNotFoundException("Library file not found in resources: "
+                + libraryFileName(libraryName) + " (or a CPU variant of it)");
     }
 
     public static void loadDependentLibrariesFromJar() throws IOException {
         // Core dependencies needed for basic functionality
         String[] coreLibs = {
-                "ggml-base.dll",
-                "ggml-cpu.dll",
-                "ggml.dll"
+                libraryFileName("ggml-base"),
+                libraryFileName("ggml-cpu"),
+                libraryFileName("ggml")
         };
 
         // Optional dependencies that may have complex dependency chains
         String[] optionalLibs = {
-                "mtmd.dll",
-                "llama.dll"
+                libraryFileName("mtmd"),
+                libraryFileName("llama")
         };
 
-        Path tempDir = getSharedTempDir();
-
-        // Extract all libraries to the same directory
+        // Extract all libraries (cached across restarts)
         String[] allLibs = new String[coreLibs.length + optionalLibs.length];
         System.arraycopy(coreLibs, 0, allLibs, 0, coreLibs.length);
         System.arraycopy(optionalLibs, 0, allLibs, coreLibs.length, optionalLibs.length);
 
+        Map<String, Path> extracted = new HashMap<>();
         for (String libName : allLibs) {
-            Path tempFile = tempDir.resolve(libName);
-            tempFile.toFile().deleteOnExit();
-
-            try (InputStream inputStream = NativeLibraryLoader.class.getResourceAsStream("/" + libName)) {
-                if (inputStream != null) {
-                    Files.copy(inputStream, tempFile, StandardCopyOption.REPLACE_EXISTING);
-                    System.out.println("Extracted dependency: " + tempFile.toAbsolutePath());
+            try {
+                Path libFile = extractLibrary(libName);
+                if (libFile != null) {
+                    extracted.put(libName, libFile);
+                    System.out.println("Extracted dependency: " + libFile.toAbsolutePath());
                 } else {
                     System.err.println("Warning: Dependency not found in resources: " + libName);
                 }
@@ -88,8 +219,8 @@ public class NativeLibraryLoader {
 
         // Load core libraries first (these are critical)
         for (String libName : coreLibs) {
-            Path libFile = tempDir.resolve(libName);
-            if (libFile.toFile().exists()) {
+            Path libFile = extracted.get(libName);
+            if (libFile != null) {
                 try {
                     System.load(libFile.toAbsolutePath().toString());
                     System.out.println("Loaded core dependency: " + libName);
@@ -102,8 +233,8 @@ public class NativeLibraryLoader {
 
         // Try to load optional libraries (failures are non-fatal)
         for (String libName : optionalLibs) {
-            Path libFile = tempDir.resolve(libName);
-            if (libFile.toFile().exists()) {
+            Path libFile = extracted.get(libName);
+            if (libFile != null) {
                 try {
                     System.load(libFile.toAbsolutePath().toString());
                     System.out.println("Loaded optional dependency: " + libName);
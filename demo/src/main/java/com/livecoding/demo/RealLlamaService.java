@@ -1,74 +1,401 @@
 package com.livecoding.demo;
 
+import org.springframework.beans.factory.annotation.Value;
 import org.springframework.stereotype.Service;
-import org.springframework.web.client.RestTemplate;
-import org.springframework.http.HttpEntity;
-import org.springframework.http.HttpHeaders;
-import org.springframework.http.MediaType;
 import com.fasterxml.jackson.databind.ObjectMapper;
 import com.fasterxml.jackson.databind.JsonNode;
+import jakarta.annotation.PostConstruct;
+import jakarta.annotation.PreDestroy;
 
+import java.io.IOException;
+import java.io.UncheckedIOException;
+import java.net.URI;
+import java.net.http.HttpClient;
+import java.net.http.HttpRequest;
+import java.net.http.HttpResponse;
+import java.time.Duration;
+import java.util.ArrayList;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.List;
 import java.util.Map;
 import java.util.HashMap;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.stream.Stream;
 
 @Service
 public class RealLlamaService {
 
-    private final RestTemplate restTemplate = new RestTemplate();
+    /**
+     * Circuit state of a llama-server upstream. CLOSED routes requests to the server; HALF_OPEN
+     * lets a single trial request through, whose outcome decides between CLOSED and OPEN again.
+     */
+    public enum CircuitState { CLOSED, OPEN, HALF_OPEN }
+
     private final ObjectMapper objectMapper = new ObjectMapper();
-    private final String llamaServerUrl = "http://127.0.0.1:8081/completion";
+    private HttpClient httpClient;
+
+    // One or more llama-server instances; each request goes to the one with the fewest in flight
+    @Value("${llama.server.urls:http://127.0.0.1:8081}")
+    private String serverUrls = "http://127.0.0.1:8081";
+
+    @Value("${llama.server.connect.timeout.ms:1000}")
+    private long connectTimeoutMs = 1000;
+
+    // Until llama-server starts answering; a streamed completion may then run past it
+    @Value("${llama.server.request.timeout.seconds:120}")
+    private long requestTimeoutSeconds = 120;
+
+    // GET /health is probed in the background; requests only read the cached state
+    @Value("${llama.server.health.interval.ms:2000}")
+    private long healthIntervalMs = 2000;
+
+    @Value("${llama.server.health.timeout.ms:1000}")
+    private long healthTimeoutMs = 1000;
+
+    // Probe failures, or request failures, in a row that open an upstream's circuit. The two are
+    // counted apart, so a server whose /health passes while completions fail still opens.
+    @Value("${llama.server.failure.threshold:3}")
+    private int failureThreshold = 3;
+
+    private volatile List<Upstream> upstreams = List.of();
+    private ScheduledExecutorService healthChecker;
+
+    /** A llama-server instance with its own circuit and count of requests in flight. */
+    static final class Upstream {
+        final String url;
+        final AtomicInteger outstanding = new AtomicInteger();
+
+        // Unknown until the first probe answers, so startup serves from the JNI backend
+        private volatile CircuitState state = CircuitState.OPEN;
+        private int probeFailures;
+        private int requestFailures;
+        private final AtomicBoolean trialInFlight = new AtomicBoolean();
+
+        Upstream(String url) {
+            this.url = url;
+        }
+
+        CircuitState state() {
+            return state;
+        }
+
+        // Whether selectUpstream may pick it: HALF_OPEN only while its trial is free
+        boolean admitsRequests() {
+            CircuitState current = state;
+            return current == CircuitState.CLOSED || current == CircuitState.HALF_OPEN && !trialInFlight.get();
+        }
+
+        // Claims the HALF_OPEN trial for the calling request, which must call endTrial when done
+        boolean tryStartTrial() {
+            return state == CircuitState.HALF_OPEN && trialInFlight.compareAndSet(false, true);
+        }
+
+        void endTrial() {
+            trialInFlight.set(false);
+        }
+
+        synchronized void probeSucceeded() {
+            probeFailures = 0;
+            if (state == CircuitState.OPEN) {
+                state = CircuitState.HALF_OPEN;
+            }
+        }
+
+        synchronized void recordProbeFailure(int threshold) {
+            probeFailures++;
+            if (state == CircuitState.HALF_OPEN || probeFailures >= threshold) {
+                state = CircuitState.OPEN;
+            }
+        }
+
+        synchronized void recordSuccess() {
+            requestFailures = 0;
+            state = CircuitState.CLOSED;
+        }
+
+        synchronized void recordFailure(int threshold) {
+            requestFailures++;
+            // A trial request that fails reopens at once
+            if (state == CircuitState.HALF_OPEN || requestFailures >= threshold) {
+                state = CircuitState.OPEN;
+            }
+        }
+    }
+
+    // Tells an exception of the token callback apart from a broken stream
+    private static final class CallbackFailure extends RuntimeException {
+        CallbackFailure(RuntimeException cause) {
+            super(cause);
+        }
+
+        @Override
+        public synchronized RuntimeException getCause() {
+            return (RuntimeException) super.getCause();
+        }
+    }
+
+    @PostConstruct
+    public void initialize() {
+        configureUpstreams();
+
+        healthChecker = Executors.newSingleThreadScheduledExecutor(runnable -> {
+            Thread thread = new Thread(runnable, "llama-server-health");
+            thread.setDaemon(true);
+            return thread;
+        });
+        healthChecker.scheduleWithFixedDelay(this::checkHealth, 0, healthIntervalMs, TimeUnit.MILLISECONDS);
+    }
+
+    // The JDK client keeps HTTP/1.1 connections alive and pools them per upstream
+    void configureUpstreams() {
+        httpClient = HttpClient.newBuilder()
+                .version(HttpClient.Version.HTTP_1_1)
+                .connectTimeout(Duration.ofMillis(connectTimeoutMs))
+                .build();
+
+        List<Upstream> configured = new ArrayList<>();
+        for (String url : serverUrls.split(",")) {
+            String trimmed = url.trim();
+            while (trimmed.endsWith("/")) {
+                trimmed = trimmed.substring(0, trimmed.length() - 1);
+            }
+            if (!trimmed.isEmpty()) {
+                configured.add(new Upstream(trimmed));
+            }
+        }
+        upstreams = List.copyOf(configured);
+    }
+
+    @PreDestroy
+    public void shutdown() {
+        if (healthChecker != null) {
+            healthChecker.shutdownNow();
+        }
+    }
 
     public String generateText(String prompt) throws Exception {
-        // Prepare request body
-        Map<String, Object> requestBody = new HashMap<>();
-        requestBody.put("prompt", prompt);
-        requestBody.put("n_predict", 256);
-        requestBody.put("temperature", 0.7);
-        requestBody.put("top_p", 0.9);
-        requestBody.put("top_k", 40);
-        requestBody.put("repeat_penalty", 1.1);
-        requestBody.put("stream", false);
+        return generateTextStreaming(prompt, null, piece -> { });
+    }
 
-        // Prepare headers
-        HttpHeaders headers = new HttpHeaders();
-        headers.setContentType(MediaType.APPLICATION_JSON);
+    public String generateText(String prompt, SamplingParams params) throws Exception {
+        return generateTextStreaming(prompt, params, piece -> { });
+    }
+
+    /**
+     * Streams the completion from the least loaded upstream, handing each chunk to the
+     * callback as llama-server sends it. Returns the whole text, trimmed. An exception thrown
+     * by the callback closes the connection, which makes llama-server stop generating.
+     */
+    public String generateTextStreaming(String prompt, SamplingParams params, TokenCallback callback)
+            throws Exception {
+        byte[] body = objectMapper.writeValueAsBytes(requestBody(prompt, params));
 
-        // Create HTTP entity
-        HttpEntity<Map<String, Object>> entity = new HttpEntity<>(requestBody, headers);
+        // A HALF_OPEN pick only goes ahead as its one trial; if another request won it, pick again
+        Upstream upstream;
+        boolean trial;
+        do {
+            upstream = selectUpstream();
+            if (upstream == null) {
+                throw new Exception("Failed to generate text from LLaMA server: no upstream available");
+            }
+            trial = upstream.state() != CircuitState.CLOSED;
+        } while (trial && !upstream.tryStartTrial());
 
+        upstream.outstanding.incrementAndGet();
         try {
-            // Make HTTP POST request to llama-server
-            String response = restTemplate.postForObject(llamaServerUrl, entity, String.class);
+            HttpRequest request = HttpRequest.newBuilder(URI.create(upstream.url + "/completion"))
+                    .timeout(Duration.ofSeconds(requestTimeoutSeconds))
+                    .header("Content-Type", "application/json")
+                    .header("Accept", "text/event-stream")
+                    .POST(HttpRequest.BodyPublishers.ofByteArray(body))
+                    .build();
+
+            HttpResponse<Stream<String>> response;
+            try {
+                response = httpClient.send(request, HttpResponse.BodyHandlers.ofLines());
+            } catch (IOException e) {
+                upstream.recordFailure(failureThreshold);
+                throw new Exception("Failed to generate text from LLaMA server: " + e.getMessage());
+            }
+
+            try (Stream<String> lines = response.body()) {
+                int status = response.statusCode();
+                if (status != 200) {
+                    // A 4xx means the server is up and rejected this request
+                    if (status >= 500) {
+                        upstream.recordFailure(failureThreshold);
+                    } else {
+                        upstream.recordSuccess();
+                    }
+                    throw new Exception("Failed to generate text from LLaMA server: HTTP " + status
+                            + " " + String.join("\n", (Iterable<String>) lines::iterator));
+                }
 
-            // Parse JSON response to extract content
-            JsonNode jsonNode = objectMapper.readTree(response);
-            JsonNode contentNode = jsonNode.get("content");
+                StringBuilder text = new StringBuilder();
+                try {
+                    readEvents(lines.iterator(), text, callback);
+                } catch (CallbackFailure e) {
+                    // The caller gave up, e.g. its client went away; the upstream is fine
+                    throw e.getCause();
+                } catch (IOException | UncheckedIOException e) {
+                    upstream.recordFailure(failureThreshold);
+                    throw new Exception("Failed to generate text from LLaMA server: " + e.getMessage());
+                }
+                upstream.recordSuccess();
+                return text.toString().trim();
+            }
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            throw new Exception("Failed to generate text from LLaMA server: interrupted");
+        } finally {
+            upstream.outstanding.decrementAndGet();
+            if (trial) {
+                upstream.endTrial();
+            }
+        }
+    }
+
+    private Map<String, Object> requestBody(String prompt, SamplingParams params) {
+        Map<String, Object> requestBody = new HashMap<>();
+        requestBody.put("prompt", prompt);
+        if (params == null) {
+            requestBody.put("n_predict", 256);
+            requestBody.put("temperature", 0.7);
+            requestBody.put("top_p", 0.9);
+            requestBody.put("top_k", 40);
+        } else {
+            requestBody.put("n_predict", params.getMaxTokens());
+            requestBody.put("temperature", params.getTemperature());
+            requestBody.put("top_p", params.getTopP());
+            requestBody.put("top_k", params.getTopK());
+            requestBody.put("seed", params.getSeed());
+            if (params.getSessionId() != null) {
+                requestBody.put("cache_prompt", true); // llama-server reuses the slot's cached prefix
+            }
+            // llama-server converts the schema itself
+            if (params.getGrammar() != null) {
+                requestBody.put("grammar", params.getGrammar());
+            }
+            if (params.getJsonSchema() != null) {
+                requestBody.put("json_schema", params.getJsonSchema());
+            }
+        }
+        requestBody.put("repeat_penalty", 1.1);
+        requestBody.put("stream", true);
+        return requestBody;
+    }
 
-            if (contentNode != null) {
-                return contentNode.asText().trim();
-            } else {
-                return "Error: No content in response";
+    // llama-server streams "data: {json}" lines separated by blank lines; the last one has
+    // "stop": true. A failure mid-stream arrives as an "error: {json}" line.
+    private void readEvents(Iterator<String> lines, StringBuilder text, TokenCallback callback)
+            throws IOException {
+        while (lines.hasNext()) {
+            String line = lines.next();
+            if (line.startsWith("error:")) {
+                throw new IOException("stream error " + line.substring(6).trim());
+            }
+            if (!line.startsWith("data:")) {
+                continue;
             }
+            JsonNode event = objectMapper.readTree(line.substring(5).trim());
+            JsonNode content = event.get("content");
+            if (content != null && !content.asText().isEmpty()) {
+                String piece = content.asText();
+                text.append(piece);
+                try {
+                    callback.onToken(piece);
+                } catch (RuntimeException e) {
+                    throw new CallbackFailure(e);
+                }
+            }
+            if (event.path("stop").asBoolean(false)) {
+                return;
+            }
+        }
+        throw new IOException("stream ended before the completion finished");
+    }
 
-        } catch (Exception e) {
-            throw new Exception("Failed to generate text from LLaMA server: " + e.getMessage());
+    // Least outstanding requests among upstreams whose circuit lets traffic through
+    Upstream selectUpstream() {
+        Upstream best = null;
+        int bestOutstanding = Integer.MAX_VALUE;
+        for (Upstream upstream : upstreams) {
+            if (!upstream.admitsRequests()) {
+                continue;
+            }
+            int outstanding = upstream.outstanding.get();
+            if (outstanding < bestOutstanding) {
+                best = upstream;
+                bestOutstanding = outstanding;
+            }
         }
+        return best;
     }
 
+    /**
+     * Whether requests should go to llama-server, i.e. selectUpstream has an upstream to pick.
+     * A HALF_OPEN upstream whose trial is in flight does not count, so other requests fall
+     * back to the JNI backend meanwhile. Reads cached state, so it costs nothing on the
+     * request path.
+     */
     public boolean isServerRunning() {
-        try {
-            Map<String, Object> testRequest = new HashMap<>();
-            testRequest.put("prompt", "test");
-            testRequest.put("n_predict", 1);
-
-            HttpHeaders headers = new HttpHeaders();
-            headers.setContentType(MediaType.APPLICATION_JSON);
-            HttpEntity<Map<String, Object>> entity = new HttpEntity<>(testRequest, headers);
-
-            restTemplate.postForObject(llamaServerUrl, entity, String.class);
-            return true;
-        } catch (Exception e) {
-            return false;
+        for (Upstream upstream : upstreams) {
+            if (upstream.admitsRequests()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** The most available state across upstreams. */
+    public CircuitState getCircuitState() {
+        CircuitState best = CircuitState.OPEN;
+        for (Upstream upstream : upstreams) {
+            CircuitState state = upstream.state();
+            if (state == CircuitState.CLOSED) {
+                return state;
+            }
+            if (state == CircuitState.HALF_OPEN) {
+                best = state;
+            }
+        }
+        return best;
+    }
+
+    /** Circuit state per upstream URL, in configuration order. */
+    public Map<String, CircuitState> getUpstreamStates() {
+        Map<String, CircuitState> states = new LinkedHashMap<>();
+        for (Upstream upstream : upstreams) {
+            states.put(upstream.url, upstream.state());
+        }
+        return states;
+    }
+
+    // llama-server answers /health with 503 while it is still loading the model
+    void checkHealth() {
+        for (Upstream upstream : upstreams) {
+            HttpRequest request = HttpRequest.newBuilder(URI.create(upstream.url + "/health"))
+                    .timeout(Duration.ofMillis(healthTimeoutMs))
+                    .GET()
+                    .build();
+            try {
+                HttpResponse<Void> response = httpClient.send(request, HttpResponse.BodyHandlers.discarding());
+                if (response.statusCode() == 200) {
+                    upstream.probeSucceeded();
+                    continue;
+                }
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                return;
+            } catch (Exception e) {
+                // Counted as a failure below
+            }
+            upstream.recordProbeFailure(failureThreshold);
         }
     }
 }
@@ -0,0 +1,145 @@
+package com.livecoding.demo;
+
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.function.LongSupplier;
+
+/**
+ * Generated text of deterministic requests, keyed by model, sanitized prompt and sampling
+ * settings, grammar included. Bounded by an estimate of the bytes held (keys and values as
+ * UTF-16 plus a fixed overhead per entry); the least recently used entries go first, and
+ * entries older than the TTL are dropped when next looked up. Keys carry the model's generation,
+ * which invalidate bumps, so text of a request that started before a reload is not stored.
+ */
+final class ResponseCache {
+    private static final long ENTRY_OVERHEAD_BYTES = 128;
+
+    record Key(String model, long generation, String prompt, int maxTokens, float temperature, int topK, float topP, long seed,
+            String grammar) {
+    }
+
+    private record Entry(String text, long bytes, long expiresAt) {
+    }
+
+    private final long maxBytes;
+    private final long ttlNanos;                // 0: entries never expire
+    private final LongSupplier clock;
+
+    // Access order, so iteration starts at the least recently used entry
+    private final LinkedHashMap<Key, Entry> entries = new LinkedHashMap<>(16, 0.75f, true);
+    private long bytes;                         // guarded by this
+    private final Map<String, Long> generations = new HashMap<>(); // guarded by this; absent is 0
+
+    private final LongAdder hits = new LongAdder();
+    private final LongAdder misses = new LongAdder();
+    private final LongAdder evictions = new LongAdder();
+
+    ResponseCache(long maxBytes, long ttlSeconds) {
+        this(maxBytes, ttlSeconds, System::nanoTime);
+    }
+
+    ResponseCache(long maxBytes, long ttlSeconds, LongSupplier clock) {
+        this.maxBytes = maxBytes;
+        this.ttlNanos = TimeUnit.SECONDS.toNanos(ttlSeconds);
+        this.clock = clock;
+    }
+
+    /** Key for a request about to run; take it before generating so a reload meanwhile is noticed. */
+    Key key(String modelId, String prompt, SamplingParams params) {
+        long generation;
+        synchronized (this) {
+            generation = generations.getOrDefault(modelId, 0L);
+        }
+        if (params == null) {
+            return new Key(modelId, generation, prompt, SamplingParams.DEFAULT_MAX_TOKENS, SamplingParams.DEFAULT_TEMPERATURE,
+                    SamplingParams.DEFAULT_TOP_K, SamplingParams.DEFAULT_TOP_P, SamplingParams.DEFAULT_SEED, null);
+        }
+        return new Key(modelId, generation, prompt, params.getMaxTokens(), params.getTemperature(), params.getTopK(),
+                params.getTopP(), params.getSeed(), params.getGrammar());
+    }
+
+    /** The cached text, or null on a miss. */
+    String get(Key key) {
+        synchronized (this) {
+            Entry entry = entries.get(key);
+            if (entry != null && ttlNanos > 0 && clock.getAsLong() - entry.expiresAt() > 0) {
+                remove(key);
+                entry = null;
+            }
+            if (entry != null) {
+                hits.increment();
+                return entry.text();
+            }
+        }
+        misses.increment();
+        return null;
+    }
+
+    void put(Key key, String text) {
+        long size = ENTRY_OVERHEAD_BYTES + 2L * (key.prompt().length() + text.length()
+                + (key.grammar() != null ? key.grammar().length() : 0));
+        if (size > maxBytes) {
+            return;
+        }
+        synchronized (this) {
+            // The model was reloaded since the key was taken, so the text may be the old model's
+            if (key.generation() != generations.getOrDefault(key.model(), 0L)) {
+                return;
+            }
+            remove(key);
+            entries.put(key, new Entry(text, size, clock.getAsLong() + ttlNanos));
+            bytes += size;
+
+            Iterator<Entry> eldest = entries.values().iterator();
+            while (bytes > maxBytes && eldest.hasNext()) {
+                bytes -= eldest.next().bytes();
+                eldest.remove();
+                evictions.increment();
+            }
+        }
+    }
+
+    /** Drops every entry of the model, e.g. once it was reloaded with new weights. */
+    synchronized void invalidate(String modelId) {
+        generations.merge(modelId, 1L, Long::sum);
+        Iterator<Map.Entry<Key, Entry>> it = entries.entrySet().iterator();
+        while (it.hasNext()) {
+            Map.Entry<Key, Entry> entry = it.next();
+            if (entry.getKey().model().equals(modelId)) {
+                bytes -= entry.getValue().bytes();
+                it.remove();
+            }
+        }
+    }
+
+    private void remove(Key key) {
+        Entry previous = entries.remove(key);
+        if (previous != null) {
+            bytes -= previous.bytes();
+        }
+    }
+
+    long hits() {
+        return hits.sum();
+    }
+
+    long misses() {
+        return misses.sum();
+    }
+
+    long evictions() {
+        return evictions.sum();
+    }
+
+    synchronized int size() {
+        return entries.size();
+    }
+
+    synchronized long bytes() {
+        return bytes;
+    }
+}
@@ -0,0 +1,142 @@
+package com.livecoding.demo;
+
+import java.util.Map;
+
+/**
+ * Per-request generation settings passed to LlamaJNI.generateText.
+ * Defaults mirror the native ones; field names are read by llama_jni.c.
+ * Requests with equal settings share a pooled native sampler chain.
+ * Turns that pass the same sessionId continue from the KV state of the previous turn.
+ * model picks one of the configured models; it is resolved in Java, not read natively.
+ * tenant and priority only steer Java-side admission (see AdmissionScheduler).
+ * grammar (GBNF) constrains the output in the native sampler chain; jsonSchema is converted
+ * to one by LlamaService (see JsonSchemaGrammar), so at most one of the two may be set.
+ */
+public class SamplingParams {
+    public static final int DEFAULT_MAX_TOKENS = 512;
+    public static final float DEFAULT_TEMPERATURE = 0.8f;
+    public static final int DEFAULT_TOP_K = 40;
+    public static final float DEFAULT_TOP_P = 0.9f;
+    public static final long DEFAULT_SEED = 42;
+    public static final int MAX_SESSION_ID_LENGTH = 256;
+    public static final int MAX_MODEL_ID_LENGTH = 128;
+    public static final int MAX_TENANT_LENGTH = 128;
+    public static final int MAX_GRAMMAR_LENGTH = 65536;
+
+    private int maxTokens = DEFAULT_MAX_TOKENS;
+    private float temperature = DEFAULT_TEMPERATURE;  // 0 samples greedily
+    private int topK = DEFAULT_TOP_K;                 // 0 disables top-k
+    private float topP = DEFAULT_TOP_P;               // 1 disables top-p
+    private long seed = DEFAULT_SEED;                 // 0..2^32-1
+    private String sessionId;                         // conversation whose KV state is kept between turns
+    private String model;                             // registry id, null = LlamaService.DEFAULT_MODEL_ID
+    private String tenant;                            // fair-share key, null = AdmissionScheduler.DEFAULT_TENANT
+    private AdmissionScheduler.Priority priority;     // null = interactive, batch for generateBatch
+    private String grammar;                           // GBNF with a "root" rule, null = unconstrained
+    private Map<String, Object> jsonSchema;           // parsed JSON schema the output must match
+
+    public SamplingParams() {
+    }
+
+    public SamplingParams(SamplingParams other) {
+        this.maxTokens = other.maxTokens;
+        this.temperature = other.temperature;
+        this.topK = other.topK;
+        this.topP = other.topP;
+        this.seed = other.seed;
+        this.sessionId = other.sessionId;
+        this.model = other.model;
+        this.tenant = other.tenant;
+        this.priority = other.priority;
+        this.grammar = other.grammar;
+        this.jsonSchema = other.jsonSchema;
+    }
+
+    public int getMaxTokens() {
+        return maxTokens;
+    }
+
+    public void setMaxTokens(int maxTokens) {
+        this.maxTokens = maxTokens;
+    }
+
+    public float getTemperature() {
+        return temperature;
+    }
+
+    public void setTemperature(float temperature) {
+        this.temperature = temperature;
+    }
+
+    public int getTopK() {
+        return topK;
+    }
+
+    public void setTopK(int topK) {
+        this.topK = topK;
+    }
+
+    public float getTopP() {
+        return topP;
+    }
+
+    public void setTopP(float topP) {
+        this.topP = topP;
+    }
+
+    public long getSeed() {
+        return seed;
+    }
+
+    public void setSeed(long seed) {
+        this.seed = seed;
+    }
+
+    public String getSessionId() {
+        return sessionId;
+    }
+
+    public void setSessionId(String sessionId) {
+        this.sessionId = sessionId;
+    }
+
+    public String getModel() {
+        return model;
+    }
+
+    public void setModel(String model) {
+        this.model = model;
+    }
+
+    public String getTenant() {
+        return tenant;
+    }
+
+    public void setTenant(String tenant) {
+        this.tenant = tenant;
+    }
+
+    public AdmissionScheduler.Priority getPriority() {
+        return priority;
+    }
+
+    public void setPriority(AdmissionScheduler.Priority priority) {
+        this.priority = priority;
+    }
+
+    public String getGrammar() {
+        return grammar;
+    }
+
+    public void setGrammar(String grammar) {
+        this.grammar = grammar;
+    }
+
+    public Map<String, Object> getJsonSchema() {
+        return jsonSchema;
+    }
+
+    public void setJsonSchema(Map<String, Object> jsonSchema) {
+        this.jsonSchema = jsonSchema;
+    }
+}
@@ -0,0 +1,10 @@
+package com.livecoding.demo;
+
+/**
+ * Receives generated text incrementally from the native streaming API.
+ * Invoked on the thread that called generateTextStreaming.
+ */
+@FunctionalInterface
+public interface TokenCallback {
+    void onToken(String piece);
+}
@@ -0,0 +1,120 @@
+package com.livecoding.demo;
+
+import org.junit.jupiter.api.AfterEach;
+import org.junit.jupiter.api.Test;
+
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+class AdmissionSchedulerTest {
+
+    private static final AdmissionScheduler.Priority INTERACTIVE = AdmissionScheduler.Priority.INTERACTIVE;
+    private static final AdmissionScheduler.Priority BATCH = AdmissionScheduler.Priority.BATCH;
+
+    private final ExecutorService pool = Executors.newCachedThreadPool();
+    private final List<String> order = Collections.synchronizedList(new ArrayList<>());
+
+    @AfterEach
+    void tearDown() {
+        pool.shutdownNow();
+    }
+
+    // Queues a request that records its name once admitted and returns at once
+    private Future<?> enqueue(AdmissionScheduler scheduler, String tenant, AdmissionScheduler.Priority priority,
+            String name) throws InterruptedException {
+        int queued = scheduler.getQueued(priority);
+        Future<?> future = pool.submit(() -> {
+            try (AdmissionScheduler.Permit permit = scheduler.acquire(tenant, priority, 1, 100, 10, TimeUnit.SECONDS)) {
+                order.add(name);
+            }
+            return null;
+        });
+        long deadline = System.nanoTime() + TimeUnit.SECONDS.toNanos(5);
+        while (scheduler.getQueued(priority) == queued && System.nanoTime() < deadline) {
+            Thread.sleep(1);
+        }
+        assertEquals(queued + 1, scheduler.getQueued(priority));
+        return future;
+    }
+
+    @Test
+    void testAcquire_InteractiveShouldGoBeforeEarlierBatch() throws Exception {
+        AdmissionScheduler scheduler = new AdmissionScheduler(1, 1, 8);
+        AdmissionScheduler.Permit running = scheduler.acquire(null, BATCH, 1, 100, 1, TimeUnit.SECONDS);
+
+        Future<?> batch = enqueue(scheduler, null, BATCH, "batch");
+        Future<?> interactive = enqueue(scheduler, null, INTERACTIVE, "interactive");
+        running.close();
+
+        interactive.get(5, TimeUnit.SECONDS);
+        batch.get(5, TimeUnit.SECONDS);
+        assertEquals(List.of("interactive", "batch"), order);
+    }
+
+    @Test
+    void testAcquire_BatchShouldNotExceedItsShare() throws Exception {
+        AdmissionScheduler scheduler = new AdmissionScheduler(4, 2, 8);
+        scheduler.acquire(null, BATCH, 1, 100, 1, TimeUnit.SECONDS);
+        scheduler.acquire(null, BATCH, 1, 100, 1, TimeUnit.SECONDS);
+
+        assertThrows(LlamaException.class,
+                () -> scheduler.acquire(null, BATCH, 1, 100, 50, TimeUnit.MILLISECONDS));
+        assertNotNull(scheduler.acquire(null, INTERACTIVE, 2, 100, 50, TimeUnit.MILLISECONDS));
+        assertEquals(4, scheduler.getInUse());
+    }
+
+    @Test
+    void testAcquire_TenantsShouldShareFairly() throws Exception {
+        AdmissionScheduler scheduler = new AdmissionScheduler(1, 1, 8);
+        AdmissionScheduler.Permit running = scheduler.acquire("other", INTERACTIVE, 1, 100, 1, TimeUnit.SECONDS);
+
+        List<Future<?>> futures = new ArrayList<>();
+        futures.add(enqueue(scheduler, "a", INTERACTIVE, "a1"));
+        futures.add(enqueue(scheduler, "a", INTERACTIVE, "a2"));
+        futures.add(enqueue(scheduler, "a", INTERACTIVE, "a3"));
+        futures.add(enqueue(scheduler, "b", INTERACTIVE, "b1"));
+        running.close();
+
+        for (Future<?> future : futures) {
+            future.get(5, TimeUnit.SECONDS);
+        }
+        // b1 arrived last but a had two requests ahead of it already
+        assertEquals(List.of("a1", "b1", "a2", "a3"), order);
+    }
+
+    @Test
+    void testAcquire_FullQueueShouldRejectAtOnce() throws Exception {
+        AdmissionScheduler scheduler = new AdmissionScheduler(1, 1, 1);
+        AdmissionScheduler.Permit running = scheduler.acquire(null, INTERACTIVE, 1, 100, 1, TimeUnit.SECONDS);
+        Future<?> queued = enqueue(scheduler, null, INTERACTIVE, "queued");
+
+        long start = System.nanoTime();
+        assertThrows(LlamaOverloadedException.class,
+                () -> scheduler.acquire(null, INTERACTIVE, 1, 100, 10, TimeUnit.SECONDS));
+        assertTrue(System.nanoTime() - start < TimeUnit.SECONDS.toNanos(1));
+        assertEquals(1, scheduler.getRejected());
+
+        running.close();
+        queued.get(5, TimeUnit.SECONDS);
+        assertEquals(0, scheduler.getInUse());
+    }
+
+    @Test
+    void testPermit_CloseTwice_ShouldReleaseOnce() throws Exception {
+        AdmissionScheduler scheduler = new AdmissionScheduler(2, 1, 8);
+        AdmissionScheduler.Permit first = scheduler.acquire(null, INTERACTIVE, 1, 100, 1, TimeUnit.SECONDS);
+        scheduler.acquire(null, INTERACTIVE, 1, 100, 1, TimeUnit.SECONDS);
+
+        first.close();
+        first.close();
+
+        assertEquals(1, scheduler.getInUse());
+    }
+}
@@ -0,0 +1,66 @@
+package com.livecoding.demo;
+
+import org.junit.jupiter.api.Test;
+import org.springframework.beans.factory.annotation.Value;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.lang.reflect.Field;
+import java.util.Arrays;
+import java.util.Properties;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+// Reads the application.properties that the build copies to the classpath, not a test copy
+class ApplicationPropertiesTest {
+
+    private static Properties load() throws IOException {
+        try (InputStream in = ApplicationPropertiesTest.class.getResourceAsStream("/application.properties")) {
+            assertNotNull(in, "application.properties is not on the classpath; check the pom's resource includes");
+            Properties properties = new Properties();
+            properties.load(in);
+            return properties;
+        }
+    }
+
+    @Test
+    void testEveryInjectedSetting_ShouldBeInApplicationProperties() throws IOException {
+        Properties properties = load();
+        for (Class<?> type : new Class<?>[] { LlamaService.class, RealLlamaService.class }) {
+            for (Field field : type.getDeclaredFields()) {
+                Value value = field.getAnnotation(Value.class);
+                if (value == null) {
+                    continue;
+                }
+                String expression = value.value();
+                String key = expression.substring(2, expression.indexOf(':') > 0 ? expression.indexOf(':')
+                        : expression.indexOf('}'));
+                assertTrue(properties.containsKey(key), type.getSimpleName() + "." + field.getName()
+                        + " reads " + key + ", which application.properties does not set");
+            }
+        }
+    }
+
+    @Test
+    void testLoadSettings_ShouldComeFromTheFile() throws IOException {
+        Properties properties = load();
+        assertEquals("2048", properties.getProperty("llama.context.length"));
+        assertEquals("true", properties.getProperty("llama.use.mmap"));
+    }
+
+    @Test
+    void testPackagedDefaults_ShouldBePortable() throws IOException {
+        Properties properties = load();
+        // Same file name the @Value fallback uses; machine-specific paths belong outside the jar
+        assertEquals("Llama-3.2-3B-Instruct-Q3_K_L.gguf", properties.getProperty("llama.model.path"));
+        properties.stringPropertyNames().stream().filter(key -> key.startsWith("logging.level."))
+                .forEach(key -> assertEquals("INFO", properties.getProperty(key), key));
+    }
+
+    @Test
+    void testActuator_ShouldExposePrometheus() throws IOException {
+        // Without this the Micrometer meters are collected but /actuator/prometheus is a 404
+        String exposed = load().getProperty("management.endpoints.web.exposure.include", "");
+        assertTrue(Arrays.asList(exposed.split("\\s*,\\s*")).contains("prometheus"), exposed);
+    }
+}
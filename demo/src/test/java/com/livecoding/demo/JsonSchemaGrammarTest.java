@@ -0,0 +1,83 @@
+package com.livecoding.demo;
+
+import org.junit.jupiter.api.Test;
+
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+class JsonSchemaGrammarTest {
+
+    private static Map<String, Object> schema(Object... keyValues) {
+        Map<String, Object> schema = new LinkedHashMap<>();
+        for (int i = 0; i < keyValues.length; i += 2) {
+            schema.put((String) keyValues[i], keyValues[i + 1]);
+        }
+        return schema;
+    }
+
+    @Test
+    void testToGrammar_RequiredAndOptionalProperties_ShouldKeepSchemaOrder() throws LlamaException {
+        String grammar = JsonSchemaGrammar.toGrammar(schema(
+                "type", "object",
+                "properties", schema(
+                        "name", schema("type", "string"),
+                        "age", schema("type", "integer"),
+                        "tags", schema("type", "array", "items", schema("type", "string"))),
+                "required", List.of("name")));
+
+        assertTrue(grammar.startsWith("root ::= \"{\" space root-name-kv ( \",\" space ( root-age-kv root-age-kv-rest"
+                + " | root-tags-kv ) )? \"}\" space\n"), grammar);
+        assertTrue(grammar.contains("\nroot-name-kv ::= \"\\\"name\\\"\" space \":\" space root-name\n"), grammar);
+        assertTrue(grammar.contains("\nroot-age-kv-rest ::= ( \",\" space root-tags-kv )?\n"), grammar);
+        assertTrue(grammar.contains("\nroot-tags ::= \"[\" space ( root-tags-item (\",\" space root-tags-item)* )?"
+                + " \"]\" space\n"), grammar);
+        assertTrue(grammar.contains("\ninteger ::= "), grammar);
+        assertFalse(grammar.contains("\nnumber ::= "), grammar);
+    }
+
+    @Test
+    void testToGrammar_EnumAndBounds_ShouldBecomeLiteralsAndRepetitions() throws LlamaException {
+        String grammar = JsonSchemaGrammar.toGrammar(schema(
+                "type", "object",
+                "properties", schema(
+                        "mood", schema("enum", List.of("happy", "say \"hi\"", 3)),
+                        "code", schema("type", "string", "minLength", 2, "maxLength", 4),
+                        "pair", schema("type", "array", "minItems", 2, "maxItems", 2)),
+                "required", List.of("mood", "code", "pair")));
+
+        assertTrue(grammar.contains("\nroot-mood ::= (\"\\\"happy\\\"\" | \"\\\"say \\\\\\\"hi\\\\\\\"\\\"\" | \"3\") space\n"),
+                grammar);
+        assertTrue(grammar.contains("\nroot-code ::= \"\\\"\" char{2,4} \"\\\"\" space\n"), grammar);
+        assertTrue(grammar.contains("\nroot-pair ::= \"[\" space value (\",\" space value){1} \"]\" space\n"), grammar);
+    }
+
+    @Test
+    void testToGrammar_NoType_ShouldAcceptAnyValue() throws LlamaException {
+        String grammar = JsonSchemaGrammar.toGrammar(schema("description", "anything"));
+
+        assertTrue(grammar.startsWith("root ::= value\n"), grammar);
+        assertTrue(grammar.contains("\nobject ::= "), grammar);
+        assertTrue(grammar.contains("\narray ::= "), grammar);
+    }
+
+    @Test
+    void testToGrammar_UnsupportedSchema_ShouldThrow() {
+        Map<?, ?>[] schemas = {
+                schema("type", "string", "pattern", "^a+$"),
+                schema("$ref", "#/definitions/a"),
+                schema("type", "date"),
+                schema("type", "object", "properties", schema("a", schema()), "required", List.of("b")),
+                schema("type", "object", "properties", schema(), "additionalProperties", true),
+                schema("type", "array", "minItems", 3, "maxItems", 2)
+        };
+
+        for (Map<?, ?> schema : schemas) {
+            @SuppressWarnings("unchecked")
+            Map<String, Object> typed = (Map<String, Object>) schema;
+            assertThrows(LlamaException.class, () -> JsonSchemaGrammar.toGrammar(typed), schema.toString());
+        }
+    }
+}
@@ -5,12 +5,21 @@ import org.junit.jupiter.api.extension.ExtendWith;
 import org.mockito.InjectMocks;
 import org.mockito.Mock;
 import org.mockito.junit.jupiter.MockitoExtension;
+import org.springframework.http.HttpStatus;
 import org.springframework.http.ResponseEntity;
 
+import java.util.Arrays;
+import java.util.List;
 import java.util.Map;
 
 import static org.junit.jupiter.api.Assertions.*;
+import static org.mockito.ArgumentMatchers.any;
 import static org.mockito.ArgumentMatchers.anyString;
+import static org.mockito.ArgumentMatchers.argThat;
+import static org.mockito.ArgumentMatchers.eq;
+import static org.mockito.ArgumentMatchers.isNull;
+import static org.mockito.Mockito.never;
+import static org.mockito.Mockito.verify;
 import static org.mockito.Mockito.when;
 
 @ExtendWith(MockitoExtension.class)
@@ -19,6 +28,9 @@ class LlamaControllerTest {
     @Mock
     private LlamaService llamaService;
 
+    @Mock
+    private RealLlamaService realLlamaService;
+
     @InjectMocks
     private LlamaController llamaController;
 
@@ -52,6 +64,20 @@ class LlamaControllerTest {
         assertEquals("Generated response", body.get("text"));
     }
 
+    @Test
+    void testGenerateGet_ServerAvailable_ShouldUseRealLlama() throws Exception {
+        when(realLlamaService.isServerRunning()).thenReturn(true);
+        when(realLlamaService.generateText(anyString())).thenReturn("Server response");
+
+        ResponseEntity<Map<String, Object>> response = llamaController.generateGet("Hello, world!");
+
+        assertTrue(response.getStatusCode().is2xxSuccessful());
+        Map<String, Object> body = response.getBody();
+        assertNotNull(body);
+        assertEquals("Server response", body.get("text"));
+        verify(llamaService, never()).generateText(anyString());
+    }
+
     @Test
     void testGenerateGet_EmptyPrompt_ShouldReturnError() {
         ResponseEntity<Map<String, Object>> response = llamaController.generateGet("");
@@ -80,10 +106,30 @@ class LlamaControllerTest {
         assertEquals("Invalid prompt", body.get("message"));
     }
 
+    @Test
+    void testGeneratePost_Overloaded_ShouldReturnTooManyRequests() throws Exception {
+        when(llamaService.generateText(anyString(), any(SamplingParams.class)))
+                .thenThrow(new LlamaOverloadedException("Server overloaded: 32 batch requests already queued"));
+
+        LlamaController.GenerateRequest request = new LlamaController.GenerateRequest();
+        request.setPrompt("test");
+        request.setTenant("team-a");
+        request.setPriority(AdmissionScheduler.Priority.BATCH);
+
+        ResponseEntity<Map<String, Object>> response = llamaController.generate(request);
+
+        assertEquals(HttpStatus.TOO_MANY_REQUESTS, response.getStatusCode());
+        assertEquals("1", response.getHeaders().getFirst("Retry-After"));
+        assertEquals("Server overloaded", response.getBody().get("error"));
+        verify(llamaService).generateText(eq("test"), argThat((SamplingParams params) ->
+                "team-a".equals(params.getTenant()) && params.getPriority() == AdmissionScheduler.Priority.BATCH));
+    }
+
     @Test
     void testStatus_ShouldReturnModelStatus() {
         when(llamaService.isModelLoaded()).thenReturn(true);
         when(llamaService.getModelStatus()).thenReturn("Model loaded");
+        when(llamaService.getWarmupState()).thenReturn(LlamaService.WarmupState.READY);
 
         ResponseEntity<Map<String, Object>> response = llamaController.getStatus();
 
@@ -93,5 +139,70 @@ class LlamaControllerTest {
         assertEquals("healthy", body.get("status"));
         assertEquals(true, body.get("model_loaded"));
         assertEquals("Model loaded", body.get("model_status"));
+        assertEquals("ready", body.get("warmup"));
+        assertEquals("jni", body.get("mode"));
+    }
+
+    @Test
+    void testStatus_ModelNotLoaded_ShouldSaySo() {
+        when(llamaService.isModelLoaded()).thenReturn(false);
+        when(llamaService.getWarmupState()).thenReturn(LlamaService.WarmupState.FAILED);
+
+        ResponseEntity<Map<String, Object>> response = llamaController.getStatus();
+
+        Map<String, Object> body = response.getBody();
+        assertNotNull(body);
+        assertEquals(false, body.get("model_loaded"));
+        assertEquals("jni", body.get("mode"));
+    }
+
+    @Test
+    void testGenerateBatch_ShouldReportEachResult() throws Exception {
+        when(llamaService.getMaxBatchPrompts()).thenReturn(64);
+        when(llamaService.generateBatch(eq(List.of("First", "Second")), isNull()))
+                .thenReturn(Arrays.asList("One", null));
+
+        LlamaController.BatchRequest request = new LlamaController.BatchRequest();
+        request.setPrompts(List.of("First", "Second"));
+
+        ResponseEntity<Map<String, Object>> response = llamaController.generateBatch(request);
+
+        assertTrue(response.getStatusCode().is2xxSuccessful());
+        Map<String, Object> body = response.getBody();
+        assertNotNull(body);
+        assertEquals(2, body.get("count"));
+        List<?> results = (List<?>) body.get("results");
+        assertEquals("One", ((Map<?, ?>) results.get(0)).get("text"));
+        assertEquals("error", ((Map<?, ?>) results.get(1)).get("status"));
+    }
+
+    @Test
+    void testChat_ShouldPassMessagesAndSchema() throws Exception {
+        List<ChatMessage> messages = List.of(new ChatMessage("system", "Answer in JSON"),
+                new ChatMessage("user", "Hi"));
+        Map<String, Object> schema = Map.of("type", "object");
+        when(llamaService.generateChat(eq(messages), argThat(params -> params != null
+                && schema.equals(params.getJsonSchema()) && params.getGrammar() == null)))
+                .thenReturn("{}");
+
+        LlamaController.ChatRequest request = new LlamaController.ChatRequest();
+        request.setMessages(messages);
+        request.setJsonSchema(schema);
+
+        ResponseEntity<Map<String, Object>> response = llamaController.chat(request);
+
+        assertTrue(response.getStatusCode().is2xxSuccessful());
+        Map<String, Object> body = response.getBody();
+        assertNotNull(body);
+        assertEquals("{}", body.get("text"));
+        assertEquals(2, body.get("messages"));
+    }
+
+    @Test
+    void testChat_NoMessages_ShouldReturnBadRequest() throws Exception {
+        ResponseEntity<Map<String, Object>> response = llamaController.chat(new LlamaController.ChatRequest());
+
+        assertEquals(HttpStatus.BAD_REQUEST, response.getStatusCode());
+        verify(llamaService, never()).generateChat(any(), any());
     }
 }
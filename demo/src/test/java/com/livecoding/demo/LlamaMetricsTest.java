@@ -0,0 +1,69 @@
+package com.livecoding.demo;
+
+import io.micrometer.core.instrument.FunctionTimer;
+import io.micrometer.core.instrument.simple.SimpleMeterRegistry;
+import org.junit.jupiter.api.BeforeEach;
+import org.junit.jupiter.api.Test;
+import org.junit.jupiter.api.extension.ExtendWith;
+import org.mockito.Mock;
+import org.mockito.junit.jupiter.MockitoExtension;
+import org.springframework.test.util.ReflectionTestUtils;
+
+import java.util.concurrent.TimeUnit;
+
+import static org.junit.jupiter.api.Assertions.*;
+import static org.mockito.ArgumentMatchers.*;
+import static org.mockito.Mockito.*;
+
+@ExtendWith(MockitoExtension.class)
+class LlamaMetricsTest {
+
+    @Mock
+    private LlamaJNIInterface llamaJNI;
+
+    private SimpleMeterRegistry registry;
+
+    @BeforeEach
+    void setUp() {
+        LlamaService llamaService = new LlamaService(llamaJNI);
+        ReflectionTestUtils.setField(llamaService, "modelPath", "test-model.gguf");
+        ReflectionTestUtils.setField(llamaService, "models", "small=small.gguf");
+
+        registry = new SimpleMeterRegistry();
+        new LlamaMetrics(llamaService).bindTo(registry);
+    }
+
+    @Test
+    void testBindTo_PublishesSnapshotPerModel() {
+        long[] values = new long[LlamaMetrics.SIZE];
+        values[LlamaMetrics.JOBS] = 7;
+        values[LlamaMetrics.PREFILLED] = 4;
+        values[LlamaMetrics.FIRST_TOKEN_TIME] = 2_000_000;
+        values[LlamaMetrics.PERF_EVAL_TIME] = 1_500_000;
+        values[LlamaMetrics.QUEUED] = 3;
+        values[LlamaMetrics.KV_CELLS_USED] = 512;
+        when(llamaJNI.getMetrics(LlamaService.DEFAULT_MODEL_ID)).thenReturn(values);
+
+        assertEquals(7.0, registry.get("llama.jobs").tag("model", "default").functionCounter().count());
+        assertEquals(3.0, registry.get("llama.queue.depth").tag("model", "default").gauge().value());
+        assertEquals(512.0, registry.get("llama.kv.cells.used").tag("model", "default").gauge().value());
+        assertEquals(1.5, registry.get("llama.context.eval.time").tag("model", "default").functionCounter().count());
+
+        FunctionTimer ttft = registry.get("llama.time.to.first.token").tag("model", "default").functionTimer();
+        assertEquals(4.0, ttft.count());
+        assertEquals(2.0, ttft.totalTime(TimeUnit.SECONDS));
+        assertEquals(0.5, ttft.mean(TimeUnit.SECONDS));
+
+        // One native call serves every meter read within the refresh interval
+        verify(llamaJNI, times(1)).getMetrics(LlamaService.DEFAULT_MODEL_ID);
+    }
+
+    @Test
+    void testBindTo_ModelNotResident_ReadsZeroWithoutLoading() {
+        when(llamaJNI.getMetrics("small")).thenReturn(null);
+
+        assertEquals(0.0, registry.get("llama.jobs").tag("model", "small").functionCounter().count());
+        assertEquals(0.0, registry.get("llama.sequences").tag("model", "small").gauge().value());
+        verify(llamaJNI, never()).acquireModel(any(), any(), any());
+    }
+}
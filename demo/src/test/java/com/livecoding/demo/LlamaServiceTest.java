@@ -3,10 +3,22 @@ package com.livecoding.demo;
 import org.junit.jupiter.api.Test;
 import org.junit.jupiter.api.BeforeEach;
 import org.junit.jupiter.api.extension.ExtendWith;
+import org.mockito.ArgumentCaptor;
 import org.mockito.Mock;
 import org.mockito.junit.jupiter.MockitoExtension;
 import org.springframework.test.util.ReflectionTestUtils;
 
+import java.nio.ByteBuffer;
+import java.nio.FloatBuffer;
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.TimeUnit;
+
 import static org.junit.jupiter.api.Assertions.*;
 import static org.mockito.ArgumentMatchers.*;
 import static org.mockito.Mockito.*;
@@ -29,7 +41,7 @@ class LlamaServiceTest {
 
     @Test
     void testValidatePrompt_ValidPrompt_ShouldPass() {
-        when(llamaJNI.loadModel(anyString())).thenReturn(1L);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
         when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
 
         assertDoesNotThrow(() -> {
@@ -68,7 +80,7 @@ class LlamaServiceTest {
 
     @Test
     void testSanitizePrompt_ControlCharacters_ShouldBeRemoved() {
-        when(llamaJNI.loadModel(anyString())).thenReturn(1L);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
         when(llamaJNI.generateText(eq(1L), eq("HelloWorld"))).thenReturn("Response");
 
         assertDoesNotThrow(() -> {
@@ -86,7 +98,9 @@ class LlamaServiceTest {
                 "system(\"rm -rf /\")",
                 "exec(malicious_code)",
                 "Load malicious.dll",
-                "Run cmd.exe"
+                "Run cmd.exe",
+                "EXEC(malicious_code)",
+                "start PowerShell"
         };
 
         for (String prompt : suspiciousPrompts) {
@@ -98,7 +112,7 @@ class LlamaServiceTest {
 
     @Test
     void testModelLoading_FailedLoad_ShouldThrow() {
-        when(llamaJNI.loadModel(anyString())).thenReturn(0L); // Indicates failure
+        when(llamaJNI.acquireModel(anyString(), anyString(), any())).thenReturn(0L); // Indicates failure
 
         assertThrows(LlamaException.class, () -> {
             llamaService.generateText("Valid prompt");
@@ -107,10 +121,539 @@ class LlamaServiceTest {
 
     @Test
     void testModelLoading_ExceptionDuringLoad_ShouldThrow() {
-        when(llamaJNI.loadModel(anyString())).thenThrow(new RuntimeException("Native error"));
+        when(llamaJNI.acquireModel(anyString(), anyString(), any())).thenThrow(new RuntimeException("Native error"));
 
         assertThrows(LlamaException.class, () -> {
             llamaService.generateText("Valid prompt");
         });
     }
+
+    @Test
+    void testModelLoading_ConfiguredOptions_ShouldUseOptionsOverload() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "contextLength", 4096);
+        ReflectionTestUtils.setField(llamaService, "threads", 16);
+        ReflectionTestUtils.setField(llamaService, "gpuLayers", 20);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), any(LoadOptions.class)))
+                .thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
+
+        assertEquals("Generated text", llamaService.generateText("Valid prompt"));
+        verify(llamaJNI).acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), argThat((LoadOptions options) ->
+                options.getContextLength() == 4096 && options.getThreads() == 16
+                        && options.getGpuLayers() == 20 && options.isUseMmap()));
+        verify(llamaJNI, never()).acquireModel(anyString(), anyString(), isNull());
+    }
+
+    @Test
+    void testModelLoading_CpuSets_ShouldPassAffinitySettings() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "cpuSets", " 0-15;16-31 ");
+        ReflectionTestUtils.setField(llamaService, "numa", "Interleave");
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), any(LoadOptions.class)))
+                .thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
+
+        assertEquals("Generated text", llamaService.generateText("Valid prompt"));
+        verify(llamaJNI).acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), argThat((LoadOptions options) ->
+                "0-15;16-31".equals(options.getCpuSets()) && "interleave".equals(options.getNuma())));
+    }
+
+    @Test
+    void testModelLoading_FlashAttention_ShouldPassModeAndDefaultToAuto() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "flashAttention", " Off ");
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), any(LoadOptions.class)))
+                .thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
+
+        assertEquals("Generated text", llamaService.generateText("Valid prompt"));
+        verify(llamaJNI).acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), argThat((LoadOptions options) ->
+                "off".equals(options.getFlashAttention())));
+
+        // "auto" leaves llama.cpp's own choice, so it alone does not make the options non-default
+        LoadOptions options = new LoadOptions();
+        options.setFlashAttention("auto");
+        assertTrue(options.isDefault());
+    }
+
+    @Test
+    void testModelLoading_DraftModel_ShouldPassDraftSettings() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "draftModelPath", "draft-model.gguf");
+        ReflectionTestUtils.setField(llamaService, "draftTokens", 6);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), any(LoadOptions.class)))
+                .thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
+
+        assertEquals("Generated text", llamaService.generateText("Valid prompt"));
+        verify(llamaJNI).acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), argThat((LoadOptions options) ->
+                "draft-model.gguf".equals(options.getDraftModelPath()) && options.getDraftTokens() == 6));
+    }
+
+    @Test
+    void testModelLoading_SessionStore_ShouldPassSessionSettings() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "sessionMemoryMb", 256);
+        ReflectionTestUtils.setField(llamaService, "sessionDiskMb", 2048);
+        ReflectionTestUtils.setField(llamaService, "sessionDir", "/var/cache/llama");
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), any(LoadOptions.class)))
+                .thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
+
+        assertEquals("Generated text", llamaService.generateText("Valid prompt"));
+        verify(llamaJNI).acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), argThat((LoadOptions options) ->
+                options.getSessionMemoryMb() == 256 && options.getSessionDiskMb() == 2048
+                        && "/var/cache/llama".equals(options.getSessionDir())));
+    }
+
+    @Test
+    void testModelLoading_ContextShift_ShouldPassOverflowSettings() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "contextShift", true);
+        ReflectionTestUtils.setField(llamaService, "keepTokens", 64);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), any(LoadOptions.class)))
+                .thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
+
+        assertEquals("Generated text", llamaService.generateText("Valid prompt"));
+        verify(llamaJNI).acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), argThat((LoadOptions options) ->
+                options.isContextShift() && options.getKeepTokens() == 64));
+    }
+
+    @Test
+    void testGenerateText_NamedModel_ShouldAcquireAndReleaseIt() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "models", "code=/models/code.gguf, chat=/models/chat.gguf");
+        SamplingParams params = new SamplingParams();
+        params.setModel("code");
+        when(llamaJNI.acquireModel(eq("code"), eq("/models/code.gguf"), isNull())).thenReturn(2L);
+        when(llamaJNI.generateText(eq(2L), eq("Valid prompt"), same(params))).thenReturn("Code text");
+
+        assertEquals("Code text", llamaService.generateText("Valid prompt", params));
+        verify(llamaJNI).releaseModel(2L);
+        assertEquals(Set.of(LlamaService.DEFAULT_MODEL_ID, "code", "chat"), llamaService.getModelIds());
+    }
+
+    @Test
+    void testGenerateText_UnknownModel_ShouldThrowWithoutNativeCall() {
+        SamplingParams params = new SamplingParams();
+        params.setModel("missing");
+
+        assertThrows(LlamaException.class, () -> llamaService.generateText("Valid prompt", params));
+        verifyNoInteractions(llamaJNI);
+    }
+
+    @Test
+    void testGenerateText_MemoryBudget_ShouldConfigureRegistryOnce() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "modelMemoryBudgetMb", 8192L);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Generated text");
+
+        llamaService.generateText("Valid prompt");
+        llamaService.generateText("Valid prompt");
+
+        verify(llamaJNI, times(1)).setModelMemoryBudget(8192L * 1024 * 1024);
+        verify(llamaJNI, times(2)).releaseModel(1L);
+    }
+
+    @Test
+    void testReloadModel_ShouldSwapNativelyAndRouteColdLoadsToNewPath() throws Exception {
+        when(llamaJNI.reloadModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model-v2.gguf"), isNull())).thenReturn(true);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model-v2.gguf"), isNull())).thenReturn(3L);
+        when(llamaJNI.generateText(eq(3L), eq("Valid prompt"))).thenReturn("New model text");
+
+        llamaService.reloadModel(null, "test-model-v2.gguf");
+
+        assertEquals("New model text", llamaService.generateText("Valid prompt"));
+        verify(llamaJNI, never()).evictModel(anyString());
+    }
+
+    @Test
+    void testReloadModel_FailedLoad_ShouldKeepOldPath() throws Exception {
+        when(llamaJNI.reloadModel(anyString(), anyString(), any())).thenReturn(false);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Old model text");
+
+        assertThrows(LlamaException.class, () -> llamaService.reloadModel(null, "broken.gguf"));
+
+        assertEquals("Old model text", llamaService.generateText("Valid prompt"));
+    }
+
+    @Test
+    void testWarmup_ShouldLoadWithWarmupOptionAndReportReady() {
+        ReflectionTestUtils.setField(llamaService, "warmupEnabled", true);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"),
+                argThat((LoadOptions options) -> options != null && options.isWarmup()))).thenReturn(1L);
+
+        llamaService.warmup();
+
+        assertEquals(LlamaService.WarmupState.READY, llamaService.getWarmupState());
+        assertTrue(llamaService.isReady());
+        verify(llamaJNI).releaseModel(1L);
+    }
+
+    @Test
+    void testWarmup_FailedLoad_ShouldReportNotReady() {
+        ReflectionTestUtils.setField(llamaService, "warmupEnabled", true);
+        when(llamaJNI.acquireModel(anyString(), anyString(), any())).thenReturn(0L);
+
+        llamaService.warmup();
+
+        assertEquals(LlamaService.WarmupState.FAILED, llamaService.getWarmupState());
+        assertFalse(llamaService.isReady());
+        assertNotNull(llamaService.getWarmupError());
+    }
+
+    @Test
+    void testGenerateTextStreaming_ShouldForwardCallbackToNative() throws Exception {
+        TokenCallback callback = piece -> { };
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateTextStreaming(eq(1L), eq("Valid prompt"), same(callback))).thenReturn("Streamed text");
+
+        assertEquals("Streamed text", llamaService.generateTextStreaming("Valid prompt", callback));
+        verify(llamaJNI).generateTextStreaming(eq(1L), eq("Valid prompt"), same(callback));
+    }
+
+    @Test
+    void testGenerateText_WithSamplingParams_ShouldUseParamsOverload() throws Exception {
+        SamplingParams params = new SamplingParams();
+        params.setMaxTokens(64);
+        params.setTemperature(0.0f);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"), same(params))).thenReturn("Greedy text");
+
+        assertEquals("Greedy text", llamaService.generateText("Valid prompt", params));
+        verify(llamaJNI, never()).generateText(anyLong(), anyString());
+    }
+
+    @Test
+    void testGenerateText_InvalidSamplingParams_ShouldThrow() {
+        SamplingParams negativeTemperature = new SamplingParams();
+        negativeTemperature.setTemperature(-0.5f);
+        SamplingParams zeroMaxTokens = new SamplingParams();
+        zeroMaxTokens.setMaxTokens(0);
+        SamplingParams topPAboveOne = new SamplingParams();
+        topPAboveOne.setTopP(1.5f);
+        SamplingParams emptySession = new SamplingParams();
+        emptySession.setSessionId("");
+        SamplingParams longSession = new SamplingParams();
+        longSession.setSessionId("s".repeat(SamplingParams.MAX_SESSION_ID_LENGTH + 1));
+
+        for (SamplingParams params : new SamplingParams[] { negativeTemperature, zeroMaxTokens, topPAboveOne,
+                emptySession, longSession }) {
+            assertThrows(LlamaException.class, () -> {
+                llamaService.generateText("Valid prompt", params);
+            });
+        }
+        verifyNoInteractions(llamaJNI);
+    }
+
+    @Test
+    void testGenerateText_DirectBuffers_ShouldPassBuffersToNative() throws Exception {
+        byte[] utf8 = "Emoji prompt \uD83D\uDE00".getBytes(StandardCharsets.UTF_8);
+        ByteBuffer prompt = ByteBuffer.allocateDirect(64);
+        prompt.put(utf8);
+        ByteBuffer output = ByteBuffer.allocateDirect(256);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), same(prompt), eq(utf8.length), isNull(), same(output))).thenReturn(42);
+
+        assertEquals(42, llamaService.generateText(prompt, utf8.length, null, output));
+    }
+
+    @Test
+    void testGenerateText_HeapBuffers_ShouldThrow() {
+        ByteBuffer prompt = ByteBuffer.wrap("Valid prompt".getBytes(StandardCharsets.UTF_8));
+        ByteBuffer output = ByteBuffer.allocateDirect(256);
+
+        assertThrows(LlamaException.class, () -> {
+            llamaService.generateText(prompt, prompt.capacity(), null, output);
+        });
+        verifyNoInteractions(llamaJNI);
+    }
+
+    @Test
+    void testGenerateTextStreaming_NullCallback_ShouldThrow() {
+        assertThrows(LlamaException.class, () -> {
+            llamaService.generateTextStreaming("Valid prompt", null);
+        });
+    }
+
+    @Test
+    void testGenerateTextAsync_ShouldCompleteFromListener() throws Exception {
+        ArgumentCaptor<CompletionListener> listener = ArgumentCaptor.forClass(CompletionListener.class);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.submitText(eq(1L), eq("Valid prompt"), isNull(), listener.capture())).thenReturn(7L);
+
+        CompletableFuture<String> future = llamaService.generateTextAsync("Valid prompt");
+        assertFalse(future.isDone());
+
+        listener.getValue().onComplete("Async text");
+        assertEquals("Async text", future.get(5, TimeUnit.SECONDS));
+    }
+
+    @Test
+    void testGenerateTextAsync_NativeError_ShouldFailFuture() throws Exception {
+        ArgumentCaptor<CompletionListener> listener = ArgumentCaptor.forClass(CompletionListener.class);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.submitText(eq(1L), eq("Valid prompt"), isNull(), listener.capture())).thenReturn(7L);
+
+        CompletableFuture<String> future = llamaService.generateTextAsync("Valid prompt");
+        listener.getValue().onError("Engine shutting down");
+
+        ExecutionException e = assertThrows(ExecutionException.class, () -> future.get(5, TimeUnit.SECONDS));
+        assertInstanceOf(LlamaException.class, e.getCause());
+    }
+
+    @Test
+    void testGenerateTextAsync_CancelledFuture_ShouldCancelNativeJob() {
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.submitText(eq(1L), eq("Valid prompt"), isNull(), any())).thenReturn(7L);
+
+        CompletableFuture<String> future = llamaService.generateTextAsync("Valid prompt");
+        assertTrue(future.cancel(false));
+
+        verify(llamaJNI).cancel(1L, 7L);
+    }
+
+    @Test
+    void testGenerateTextAsync_ShouldReleaseModelAfterNativeCompletion() throws Exception {
+        ArgumentCaptor<CompletionListener> listener = ArgumentCaptor.forClass(CompletionListener.class);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.submitText(eq(1L), eq("Valid prompt"), isNull(), listener.capture())).thenReturn(7L);
+
+        CompletableFuture<String> future = llamaService.generateTextAsync("Valid prompt");
+        verify(llamaJNI, never()).releaseModel(anyLong());
+
+        listener.getValue().onComplete("Async text");
+        assertEquals("Async text", future.get(5, TimeUnit.SECONDS));
+        verify(llamaJNI).releaseModel(1L);
+    }
+
+    @Test
+    void testGenerateTextAsync_InvalidPrompt_ShouldFailWithoutNativeCall() {
+        CompletableFuture<String> future = llamaService.generateTextAsync("");
+
+        assertTrue(future.isCompletedExceptionally());
+        verifyNoInteractions(llamaJNI);
+    }
+
+    @Test
+    void testGenerateBatch_ShouldPassAllPromptsInOneCall() throws LlamaException {
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateBatch(eq(1L), eq(new String[] {"First", "Second"}), isNull()))
+                .thenReturn(new String[] {"One", null});
+
+        List<String> results = llamaService.generateBatch(List.of("First", "Second"), null);
+
+        assertEquals(Arrays.asList("One", null), results);
+        verify(llamaJNI, times(1)).generateBatch(anyLong(), any(), any());
+        verify(llamaJNI).releaseModel(1L);
+    }
+
+    @Test
+    void testGenerateBatch_InvalidPrompt_ShouldFailBeforeNativeCall() {
+        assertThrows(LlamaException.class, () -> llamaService.generateBatch(List.of("Fine", " "), null));
+        verify(llamaJNI, never()).generateBatch(anyLong(), any(), any());
+    }
+
+    @Test
+    void testGenerateBatch_TooManyPrompts_ShouldThrow() {
+        ReflectionTestUtils.setField(llamaService, "maxBatchPrompts", 2);
+
+        LlamaException error = assertThrows(LlamaException.class,
+                () -> llamaService.generateBatch(List.of("a", "b", "c"), null));
+        assertTrue(error.getMessage().contains("Maximum per batch: 2"));
+    }
+
+    @Test
+    void testGenerateBatch_SessionId_ShouldThrow() {
+        SamplingParams params = new SamplingParams();
+        params.setSessionId("chat-1");
+
+        assertThrows(LlamaException.class, () -> llamaService.generateBatch(List.of("a"), params));
+    }
+
+    @Test
+    void testEmbed_ShouldSplitTheBufferIntoVectors() throws LlamaException {
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.getEmbeddingSize(1L)).thenReturn(2);
+        when(llamaJNI.embed(eq(1L), eq(new String[] {"a", "b"}), any(FloatBuffer.class), eq(true)))
+                .thenAnswer(invocation -> {
+                    FloatBuffer output = invocation.getArgument(2);
+                    output.put(0, 1f).put(1, 2f).put(2, 3f).put(3, 4f);
+                    return 2;
+                });
+
+        List<float[]> vectors = llamaService.embed(List.of("a", "b"), null, true);
+
+        assertEquals(2, vectors.size());
+        assertArrayEquals(new float[] {1f, 2f}, vectors.get(0));
+        assertArrayEquals(new float[] {3f, 4f}, vectors.get(1));
+        verify(llamaJNI).releaseModel(1L);
+    }
+
+    @Test
+    void testEmbed_HeapBuffer_ShouldThrow() {
+        assertThrows(LlamaException.class,
+                () -> llamaService.embed(List.of("a"), null, true, FloatBuffer.allocate(16)));
+        verify(llamaJNI, never()).embed(anyLong(), any(), any(), anyBoolean());
+    }
+
+    @Test
+    void testResponseCache_RepeatedRequest_ShouldSkipNative() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "responseCache", new ResponseCache(1 << 20, 60));
+        SamplingParams params = new SamplingParams();
+        params.setTemperature(0.0f);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"), same(params))).thenReturn("Greedy text");
+
+        assertEquals("Greedy text", llamaService.generateText("Valid prompt", params));
+        assertEquals("Greedy text", llamaService.generateText("Valid prompt", params));
+
+        StringBuilder streamed = new StringBuilder();
+        assertEquals("Greedy text", llamaService.generateTextStreaming("Valid prompt", params, streamed::append));
+        assertEquals("Greedy text", streamed.toString());
+
+        verify(llamaJNI, times(1)).generateText(eq(1L), eq("Valid prompt"), same(params));
+        verify(llamaJNI, times(1)).acquireModel(anyString(), anyString(), any());
+        verify(llamaJNI, never()).generateTextStreaming(anyLong(), anyString(), any(SamplingParams.class), any());
+    }
+
+    @Test
+    void testResponseCache_Session_ShouldAlwaysRunNative() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "responseCache", new ResponseCache(1 << 20, 60));
+        SamplingParams params = new SamplingParams();
+        params.setSessionId("chat-1");
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"), same(params))).thenReturn("First", "Second");
+
+        assertEquals("First", llamaService.generateText("Valid prompt", params));
+        assertEquals("Second", llamaService.generateText("Valid prompt", params));
+    }
+
+    @Test
+    void testResponseCache_Reload_ShouldDropModelEntries() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "responseCache", new ResponseCache(1 << 20, 60));
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), anyString(), isNull())).thenReturn(1L, 3L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenReturn("Old model text");
+        when(llamaJNI.generateText(eq(3L), eq("Valid prompt"))).thenReturn("New model text");
+        when(llamaJNI.reloadModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model-v2.gguf"), isNull())).thenReturn(true);
+
+        assertEquals("Old model text", llamaService.generateText("Valid prompt"));
+        llamaService.reloadModel(null, "test-model-v2.gguf");
+
+        assertEquals("New model text", llamaService.generateText("Valid prompt"));
+    }
+
+    @Test
+    void testResponseCache_ReloadDuringGeneration_ShouldNotCacheOldModelText() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "responseCache", new ResponseCache(1 << 20, 60));
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), anyString(), isNull())).thenReturn(1L, 3L);
+        when(llamaJNI.reloadModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model-v2.gguf"), isNull())).thenReturn(true);
+        // The reload lands while the old model is still generating, before its text is cached
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"))).thenAnswer(invocation -> {
+            llamaService.reloadModel(null, "test-model-v2.gguf");
+            return "Old model text";
+        });
+        when(llamaJNI.generateText(eq(3L), eq("Valid prompt"))).thenReturn("New model text");
+
+        assertEquals("Old model text", llamaService.generateText("Valid prompt"));
+
+        assertEquals("New model text", llamaService.generateText("Valid prompt"));
+        assertEquals(0, llamaService.getResponseCache().hits());
+    }
+
+    @Test
+    void testTokenize_ShouldTokenizeSanitizedTextAndReleaseModel() throws LlamaException {
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.tokenize(1L, "Hello")).thenReturn(new int[] { 1, 15043 });
+        when(llamaJNI.countTokens(1L, "Hello")).thenReturn(2);
+
+        assertArrayEquals(new int[] { 1, 15043 }, llamaService.tokenize("  Hello\u0000 ", null));
+        assertEquals(2, llamaService.countTokens("Hello", null));
+        verify(llamaJNI, times(2)).releaseModel(1L);
+    }
+
+    @Test
+    void testGenerateText_MaxPromptTokens_ShouldRejectBeforeGenerating() {
+        ReflectionTestUtils.setField(llamaService, "maxPromptTokens", 8);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.countTokens(1L, "Valid prompt")).thenReturn(9);
+
+        LlamaException e = assertThrows(LlamaException.class, () -> llamaService.generateText("Valid prompt"));
+        assertTrue(e.getMessage().contains("9 tokens"));
+        verify(llamaJNI, never()).generateText(anyLong(), anyString());
+        verify(llamaJNI).releaseModel(1L);
+    }
+
+    @Test
+    void testGenerateChat_ShouldPassSanitizedMessagesToNative() throws Exception {
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateChat(eq(1L), any(), any(), isNull())).thenReturn("Hi!");
+
+        String reply = llamaService.generateChat(List.of(
+                new ChatMessage("system", "Be brief."),
+                new ChatMessage("user", " Hello\u0001 ")), null);
+
+        assertEquals("Hi!", reply);
+        verify(llamaJNI).generateChat(eq(1L), aryEq(new String[] { "system", "user" }),
+                aryEq(new String[] { "Be brief.", "Hello" }), isNull());
+        verify(llamaJNI).releaseModel(1L);
+    }
+
+    @Test
+    void testGenerateChat_InvalidMessages_ShouldThrowWithoutNativeCall() {
+        assertThrows(LlamaException.class, () -> llamaService.generateChat(List.of(), null));
+        assertThrows(LlamaException.class, () -> llamaService.generateChat(
+                List.of(new ChatMessage("tool", "Hello")), null));
+        assertThrows(LlamaException.class, () -> llamaService.generateChat(
+                List.of(new ChatMessage("user", "   ")), null));
+        assertThrows(LlamaException.class, () -> llamaService.generateChat(
+                List.of(new ChatMessage("user", "Run cmd.exe")), null));
+        assertThrows(LlamaException.class, () -> llamaService.generateChat(
+                List.of(new ChatMessage("system", "a".repeat(600)), new ChatMessage("user", "b".repeat(600))), null));
+        verifyNoInteractions(llamaJNI);
+    }
+
+    @Test
+    void testGenerateChat_RepeatedConversation_ShouldHitResponseCache() throws Exception {
+        ReflectionTestUtils.setField(llamaService, "responseCache", new ResponseCache(1 << 20, 60));
+        SamplingParams params = new SamplingParams();
+        params.setTemperature(0.0f);
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateChat(eq(1L), any(), any(), same(params))).thenReturn("Hi!");
+        List<ChatMessage> messages = List.of(new ChatMessage("user", "Hello"));
+
+        assertEquals("Hi!", llamaService.generateChat(messages, params));
+        assertEquals("Hi!", llamaService.generateChat(messages, params));
+
+        verify(llamaJNI, times(1)).generateChat(eq(1L), any(), any(), same(params));
+        verify(llamaJNI, never()).generateText(anyLong(), anyString(), any(SamplingParams.class));
+    }
+
+    @Test
+    void testGenerateText_JsonSchema_ShouldPassConvertedGrammar() throws Exception {
+        SamplingParams params = new SamplingParams();
+        params.setJsonSchema(Map.of("type", "object",
+                "properties", Map.of("name", Map.of("type", "string")),
+                "required", List.of("name")));
+        when(llamaJNI.acquireModel(eq(LlamaService.DEFAULT_MODEL_ID), eq("test-model.gguf"), isNull())).thenReturn(1L);
+        when(llamaJNI.generateText(eq(1L), eq("Valid prompt"), any(SamplingParams.class))).thenReturn("{\"name\": \"x\"}");
+
+        assertEquals("{\"name\": \"x\"}", llamaService.generateText("Valid prompt", params));
+
+        verify(llamaJNI).generateText(eq(1L), eq("Valid prompt"), argThat(p -> p != params
+                && p.getJsonSchema() == null && p.getGrammar().startsWith("root ::= \"{\" space root-name-kv")));
+        assertNull(params.getGrammar());
+    }
+
+    @Test
+    void testGenerateText_InvalidGrammarSettings_ShouldThrowWithoutNativeCall() {
+        SamplingParams both = new SamplingParams();
+        both.setGrammar("root ::= \"a\"");
+        both.setJsonSchema(Map.of("type", "string"));
+        SamplingParams blank = new SamplingParams();
+        blank.setGrammar(" ");
+        SamplingParams unsupported = new SamplingParams();
+        unsupported.setJsonSchema(Map.of("type", "string", "pattern", "^a+$"));
+
+        for (SamplingParams params : new SamplingParams[] { both, blank, unsupported }) {
+            assertThrows(LlamaException.class, () -> llamaService.generateText("Valid prompt", params));
+        }
+        verifyNoInteractions(llamaJNI);
+    }
 }
@@ -0,0 +1,31 @@
+package com.livecoding.demo;
+
+import org.junit.jupiter.api.Test;
+
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+class NativeLibraryLoaderTest {
+
+    @Test
+    void testCandidateVariants_ShouldTryWidestSupportedFirst() {
+        assertEquals(List.of("avx512", "avx2", "generic"), NativeLibraryLoader.candidateVariants(null, 2));
+        assertEquals(List.of("avx2", "generic"), NativeLibraryLoader.candidateVariants("", 1));
+        assertEquals(List.of("generic"), NativeLibraryLoader.candidateVariants(null, 0));
+        // A newer probe may report levels this loader has no variant for
+        assertEquals(List.of("avx512", "avx2", "generic"), NativeLibraryLoader.candidateVariants(null, 7));
+    }
+
+    @Test
+    void testCandidateVariants_ConfiguredVariant_ShouldBeTheOnlyCandidate() {
+        assertEquals(List.of("avx2"), NativeLibraryLoader.candidateVariants("avx2", 0));
+        assertThrows(IllegalArgumentException.class, () -> NativeLibraryLoader.candidateVariants("sse2", 2));
+    }
+
+    @Test
+    void testVariantLibraryName_GenericShouldKeepTheBaseName() {
+        assertEquals("llama_jni", NativeLibraryLoader.variantLibraryName("llama_jni", "generic"));
+        assertEquals("llama_jni_avx512", NativeLibraryLoader.variantLibraryName("llama_jni", "avx512"));
+    }
+}
@@ -0,0 +1,197 @@
+package com.livecoding.demo;
+
+import com.sun.net.httpserver.HttpServer;
+import org.junit.jupiter.api.AfterEach;
+import org.junit.jupiter.api.BeforeEach;
+import org.junit.jupiter.api.Test;
+import org.springframework.test.util.ReflectionTestUtils;
+
+import java.io.IOException;
+import java.io.OutputStream;
+import java.net.InetSocketAddress;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.List;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+class RealLlamaServiceTest {
+
+    private RealLlamaService realLlamaService;
+    private HttpServer server;
+
+    @BeforeEach
+    void setUp() throws IOException {
+        // A stand-in llama-server that streams two chunks
+        server = HttpServer.create(new InetSocketAddress("127.0.0.1", 0), 0);
+        server.createContext("/completion", exchange -> {
+            exchange.getRequestBody().readAllBytes();
+            exchange.getResponseHeaders().add("Content-Type", "text/event-stream");
+            exchange.sendResponseHeaders(200, 0);
+            try (OutputStream out = exchange.getResponseBody()) {
+                out.write(("data: {\"content\":\" Hello\",\"stop\":false}\n\n"
+                        + "data: {\"content\":\" world\",\"stop\":false}\n\n"
+                        + "data: {\"content\":\"\",\"stop\":true}\n\n").getBytes(StandardCharsets.UTF_8));
+            }
+        });
+        server.createContext("/health", exchange -> {
+            exchange.sendResponseHeaders(200, -1);
+            exchange.close();
+        });
+        server.start();
+
+        // Not initialized, so no health checker runs; probes are driven by hand
+        realLlamaService = new RealLlamaService();
+        ReflectionTestUtils.setField(realLlamaService, "serverUrls",
+                "http://127.0.0.1:" + server.getAddress().getPort() + ", http://127.0.0.1:1/");
+        realLlamaService.configureUpstreams();
+    }
+
+    @AfterEach
+    void tearDown() {
+        server.stop(0);
+    }
+
+    private RealLlamaService.Upstream upstream(int index) {
+        List<RealLlamaService.Upstream> upstreams = getUpstreams();
+        return upstreams.get(index);
+    }
+
+    @SuppressWarnings("unchecked")
+    private List<RealLlamaService.Upstream> getUpstreams() {
+        return (List<RealLlamaService.Upstream>) ReflectionTestUtils.getField(realLlamaService, "upstreams");
+    }
+
+    @Test
+    void testCircuit_StartsOpenUntilAServerAnswers() {
+        assertEquals(RealLlamaService.CircuitState.OPEN, realLlamaService.getCircuitState());
+        assertFalse(realLlamaService.isServerRunning());
+    }
+
+    @Test
+    void testCheckHealth_OnlyReachableUpstreamTurnsHalfOpen() {
+        realLlamaService.checkHealth();
+
+        assertEquals(RealLlamaService.CircuitState.HALF_OPEN, upstream(0).state());
+        assertEquals(RealLlamaService.CircuitState.OPEN, upstream(1).state());
+        assertTrue(realLlamaService.isServerRunning());
+        assertSame(upstream(0), realLlamaService.selectUpstream());
+    }
+
+    @Test
+    void testCircuit_OpensAfterConsecutiveFailures() {
+        RealLlamaService.Upstream upstream = upstream(0);
+        upstream.recordSuccess();
+
+        upstream.recordFailure(3);
+        upstream.recordFailure(3);
+        assertEquals(RealLlamaService.CircuitState.CLOSED, upstream.state());
+
+        upstream.recordFailure(3);
+        assertEquals(RealLlamaService.CircuitState.OPEN, upstream.state());
+        assertFalse(realLlamaService.isServerRunning());
+    }
+
+    @Test
+    void testCircuit_HalfOpenTrialFailureReopens() {
+        RealLlamaService.Upstream upstream = upstream(0);
+        upstream.probeSucceeded();
+        assertEquals(RealLlamaService.CircuitState.HALF_OPEN, upstream.state());
+
+        upstream.recordFailure(3);
+        assertEquals(RealLlamaService.CircuitState.OPEN, upstream.state());
+    }
+
+    @Test
+    void testCircuit_PassingProbeDoesNotClearRequestFailures() {
+        RealLlamaService.Upstream upstream = upstream(0);
+        upstream.recordSuccess();
+
+        upstream.recordFailure(3);
+        upstream.recordFailure(3);
+        upstream.probeSucceeded();
+        upstream.recordFailure(3);
+
+        assertEquals(RealLlamaService.CircuitState.OPEN, upstream.state());
+    }
+
+    @Test
+    void testCircuit_HalfOpenAdmitsOneTrialAtATime() {
+        RealLlamaService.Upstream upstream = upstream(0);
+        upstream.probeSucceeded();
+
+        assertTrue(upstream.tryStartTrial());
+        assertFalse(upstream.tryStartTrial());
+        assertNull(realLlamaService.selectUpstream());
+
+        upstream.endTrial();
+        assertSame(upstream, realLlamaService.selectUpstream());
+    }
+
+    @Test
+    void testIsServerRunning_HalfOpenTrialInFlight_ShouldFallBackToJni() {
+        realLlamaService.checkHealth();
+        assertTrue(realLlamaService.isServerRunning());
+
+        assertTrue(upstream(0).tryStartTrial());
+        assertFalse(realLlamaService.isServerRunning());
+
+        upstream(0).endTrial();
+        assertTrue(realLlamaService.isServerRunning());
+    }
+
+    @Test
+    void testGenerateTextStreaming_CallbackFailureReleasesTrial() {
+        realLlamaService.checkHealth();
+
+        assertThrows(IllegalStateException.class, () ->
+                realLlamaService.generateTextStreaming("Hi", null, piece -> {
+                    throw new IllegalStateException("client gone");
+                }));
+
+        assertEquals(RealLlamaService.CircuitState.HALF_OPEN, upstream(0).state());
+        assertSame(upstream(0), realLlamaService.selectUpstream());
+    }
+
+    @Test
+    void testSelectUpstream_PrefersFewestOutstanding() {
+        upstream(0).recordSuccess();
+        upstream(1).recordSuccess();
+        upstream(0).outstanding.set(2);
+        upstream(1).outstanding.set(1);
+
+        assertSame(upstream(1), realLlamaService.selectUpstream());
+    }
+
+    @Test
+    void testGenerateTextStreaming_ForwardsChunksAndClosesCircuit() throws Exception {
+        realLlamaService.checkHealth();
+        List<String> pieces = new ArrayList<>();
+
+        String text = realLlamaService.generateTextStreaming("Hi", null, pieces::add);
+
+        assertEquals(List.of(" Hello", " world"), pieces);
+        assertEquals("Hello world", text);
+        assertEquals(RealLlamaService.CircuitState.CLOSED, upstream(0).state());
+        assertEquals(0, upstream(0).outstanding.get());
+    }
+
+    @Test
+    void testGenerateTextStreaming_CallbackFailureLeavesCircuitClosed() {
+        upstream(0).recordSuccess();
+
+        IllegalStateException error = assertThrows(IllegalStateException.class, () ->
+                realLlamaService.generateTextStreaming("Hi", null, piece -> {
+                    throw new IllegalStateException("client gone");
+                }));
+
+        assertEquals("client gone", error.getMessage());
+        assertEquals(RealLlamaService.CircuitState.CLOSED, upstream(0).state());
+    }
+
+    @Test
+    void testGenerateText_NoUpstreamAvailable_Throws() {
+        Exception error = assertThrows(Exception.class, () -> realLlamaService.generateText("Hi"));
+        assertTrue(error.getMessage().contains("no upstream available"));
+    }
+}
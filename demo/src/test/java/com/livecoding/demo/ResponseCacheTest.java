@@ -0,0 +1,105 @@
+package com.livecoding.demo;
+
+import org.junit.jupiter.api.Test;
+
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+class ResponseCacheTest {
+
+    private static ResponseCache.Key key(ResponseCache cache, String model, String prompt) {
+        return cache.key(model, prompt, null);
+    }
+
+    @Test
+    void testGet_ShouldCountHitsAndMisses() {
+        ResponseCache cache = new ResponseCache(1 << 20, 60);
+
+        assertNull(cache.get(key(cache, "default", "a")));
+        cache.put(key(cache, "default", "a"), "text");
+
+        assertEquals("text", cache.get(key(cache, "default", "a")));
+        assertEquals(1, cache.hits());
+        assertEquals(1, cache.misses());
+    }
+
+    @Test
+    void testKey_ShouldIncludeSamplingParams() {
+        ResponseCache cache = new ResponseCache(1 << 20, 60);
+        SamplingParams seeded = new SamplingParams();
+        seeded.setSeed(7);
+        cache.put(cache.key(cache, "default", "a", seeded), "seed 7");
+
+        assertNull(cache.get(key(cache, "default", "a")));
+        assertNull(cache.get(key(cache, "small", "a")));
+        assertEquals("seed 7", cache.get(cache.key(cache, "default", "a", seeded)));
+    }
+
+    @Test
+    void testPut_OverBudget_ShouldEvictLeastRecentlyUsed() {
+        // Each entry: 128 overhead + 2 * (1 + 10) chars = 150 bytes
+        ResponseCache cache = new ResponseCache(450, 0);
+        cache.put(key(cache, "default", "a"), "0123456789");
+        cache.put(key(cache, "default", "b"), "0123456789");
+        cache.put(key(cache, "default", "c"), "0123456789");
+        cache.get(key(cache, "default", "a"));
+
+        cache.put(key(cache, "default", "d"), "0123456789");
+
+        assertNull(cache.get(key(cache, "default", "b")));
+        assertNotNull(cache.get(key(cache, "default", "a")));
+        assertEquals(3, cache.size());
+        assertEquals(450, cache.bytes());
+        assertEquals(1, cache.evictions());
+    }
+
+    @Test
+    void testPut_LargerThanBudget_ShouldNotCache() {
+        ResponseCache cache = new ResponseCache(200, 0);
+        cache.put(key(cache, "default", "a"), "x".repeat(100));
+
+        assertEquals(0, cache.size());
+        assertEquals(0, cache.bytes());
+    }
+
+    @Test
+    void testGet_Expired_ShouldMiss() {
+        AtomicLong now = new AtomicLong();
+        ResponseCache cache = new ResponseCache(1 << 20, 10, now::get);
+        cache.put(key(cache, "default", "a"), "text");
+
+        now.set(TimeUnit.SECONDS.toNanos(10));
+        assertEquals("text", cache.get(key(cache, "default", "a")));
+
+        now.set(TimeUnit.SECONDS.toNanos(11));
+        assertNull(cache.get(key(cache, "default", "a")));
+        assertEquals(0, cache.bytes());
+    }
+
+    @Test
+    void testInvalidate_ShouldDropOnlyThatModel() {
+        ResponseCache cache = new ResponseCache(1 << 20, 60);
+        cache.put(key(cache, "default", "a"), "default text");
+        cache.put(key(cache, "small", "a"), "small text");
+
+        cache.invalidate("default");
+
+        assertNull(cache.get(key(cache, "default", "a")));
+        assertEquals("small text", cache.get(key(cache, "small", "a")));
+        assertEquals(1, cache.size());
+    }
+
+    @Test
+    void testPut_KeyTakenBeforeInvalidate_ShouldNotCache() {
+        ResponseCache cache = new ResponseCache(1 << 20, 60);
+        ResponseCache.Key before = key(cache, "default", "a");
+
+        cache.invalidate("default");
+        cache.put(before, "old model text");
+
+        assertNull(cache.get(key(cache, "default", "a")));
+        assertEquals(0, cache.size());
+    }
+}